@@ -0,0 +1,68 @@
+#include <module_load/types.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+// Compares calling the linked plugin the way the wrapper does with
+// PASMP_STATIC_PLUGIN against calling it through the pointer an eagerly bound
+// module_function holds. The functions timed only read a field, so the
+// difference is the cost of dispatch alone.
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+constexpr uint64_t iterations = 100'000'000;
+constexpr int rounds = 5;
+
+template <typename Major, typename Minor>
+uint64_t run(const Major &major, const Minor &minor, PASMP_version_t v) {
+  // reloaded on every iteration, so that inlined calls are not hoisted
+  PASMP_version_t volatile opaque = v;
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < iterations; i++)
+    sum += major(opaque) + minor(opaque);
+  return sum;
+}
+
+template <typename Major, typename Minor>
+double best_of(const Major &major, const Minor &minor, PASMP_version_t v) {
+  double best = 0;
+  for (int r = 0; r < rounds; r++) {
+    auto start = clock::now();
+    volatile uint64_t sink = run(major, minor, v);
+    (void)sink;
+    std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+    double per_call = elapsed.count() / (2 * iterations);
+    if (!r || per_call < best)
+      best = per_call;
+  }
+  return best;
+}
+
+} // namespace
+
+int main() {
+  PASMP_version_t v;
+  PASMP_error_descriptor_t ed{};
+  if (PASMP_version_create(&v, &ed))
+    return EXIT_FAILURE;
+
+  modl::linked_function<modl::version_major_tr> direct_major;
+  modl::linked_function<modl::version_minor_tr> direct_minor;
+  modl::module_function<modl::version_major_tr> indirect_major{
+      &PASMP_version_major};
+  modl::module_function<modl::version_minor_tr> indirect_minor{
+      &PASMP_version_minor};
+
+  auto direct = best_of(direct_major, direct_minor, v);
+  auto indirect = best_of(indirect_major, indirect_minor, v);
+  fmt::print("direct:   {:.3f} ns/call\n", direct);
+  fmt::print("indirect: {:.3f} ns/call\n", indirect);
+  fmt::print("speedup:  {:.2f}x\n", indirect / direct);
+
+  PASMP_version_destroy(v);
+}
@@ -0,0 +1,109 @@
+#include <module_load/module.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+
+// Compares calls into a module loaded in process against the same calls into
+// a copy of it hosted by a runner process. action_hash does no work in the
+// plugin, so it measures the round trip alone; plugin_actions copies the
+// plugin's action handles and stands for a typical query.
+// Usage: IsolationBench [module] [runner]
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+constexpr uint64_t iterations = 200'000;
+constexpr int rounds = 5;
+
+template <typename Call> double best_of(Call &&call) {
+  double best = 0;
+  for (int r = 0; r < rounds; r++) {
+    auto start = clock::now();
+    for (uint64_t i = 0; i < iterations; i++)
+      call(i);
+    std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+    double per_call = elapsed.count() / iterations;
+    if (!r || per_call < best)
+      best = per_call;
+  }
+  return best;
+}
+
+struct timings {
+  double hash;
+  double actions;
+};
+
+bool measure(const modl::loaded_module &mod, timings &out) {
+  const auto &f = mod.funcs();
+  PASMP_error_descriptor_t ed{};
+  PASMP_plugin_attr_t attr;
+  if (f.plugin_attr_create(&attr, &ed))
+    return false;
+  auto dir = std::filesystem::temp_directory_path().string();
+  PASMP_plugin_t p = nullptr;
+  auto status = f.plugin_attr_persistence_path(attr, {dir.data(), dir.size()},
+                                               &ed);
+  if (!status)
+    status = f.plugin_create(&p, attr, &ed);
+  f.plugin_attr_destroy(attr);
+  if (status)
+    return false;
+  PASMP_action_collection_t c;
+  if (f.action_collection_create(&c, &ed)) {
+    f.plugin_release(p);
+    return false;
+  }
+  // the plugin adds its actions in the background
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  uint64_t sink = 0;
+  out.hash = best_of([&](uint64_t i) {
+    sink += f.action_hash(reinterpret_cast<PASMP_action_t>(i + 1));
+  });
+  out.actions = best_of([&](uint64_t) {
+    if (!f.plugin_actions(p, c, &ed))
+      sink += f.action_collection_size(c);
+  });
+  volatile uint64_t keep = sink;
+  (void)keep;
+
+  f.action_collection_destroy(c);
+  f.plugin_release(p);
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::filesystem::path module = argc > 1 ? argv[1] : PASMP_BENCH_MODULE;
+  std::filesystem::path runner = argc > 2 ? argv[2] : PASMP_BENCH_RUNNER;
+
+  timings local{}, remote{};
+  try {
+    modl::load_options opts;
+    modl::loaded_module in_process(module, opts);
+    opts.isolate = modl::isolation::out_of_process;
+    opts.runner = runner;
+    modl::loaded_module out_of_process(module, opts);
+    if (!measure(in_process, local) || !measure(out_of_process, remote)) {
+      fmt::print(stderr, "error creating plugin\n");
+      return EXIT_FAILURE;
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "{}\n", e.what());
+    return EXIT_FAILURE;
+  }
+  fmt::print("{:<16}{:>14}{:>16}{:>10}\n", "", "in process", "out of process",
+             "ratio");
+  fmt::print("{:<16}{:>11.1f} ns{:>13.1f} ns{:>9.1f}x\n", "action_hash",
+             local.hash, remote.hash, remote.hash / local.hash);
+  fmt::print("{:<16}{:>11.1f} ns{:>13.1f} ns{:>9.1f}x\n", "plugin_actions",
+             local.actions, remote.actions, remote.actions / local.actions);
+}
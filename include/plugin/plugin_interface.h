@@ -9,13 +9,24 @@ extern "C" {
 
 #pragma region macros
 
+// bumped with every entry point added, since hosts resolve them all
 #define PASMP_VERSION_MAJOR 0
-#define PASMP_VERSION_MINOR 1
+#define PASMP_VERSION_MINOR 2
 #define PASMP_VERSION ((PASMP_VERSION_MAJOR << 16) | PASMP_VERSION_MINOR)
 
+// PASMP_STATIC_PLUGIN links the plugin into the host instead
+#if defined(_WIN32)
 #define PASMP_CALL __cdecl
-#define PASMP_CALLBACK PASMP_CALL
+#if defined(PASMP_STATIC_PLUGIN)
+#define PASMP_API
+#else
 #define PASMP_API __declspec(dllexport)
+#endif
+#else
+#define PASMP_CALL
+#define PASMP_API __attribute__((visibility("default")))
+#endif
+#define PASMP_CALLBACK PASMP_CALL
 
 #define PASMP_FUNCTION PASMP_API PASMP_status_t PASMP_CALL
 
@@ -42,6 +53,7 @@ typedef enum PASMP_status_e {
   PASMP_ERROR_ACTION_OTHER,
   PASMP_ERROR_ACTION_SERIAL,
   PASMP_ERROR_PAYLOAD_INVALID,
+  PASMP_ERROR_ACTION_STALE,
 } PASMP_status_t;
 
 typedef enum PASMP_payload_tag_e {
@@ -81,6 +93,7 @@ typedef struct PASMP_plugin_attr_st *PASMP_plugin_attr_t;
 typedef struct PASMP_plugin_st *PASMP_plugin_t;
 typedef struct PASMP_action_collection_st *PASMP_action_collection_t;
 typedef struct PASMP_action_st *PASMP_action_t;
+typedef struct PASMP_prepared_action_st *PASMP_prepared_action_t;
 
 typedef void(PASMP_CALLBACK PASMP_on_action_modified_t)(PASMP_action_t, void *);
 
@@ -96,6 +109,8 @@ typedef void(PASMP_CALLBACK PASMP_on_action_finish_t)(PASMP_status_t,
                                                       PASMP_string_view_t,
                                                       void *);
 
+typedef void(PASMP_CALLBACK PASMP_payload_release_t)(void *);
+
 typedef union PASMP_payload_data_st {
   int32_t int32_value;
   int64_t int64_value;
@@ -111,6 +126,23 @@ typedef struct PASMP_payload_st {
   const PASMP_payload_data_t *data = NULL;
 } PASMP_payload_t;
 
+// the data must hold the member matching the tag the action was prepared for
+typedef PASMP_status_t(PASMP_CALLBACK PASMP_prepared_execute_t)(
+    PASMP_prepared_action_t, const PASMP_payload_data_t *,
+    PASMP_error_descriptor_t *);
+
+typedef struct PASMP_rate_limit_st {
+  double rate = 0;            // tokens per second, 0 disables the bucket
+  uint64_t burst = 0;         // bucket capacity
+  uint64_t max_in_flight = 0; // 0 disables the in-flight limit
+} PASMP_rate_limit_t;
+
+typedef struct PASMP_admission_stats_st {
+  uint64_t admitted = 0;
+  uint64_t rejected = 0;
+  uint64_t in_flight = 0;
+} PASMP_admission_stats_t;
+
 #pragma endregion
 
 #pragma region misc_operations
@@ -181,9 +213,32 @@ PASMP_FUNCTION PASMP_action_collection_at(PASMP_action_collection_t, uint64_t,
                                           PASMP_action_t *,
                                           PASMP_error_descriptor_t *);
 
+// copies up to *count_inout handles starting at offset; on return
+// *count_inout holds the number of handles copied
+PASMP_FUNCTION PASMP_action_collection_read(PASMP_action_collection_t,
+                                            uint64_t, PASMP_action_t *,
+                                            uint64_t *,
+                                            PASMP_error_descriptor_t *);
+
 PASMP_FUNCTION PASMP_plugin_actions(PASMP_plugin_t, PASMP_action_collection_t,
                                     PASMP_error_descriptor_t *);
 
+// writes the plugin's actions in a form that another instance of the module,
+// such as a newer build being swapped in, accepts; a null buffer queries the
+// size, and PASMP_ERROR_TRUNCATED reports the size needed if it grew since
+PASMP_FUNCTION PASMP_plugin_serialize(PASMP_plugin_t, char *, uint64_t *,
+                                      PASMP_error_descriptor_t *);
+// adds or updates the serialized actions, keeping their identity, so that
+// action handles serialized against the source resolve against this plugin
+PASMP_FUNCTION PASMP_plugin_deserialize(PASMP_plugin_t, const char *, uint64_t,
+                                        PASMP_error_descriptor_t *);
+// writes one action in the form PASMP_plugin_deserialize takes and removes it
+// from the plugin, so that another instance can take it over; a null buffer
+// queries the size and removes nothing. The action leaves its identity behind
+// and gets a new one wherever it is deserialized
+PASMP_FUNCTION PASMP_plugin_extract(PASMP_plugin_t, PASMP_action_t, char *,
+                                    uint64_t *, PASMP_error_descriptor_t *);
+
 PASMP_FUNCTION PASMP_plugin_configure_gui(PASMP_plugin_t,
                                           PASMP_on_config_finish_t *, void *,
                                           PASMP_error_descriptor_t *);
@@ -194,6 +249,20 @@ PASMP_FUNCTION PASMP_plugin_configure_cli(PASMP_plugin_t,
 
 #pragma endregion
 
+#pragma region admission_operations
+
+// executions over a limit fail immediately with PASMP_UNAVAILABLE
+PASMP_FUNCTION PASMP_plugin_limit(PASMP_plugin_t, PASMP_rate_limit_t,
+                                  PASMP_error_descriptor_t *);
+PASMP_FUNCTION PASMP_action_limit(PASMP_plugin_t, PASMP_action_t,
+                                  PASMP_rate_limit_t,
+                                  PASMP_error_descriptor_t *);
+PASMP_FUNCTION PASMP_action_admission_stats(PASMP_plugin_t, PASMP_action_t,
+                                            PASMP_admission_stats_t *,
+                                            PASMP_error_descriptor_t *);
+
+#pragma endregion
+
 #pragma region action_operations
 
 PASMP_FUNCTION PASMP_action_serialize(PASMP_action_t, char *, uint64_t *,
@@ -218,11 +287,41 @@ PASMP_FUNCTION
 PASMP_action_execute(PASMP_plugin_t, PASMP_action_t, PASMP_payload_t,
                      PASMP_error_descriptor_t *);
 
+// the payload tag the action expects, to be checked once ahead of executions
+PASMP_FUNCTION PASMP_action_payload_type(PASMP_plugin_t, PASMP_action_t,
+                                         PASMP_payload_tag_t *,
+                                         PASMP_error_descriptor_t *);
+
+// same as PASMP_action_execute with a PASMP_PAYLOAD_INT32 payload, without
+// the tagged payload in between
+PASMP_FUNCTION PASMP_action_execute_int32(PASMP_plugin_t, PASMP_action_t,
+                                          int32_t, PASMP_error_descriptor_t *);
+
+// resolves the action once for payloads of the given tag, like a prepared
+// statement: the returned function executes it through the returned context
+// without looking it up again; once the action is modified or removed,
+// executions fail with PASMP_ERROR_ACTION_STALE and it has to be prepared anew
+PASMP_FUNCTION PASMP_action_prepare(PASMP_plugin_t, PASMP_action_t,
+                                    PASMP_payload_tag_t,
+                                    PASMP_prepared_action_t *,
+                                    PASMP_prepared_execute_t **,
+                                    PASMP_error_descriptor_t *);
+PASMP_FUNCTION PASMP_prepared_action_destroy(PASMP_prepared_action_t);
+
+// the callback is invoked exactly once if and only if PASMP_SUCCESS is
+// returned; execution errors are reported through the callback
 PASMP_FUNCTION PASMP_action_execute_async(PASMP_plugin_t, PASMP_action_t,
                                           PASMP_payload_t,
                                           PASMP_on_action_finish_t *, void *,
                                           PASMP_error_descriptor_t *);
 
+// takes ownership of the payload: the release callback is invoked exactly once,
+// whatever the outcome, when the plugin no longer needs the payload; the finish
+// callback is optional and follows the same rules as above
+PASMP_FUNCTION PASMP_action_execute_async_owned(
+    PASMP_plugin_t, PASMP_action_t, PASMP_payload_t, PASMP_payload_release_t *,
+    void *, PASMP_on_action_finish_t *, void *, PASMP_error_descriptor_t *);
+
 PASMP_API uint64_t PASMP_CALL PASMP_action_hash(PASMP_action_t);
 PASMP_API int32_t PASMP_CALL PASMP_action_equal(PASMP_action_t, PASMP_action_t);
 
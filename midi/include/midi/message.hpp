@@ -110,6 +110,7 @@ std::strong_ordering operator<=>(const message_status &,
 struct message_data {
   using time_point = std::chrono::time_point<std::chrono::steady_clock,
                                              std::chrono::milliseconds>;
+  // steady_clock time at which the driver received the message
   time_point timestamp;
   message_status status;
   std::byte data[2];
@@ -7,7 +7,9 @@
 
 #include "wincommon.h"
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <thread>
 
@@ -128,6 +130,7 @@ struct midiin::impl {
   midiin_descriptor_t descr;
   midiin_attributes attr;
   handle_t handle;
+  std::atomic<std::chrono::steady_clock::time_point> started;
   heartbeat hb;
 
   impl(midiin_descriptor_t &&d, start_behaviour sb, midiin_attributes &&a)
@@ -146,6 +149,8 @@ struct midiin::impl {
   }
 
   bool start(std::error_code &ec) noexcept {
+    // driver timestamps count milliseconds from the call to midiInStart
+    started = std::chrono::steady_clock::now();
     if (auto res = midiInStart(handle); MMSYSERR_NOERROR != res)
       ec = std::error_code{int(res), midi_category()};
     else
@@ -194,16 +199,18 @@ struct midiin::impl {
   static void CALLBACK wrap_callback(HMIDIIN hMidiIn, UINT wMsg,
                                      DWORD_PTR dwInstance, DWORD_PTR dwParam1,
                                      DWORD_PTR dwParam2) {
-    auto convert_msg = [](DWORD_PTR t, DWORD_PTR x) {
+    key<midiin> k;
+    const auto &imp = *reinterpret_cast<const impl *>(dwInstance);
+
+    auto convert_msg = [&imp](DWORD_PTR t, DWORD_PTR x) {
+      using time_point = message_data::time_point;
       return message_data{
           .timestamp =
-              message_data::time_point{message_data::time_point::duration{t}},
+              std::chrono::floor<time_point::duration>(imp.started.load()) +
+              time_point::duration{t},
           .status = make_message_status(std::byte(x & 0xff)),
           .data = {std::byte((x >> 8) & 0xff), std::byte((x >> 16) & 0xff)}};
     };
-
-    key<midiin> k;
-    const auto &imp = *reinterpret_cast<const impl *>(dwInstance);
     try {
       message_type msg_type = message_type::unknown;
       message_data msg;
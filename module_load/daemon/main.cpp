@@ -0,0 +1,898 @@
+// Serves modules to the hosts that load them with modl::isolation::daemon,
+// each module opened once for all of them. Only the modules given on the
+// command line are served, so that hosts never get to name a library to load.
+// A host only gets to use the handles it was given, which are numbers of its
+// own connection rather than the plugin's pointers. The socket is only open
+// to the daemon's user, or to the members of the group given.
+// Usage: PluginHostDaemon [--group <name>] <socket> <module...>
+
+#include "../src/remote_dispatch.hpp"
+#include "../src/remote_wire.hpp"
+
+#include <grp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+namespace remote = modl::detail::remote;
+
+// output a host leaves unread before it is disconnected
+constexpr size_t max_backlog = 64 * 1024 * 1024;
+// and calls it sends that are not served yet
+constexpr size_t max_queued = 64 * 1024 * 1024;
+
+template <typename T> uint64_t value(T x) noexcept {
+  return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(x));
+}
+
+template <typename T> T handle(uint64_t x) noexcept {
+  return reinterpret_cast<T>(static_cast<uintptr_t>(x));
+}
+
+template <typename T> void append(std::vector<char> &out, const T &x) {
+  auto *bytes = reinterpret_cast<const char *>(&x);
+  out.insert(out.end(), bytes, bytes + sizeof(x));
+}
+
+enum class handle_kind : uint8_t { plugin, action, prepared };
+
+// The handles a host holds, each counted as often as it was handed out, under
+// numbers that only mean something to the connection; zero is never one. The
+// actions of events are only lent: their numbers count no reference and go
+// once the plugin removes the action, unless the host holds one by then.
+class handle_table {
+public:
+  struct entry {
+    handle_kind kind;
+    uint64_t value;
+    uint64_t refs;
+    bool lent;
+  };
+
+  // counts another reference to the value, returning its number
+  uint64_t hand_out(handle_kind k, uint64_t x) {
+    std::scoped_lock lk(mtx_);
+    auto &e = number(k, x);
+    e.second.refs++;
+    return e.first;
+  }
+
+  uint64_t lend(handle_kind k, uint64_t x) {
+    std::scoped_lock lk(mtx_);
+    auto &e = number(k, x);
+    e.second.lent = true;
+    return e.first;
+  }
+
+  // once the plugin no longer has the value
+  void forget(handle_kind k, uint64_t x) noexcept {
+    std::scoped_lock lk(mtx_);
+    auto id = ids_.find({k, x});
+    if (id == ids_.end())
+      return;
+    auto it = entries_.find(id->second);
+    it->second.lent = false;
+    if (!it->second.refs) {
+      entries_.erase(it);
+      ids_.erase(id);
+    }
+  }
+
+  std::optional<uint64_t> find(handle_kind k, uint64_t id) const noexcept {
+    std::scoped_lock lk(mtx_);
+    auto it = entries_.find(id);
+    if (it == entries_.end() || it->second.kind != k)
+      return std::nullopt;
+    return it->second.value;
+  }
+
+  // gives up a reference, which the caller then releases in the plugin;
+  // the entry is returned as it was, without references if only lent
+  std::optional<entry> release(handle_kind k, uint64_t id) noexcept {
+    std::scoped_lock lk(mtx_);
+    auto it = entries_.find(id);
+    if (it == entries_.end() || it->second.kind != k)
+      return std::nullopt;
+    auto retval = it->second;
+    if (retval.refs && !--it->second.refs && !retval.lent) {
+      ids_.erase({k, retval.value});
+      entries_.erase(it);
+    }
+    return retval;
+  }
+
+  // once the connection is gone
+  std::vector<entry> drain() noexcept {
+    std::vector<entry> retval;
+    std::scoped_lock lk(mtx_);
+    try {
+      retval.reserve(entries_.size());
+      for (const auto &[id, e] : entries_)
+        retval.push_back(e);
+    } catch (const std::bad_alloc &) {
+    }
+    return retval;
+  }
+
+private:
+  // must be called with mtx_ held
+  std::pair<const uint64_t, entry> &number(handle_kind k, uint64_t x) {
+    auto [it, added] = ids_.try_emplace({k, x}, next_);
+    if (!added)
+      return *entries_.find(it->second);
+    try {
+      auto &e = *entries_.emplace(next_, entry{k, x, 0, false}).first;
+      next_++;
+      return e;
+    } catch (...) {
+      ids_.erase(it);
+      throw;
+    }
+  }
+
+  mutable std::mutex mtx_;
+  uint64_t next_ = 1;
+  std::unordered_map<uint64_t, entry> entries_;
+  std::map<std::pair<handle_kind, uint64_t>, uint64_t> ids_;
+};
+
+struct handle_arg {
+  size_t index;
+  handle_kind kind;
+};
+
+// where a call takes the handles of the host
+std::span<const handle_arg> handle_args(remote::op code) noexcept {
+  using enum handle_kind;
+  static constexpr handle_arg plugin_only[] = {{0, plugin}};
+  static constexpr handle_arg plugin_action[] = {{0, plugin}, {1, action}};
+  static constexpr handle_arg action_only[] = {{0, action}};
+  static constexpr handle_arg two_actions[] = {{0, action}, {1, action}};
+  static constexpr handle_arg prepared_only[] = {{0, prepared}};
+  switch (code) {
+  case remote::op::plugin_addref:
+  case remote::op::plugin_release:
+  case remote::op::plugin_actions:
+  case remote::op::plugin_serialize:
+  case remote::op::plugin_deserialize:
+  case remote::op::plugin_configure_gui:
+  case remote::op::plugin_configure_cli:
+  case remote::op::plugin_limit:
+    return plugin_only;
+  case remote::op::plugin_extract:
+  case remote::op::action_limit:
+  case remote::op::action_admission_stats:
+  case remote::op::action_descriptor_create:
+  case remote::op::action_execute:
+  case remote::op::action_payload_type:
+  case remote::op::action_execute_int32:
+  case remote::op::action_prepare:
+  case remote::op::action_execute_async:
+    return plugin_action;
+  case remote::op::action_serialize:
+  case remote::op::action_destroy:
+  case remote::op::action_hash:
+    return action_only;
+  case remote::op::action_equal:
+    return two_actions;
+  case remote::op::prepared_execute:
+  case remote::op::prepared_action_destroy:
+    return prepared_only;
+  default:
+    return {};
+  }
+}
+
+// the call giving up a handle of the kind
+remote::op release_op(handle_kind k) noexcept {
+  switch (k) {
+  case handle_kind::plugin:
+    return remote::op::plugin_release;
+  case handle_kind::action:
+    return remote::op::action_destroy;
+  default:
+    return remote::op::prepared_action_destroy;
+  }
+}
+
+bool releases(remote::op code) noexcept {
+  return code == release_op(handle_kind::plugin) ||
+         code == release_op(handle_kind::action) ||
+         code == release_op(handle_kind::prepared);
+}
+
+struct connection;
+
+// The plugin of a module is shared by all of its hosts, as it is by the users
+// of a module within one process. The callbacks each host registers when
+// creating it are fanned out to that host, for the changes made from then on.
+struct served_module {
+  explicit served_module(const std::filesystem::path &path)
+      : host(path), dispatch(host) {}
+
+  ~served_module() {
+    if (plugin)
+      host.module.funcs().plugin_release(plugin);
+  }
+
+  struct subscriber {
+    connection *conn;
+    uint64_t cookie;
+    uint64_t mask;
+  };
+
+  remote::hosted_module host;
+  remote::dispatcher dispatch;
+
+  std::mutex create_mtx;
+  PASMP_plugin_t plugin = nullptr;
+
+  std::mutex subscribers_mtx;
+  std::vector<subscriber> subscribers;
+};
+
+// Frames are read by the event loop and served by the workers, which write
+// the responses to a batch in one go. What the socket does not take is sent
+// by the event loop once it becomes writable.
+struct connection final : remote::event_sink {
+  connection(int fd, int epoll_fd) noexcept : fd(fd), epoll_fd(epoll_fd) {}
+  ~connection();
+
+  void push(const remote::event &ev) noexcept override {
+    remote::event own = ev;
+    if (ev.kind <= remote::event_kind::action_removed) {
+      try {
+        own.action = handles.lend(handle_kind::action, ev.action);
+      } catch (const std::bad_alloc &) {
+        return;
+      }
+    }
+    auto size = remote::event_size(own);
+    char frame[sizeof(remote::frame_header) + sizeof(remote::event)];
+    remote::frame_header h{static_cast<uint32_t>(size),
+                           remote::frame_kind::event, 0};
+    std::memcpy(frame, &h, sizeof(h));
+    std::memcpy(frame + sizeof(h), &own, size);
+    write(frame, sizeof(h) + size);
+    if (ev.kind == remote::event_kind::action_removed)
+      handles.forget(handle_kind::action, ev.action);
+  }
+
+  void write(const char *data, size_t size) noexcept {
+    std::scoped_lock lk(out_mtx);
+    if (closed)
+      return;
+    if (out.empty()) {
+      auto n = send(fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (n < 0 && errno != EAGAIN && errno != EINTR) {
+        closed = true;
+        return;
+      }
+      n = std::max<ssize_t>(n, 0);
+      data += n;
+      size -= n;
+    }
+    if (!size)
+      return;
+    if (out.size() + size > max_backlog) {
+      closed = true;
+      shutdown(fd, SHUT_RDWR);
+      return;
+    }
+    try {
+      out.insert(out.end(), data, data + size);
+    } catch (const std::bad_alloc &) {
+      closed = true;
+      shutdown(fd, SHUT_RDWR);
+      return;
+    }
+    watch(EPOLLIN | EPOLLOUT);
+  }
+
+  // on EPOLLOUT
+  void flush() noexcept {
+    std::scoped_lock lk(out_mtx);
+    if (closed || out.empty())
+      return;
+    auto n = send(fd, out.data(), out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n < 0 && errno != EAGAIN && errno != EINTR) {
+      closed = true;
+      return;
+    }
+    out.erase(out.begin(), out.begin() + std::max<ssize_t>(n, 0));
+    if (out.empty())
+      watch(EPOLLIN);
+  }
+
+  void watch(uint32_t events) noexcept {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+  }
+
+  const int fd;
+  const int epoll_fd;
+  // the module opened by the first frame
+  std::atomic<served_module *> module = nullptr;
+
+  // only touched by the event loop
+  std::vector<char> in;
+  // bytes of calls handed to the workers and not served yet
+  std::atomic<size_t> queued = 0;
+
+  std::mutex out_mtx;
+  std::vector<char> out;
+  bool closed = false;
+
+  // released once the host disconnects
+  handle_table handles;
+};
+
+connection::~connection() {
+  if (auto *m = module.load()) {
+    {
+      std::scoped_lock lk(m->subscribers_mtx);
+      std::erase_if(m->subscribers,
+                    [this](const auto &s) { return s.conn == this; });
+    }
+    auto held = handles.drain();
+    // what was prepared from the actions first, the plugins last
+    std::ranges::sort(held, std::greater{}, &handle_table::entry::kind);
+    auto s = std::unique_ptr<remote::slot>(new (std::nothrow) remote::slot{});
+    for (const auto &e : held) {
+      if (!s)
+        break;
+      s->code = release_op(e.kind);
+      for (auto n = e.refs; n--;) {
+        s->args[0] = e.value;
+        s->error_size = s->data_size = 0;
+        m->dispatch(*s, nullptr);
+      }
+    }
+  }
+  close(fd);
+}
+
+void fan_out(void *data, remote::event_kind kind, uint64_t bit,
+             PASMP_action_t a) noexcept {
+  auto &m = *static_cast<served_module *>(data);
+  remote::event ev{};
+  ev.kind = kind;
+  ev.action = value(a);
+  std::scoped_lock lk(m.subscribers_mtx);
+  for (const auto &s : m.subscribers) {
+    if (s.mask & bit) {
+      ev.cookie = s.cookie;
+      s.conn->push(ev);
+    }
+  }
+}
+
+void PASMP_CALLBACK on_add(PASMP_action_t a, void *m) noexcept {
+  fan_out(m, remote::event_kind::action_added, 1, a);
+}
+
+void PASMP_CALLBACK on_mod(PASMP_action_t a, void *m) noexcept {
+  fan_out(m, remote::event_kind::action_modified, 2, a);
+}
+
+void PASMP_CALLBACK on_rm(PASMP_action_t a, void *m) noexcept {
+  fan_out(m, remote::event_kind::action_removed, 4, a);
+}
+
+class plugin_daemon {
+public:
+  plugin_daemon(int listen_fd, int signal_fd)
+      : listen_fd_(listen_fd), signal_fd_(signal_fd),
+        epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+    if (epoll_fd_ < 0)
+      throw std::system_error(std::error_code(errno, std::system_category()),
+                              "Error creating event loop");
+    for (int fd : {listen_fd_, signal_fd_}) {
+      epoll_event ev{};
+      ev.events = EPOLLIN;
+      ev.data.fd = fd;
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+  }
+
+  ~plugin_daemon() {
+    {
+      std::scoped_lock lk(tasks_mtx_);
+      stopping_ = true;
+    }
+    tasks_cv_.notify_all();
+    workers_.clear();
+    connections_.clear();
+    close(epoll_fd_);
+  }
+
+  // before run(), from the command line
+  void add_module(const std::filesystem::path &path) {
+    auto key = std::filesystem::weakly_canonical(path).string();
+    std::scoped_lock lk(modules_mtx_);
+    auto &m = modules_[key];
+    if (!m)
+      m = std::make_unique<served_module>(key);
+  }
+
+  served_module &find(const std::filesystem::path &path) {
+    auto key = std::filesystem::weakly_canonical(path).string();
+    std::scoped_lock lk(modules_mtx_);
+    auto it = modules_.find(key);
+    if (it == modules_.end())
+      throw std::system_error(
+          std::make_error_code(std::errc::permission_denied),
+          "Module not served by the daemon");
+    return *it->second;
+  }
+
+  void run() {
+    size_t count = std::max(4u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < count; i++)
+      workers_.emplace_back([this]() { work(); });
+    std::vector<char> buf(256 * 1024);
+    epoll_event events[64];
+    while (true) {
+      int n = epoll_wait(epoll_fd_, events, std::size(events), -1);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        return;
+      for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+        if (fd == signal_fd_)
+          return;
+        if (fd == listen_fd_) {
+          accept_all();
+          continue;
+        }
+        auto it = connections_.find(fd);
+        if (it == connections_.end())
+          continue;
+        auto conn = it->second;
+        if (events[i].events & EPOLLOUT)
+          conn->flush();
+        if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) &&
+            !receive(conn, buf))
+          drop(fd);
+      }
+    }
+  }
+
+private:
+  struct task {
+    std::shared_ptr<connection> conn;
+    std::vector<char> frames;
+  };
+
+  void accept_all() {
+    while (true) {
+      int fd = accept4(listen_fd_, nullptr, nullptr,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0)
+        return;
+      epoll_event ev{};
+      ev.events = EPOLLIN;
+      ev.data.fd = fd;
+      if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev)) {
+        close(fd);
+        continue;
+      }
+      connections_[fd] = std::make_shared<connection>(fd, epoll_fd_);
+    }
+  }
+
+  void drop(int fd) {
+    auto it = connections_.find(fd);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    {
+      std::scoped_lock lk(it->second->out_mtx);
+      it->second->closed = true;
+    }
+    // released once its last call is served
+    connections_.erase(it);
+  }
+
+  // false once the connection is to be dropped, after queuing what it sent
+  bool receive(const std::shared_ptr<connection> &conn,
+               std::vector<char> &buf) {
+    bool open = true;
+    while (true) {
+      auto n = recv(conn->fd, buf.data(), buf.size(), 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0 && errno == EAGAIN)
+        break;
+      if (n <= 0) {
+        open = false;
+        break;
+      }
+      conn->in.insert(conn->in.end(), buf.data(), buf.data() + n);
+    }
+    auto &in = conn->in;
+    size_t used = 0;
+    while (in.size() - used >= sizeof(remote::frame_header)) {
+      remote::frame_header h;
+      std::memcpy(&h, in.data() + used, sizeof(h));
+      if (h.size > remote::frame_capacity)
+        return false;
+      if (in.size() - used < sizeof(h) + h.size)
+        break;
+      used += sizeof(h) + h.size;
+    }
+    if (used && conn->queued.fetch_add(used) + used > max_queued)
+      return false;
+    if (used) {
+      task t{conn, {}};
+      if (used == in.size()) {
+        t.frames = std::move(in);
+        in.clear();
+      } else {
+        t.frames.assign(in.begin(), in.begin() + used);
+        in.erase(in.begin(), in.begin() + used);
+      }
+      {
+        std::scoped_lock lk(tasks_mtx_);
+        tasks_.push_back(std::move(t));
+      }
+      tasks_cv_.notify_one();
+    }
+    return open;
+  }
+
+  void work() {
+    auto scratch = std::make_unique<remote::slot>();
+    std::vector<char> out;
+    std::unique_lock lk(tasks_mtx_);
+    while (true) {
+      tasks_cv_.wait(lk, [this]() { return stopping_ || !tasks_.empty(); });
+      if (stopping_)
+        return;
+      auto t = std::move(tasks_.front());
+      tasks_.pop_front();
+      lk.unlock();
+      serve(t, *scratch, out);
+      t.conn->queued.fetch_sub(t.frames.size());
+      t = {};
+      lk.lock();
+    }
+  }
+
+  void serve(const task &t, remote::slot &s, std::vector<char> &out) {
+    out.clear();
+    std::shared_ptr<remote::event_sink> sink = t.conn;
+    for (size_t pos = 0; pos < t.frames.size();) {
+      remote::frame_header h;
+      std::memcpy(&h, t.frames.data() + pos, sizeof(h));
+      const char *body = t.frames.data() + pos + sizeof(h);
+      pos += sizeof(h) + h.size;
+      if (h.kind == remote::frame_kind::open)
+        open(*t.conn, h, std::string(body, h.size), out);
+      else if (h.kind == remote::frame_kind::call)
+        call(*t.conn, sink, h, body, s, out);
+    }
+    t.conn->write(out.data(), out.size());
+  }
+
+  void open(connection &conn, const remote::frame_header &h,
+            const std::string &path, std::vector<char> &out) {
+    remote::call_header c{};
+    std::string error;
+    try {
+      auto &m = find(path);
+      conn.module.store(&m);
+      c.args[0] = m.host.plugin_version;
+    } catch (const std::exception &e) {
+      c.status = PASMP_ERROR_SYSTEM;
+      error = e.what();
+      error.resize(std::min(error.size(), remote::error_capacity));
+    }
+    append(out, remote::frame_header{
+                    static_cast<uint32_t>(sizeof(c) + error.size()),
+                    remote::frame_kind::open, h.id});
+    append(out, c);
+    out.insert(out.end(), error.begin(), error.end());
+  }
+
+  void call(connection &conn, const std::shared_ptr<remote::event_sink> &sink,
+            const remote::frame_header &h, const char *body, remote::slot &s,
+            std::vector<char> &out) {
+    remote::call_header c;
+    auto *m = conn.module.load();
+    bool lent = false;
+    if (h.size < sizeof(c))
+      return;
+    std::memcpy(&c, body, sizeof(c));
+    auto reject = [&]() {
+      c.status = PASMP_INVALID_ARGUMENT;
+      c.error_length = c.data_size = 0;
+      append(out, remote::frame_header{static_cast<uint32_t>(sizeof(c)),
+                                       remote::frame_kind::call, h.id});
+      append(out, c);
+    };
+    if (!m || c.data_size > remote::data_capacity ||
+        sizeof(c) + c.data_size > h.size || !admit(conn, c, s, lent))
+      return reject();
+    s.code = c.code;
+    s.error_size = std::min<uint64_t>(c.error_size, remote::error_capacity);
+    s.data_size = c.data_size;
+    std::memcpy(s.data, body + sizeof(c), c.data_size);
+    auto error_size = s.error_size;
+
+    // the plugin never gave out a reference to a lent action
+    if (lent)
+      s.status = PASMP_SUCCESS;
+    else if (s.code == remote::op::plugin_create)
+      create(conn, *m, s);
+    else
+      m->dispatch(s, sink);
+    if (!s.status)
+      hand_out(conn, *m, s);
+    // the host's own numbers go back, not the plugin's pointers
+    for (auto [i, kind] : handle_args(c.code))
+      s.args[i] = c.args[i];
+
+    auto written = error_size - s.error_size;
+    c.status = s.status;
+    std::memcpy(c.args, s.args, sizeof(c.args));
+    c.error_size = s.error_size;
+    c.error_length = written ? std::min(written + 1, error_size) : 0;
+    c.data_size = remote::response_data_size(s);
+    append(out, remote::frame_header{
+                    static_cast<uint32_t>(sizeof(c) + c.error_length +
+                                          c.data_size),
+                    remote::frame_kind::call, h.id});
+    append(out, c);
+    out.insert(out.end(), s.error, s.error + c.error_length);
+    out.insert(out.end(), s.data, s.data + c.data_size);
+  }
+
+  // the plugin's handles for those of the host, false if it holds no such
+  // handle; a handle given up is no longer the host's from here on, and lent
+  // tells whether it held no reference to give up
+  static bool admit(connection &conn, const remote::call_header &c,
+                    remote::slot &s, bool &lent) noexcept {
+    std::memcpy(s.args, c.args, sizeof(s.args));
+    for (auto [i, kind] : handle_args(c.code)) {
+      if (releases(c.code)) {
+        auto e = conn.handles.release(kind, c.args[i]);
+        // the number of a removed action goes with the event, and numbers
+        // are never reused
+        if (!e && kind == handle_kind::action) {
+          lent = true;
+          continue;
+        }
+        if (!e)
+          return false;
+        s.args[i] = e->value;
+        lent = !e->refs;
+      } else if (auto x = conn.handles.find(kind, c.args[i])) {
+        s.args[i] = *x;
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // the handles a call returns, under the numbers the host gets to use
+  static void hand_out(connection &conn, served_module &m,
+                       remote::slot &s) noexcept {
+    using enum handle_kind;
+    const auto &f = m.host.module.funcs();
+    auto &handles = conn.handles;
+    auto *actions = reinterpret_cast<uint64_t *>(s.data);
+    size_t i = 0;
+    try {
+      switch (s.code) {
+      case remote::op::plugin_addref:
+        handles.hand_out(plugin, s.args[0]);
+        break;
+      case remote::op::plugin_actions:
+        for (; i < s.data_size / sizeof(uint64_t); i++)
+          actions[i] = handles.hand_out(action, actions[i]);
+        break;
+      case remote::op::action_deserialize:
+        s.args[0] = handles.hand_out(action, s.args[0]);
+        break;
+      case remote::op::action_prepare:
+        s.args[3] = handles.hand_out(prepared, s.args[3]);
+        break;
+      default:
+        break;
+      }
+    } catch (const std::bad_alloc &) {
+      // what was handed out already is released with the connection
+      if (s.code == remote::op::plugin_addref)
+        f.plugin_release(handle<PASMP_plugin_t>(s.args[0]));
+      else if (s.code == remote::op::plugin_actions)
+        for (; i < s.data_size / sizeof(uint64_t); i++)
+          f.action_destroy(handle<PASMP_action_t>(actions[i]));
+      else if (s.code == remote::op::action_deserialize)
+        f.action_destroy(handle<PASMP_action_t>(s.args[0]));
+      else if (s.code == remote::op::action_prepare) {
+        s.code = remote::op::prepared_action_destroy;
+        s.args[0] = s.args[3];
+        s.error_size = 0;
+        m.dispatch(s, nullptr);
+        s.code = remote::op::action_prepare;
+      }
+      s.status = PASMP_ERROR_ALLOC;
+      s.data_size = 0;
+    }
+  }
+
+  // the first host to create the plugin sets its persistence path
+  void create(connection &conn, served_module &m, remote::slot &s) {
+    const auto &f = m.host.module.funcs();
+    PASMP_error_descriptor_t ed{s.error_size ? s.error : nullptr,
+                                s.error_size};
+    auto *err = ed.what ? &ed : nullptr;
+    auto path = remote::wire_reader(s.data, s.data + s.data_size).get();
+    s.status = PASMP_SUCCESS;
+    {
+      std::scoped_lock lk(m.create_mtx);
+      if (!m.plugin) {
+        PASMP_plugin_attr_t attr;
+        s.status = f.plugin_attr_create(&attr, err);
+        if (!s.status) {
+          f.plugin_attr_on_action_add(attr, &on_add, &m, nullptr);
+          f.plugin_attr_on_action_mod(attr, &on_mod, &m, nullptr);
+          f.plugin_attr_on_action_rm(attr, &on_rm, &m, nullptr);
+          if (!path.empty())
+            s.status = f.plugin_attr_persistence_path(
+                attr, {path.data(), path.size()}, err);
+          if (!s.status)
+            s.status = f.plugin_create(&m.plugin, attr, err);
+          f.plugin_attr_destroy(attr);
+        }
+      }
+      if (!s.status)
+        s.status = f.plugin_addref(m.plugin);
+    }
+    s.error_size = ed.size;
+    if (s.status)
+      return;
+    try {
+      s.args[2] = conn.handles.hand_out(handle_kind::plugin, value(m.plugin));
+    } catch (const std::bad_alloc &) {
+      f.plugin_release(m.plugin);
+      s.status = PASMP_ERROR_ALLOC;
+      return;
+    }
+    if (s.args[1]) {
+      std::scoped_lock lk(m.subscribers_mtx);
+      try {
+        m.subscribers.push_back({&conn, s.args[0], s.args[1]});
+      } catch (const std::bad_alloc &) {
+        conn.handles.release(handle_kind::plugin, s.args[2]);
+        f.plugin_release(m.plugin);
+        s.status = PASMP_ERROR_ALLOC;
+      }
+    }
+  }
+
+  const int listen_fd_;
+  const int signal_fd_;
+  const int epoll_fd_;
+
+  std::mutex modules_mtx_;
+  std::map<std::string, std::unique_ptr<served_module>> modules_;
+
+  std::unordered_map<int, std::shared_ptr<connection>> connections_;
+
+  std::mutex tasks_mtx_;
+  std::condition_variable tasks_cv_;
+  std::deque<task> tasks_;
+  bool stopping_ = false;
+  std::vector<std::jthread> workers_;
+};
+
+// only the daemon's user may connect, or the group's members as well
+int listen_on(const std::string &path, std::optional<gid_t> group) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+    std::fprintf(stderr, "Invalid socket path: %s\n", path.c_str());
+    return -1;
+  }
+  std::memcpy(addr.sun_path, path.data(), path.size());
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    std::perror("socket");
+    return -1;
+  }
+  unlink(path.c_str());
+  // so that the socket is never open to others, not even until the chmod
+  auto mask = umask(0177);
+  bool bound = !bind(fd, reinterpret_cast<const sockaddr *>(&addr),
+                     sizeof(addr));
+  umask(mask);
+  if (!bound || (group && (chown(path.c_str(), -1, *group) ||
+                           chmod(path.c_str(), 0660))) ||
+      listen(fd, SOMAXCONN)) {
+    std::perror("bind");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int first = 1;
+  std::optional<gid_t> group;
+  if (argc > 2 && !std::strcmp(argv[1], "--group")) {
+    auto *g = getgrnam(argv[2]);
+    if (!g) {
+      std::fprintf(stderr, "Unknown group: %s\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+    group = g->gr_gid;
+    first = 3;
+  }
+  if (argc <= first + 1) {
+    std::fprintf(stderr, "Usage: %s [--group <name>] <socket> <module...>\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+  // blocked before any thread starts, so that only the signalfd sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigprocmask(SIG_BLOCK, &signals, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+  int signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+  if (signal_fd < 0) {
+    std::perror("signalfd");
+    return EXIT_FAILURE;
+  }
+  int listen_fd = listen_on(argv[first], group);
+  if (listen_fd < 0)
+    return EXIT_FAILURE;
+
+  int status = EXIT_SUCCESS;
+  try {
+    plugin_daemon daemon(listen_fd, signal_fd);
+    for (int i = first + 1; i < argc; i++)
+      daemon.add_module(argv[i]);
+    daemon.run();
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    status = EXIT_FAILURE;
+  }
+  close(listen_fd);
+  close(signal_fd);
+  unlink(argv[first]);
+  return status;
+}
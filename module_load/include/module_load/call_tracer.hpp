@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace modl {
+
+struct call_stats {
+  // the ABI function's symbol name
+  const char *name;
+  uint64_t calls;
+  std::chrono::nanoseconds total;
+  // percentiles are the upper bounds of histogram buckets that are at most
+  // an eighth wide, so they overestimate by less than 12.5%
+  std::chrono::nanoseconds p50;
+  std::chrono::nanoseconds p90;
+  std::chrono::nanoseconds p99;
+  std::chrono::nanoseconds max;
+};
+
+// Counts the calls made through loaded_module::functions and records their
+// latency per ABI function. Every thread records into histograms of its own,
+// which are folded into the report. Off by default; while off, a call costs
+// one relaxed load and a branch more.
+class call_tracer {
+public:
+  static void enable(bool) noexcept;
+  static bool enabled() noexcept;
+
+  // functions that were called at least once, most total time first
+  static std::vector<call_stats> report();
+  static void reset() noexcept;
+};
+
+} // namespace modl
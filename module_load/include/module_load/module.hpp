@@ -3,17 +3,77 @@
 #include <module_load/types.hpp>
 #include <module_load/version.hpp>
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <string>
 
 namespace modl {
 
+enum class binding {
+  // functions are resolved when first called; a missing one throws
+  // function_load_error from that call, which the wrapper's noexcept
+  // overloads cannot report, so only opt in for modules known to be complete
+  lazy,
+  // every function is resolved while loading, missing ones fail the load
+  eager,
+};
+
+// how the dynamic loader binds the library's own references, independently of
+// how module functions are looked up; only dlopen lets the host choose
+enum class relocation {
+  // while opening the library
+  immediate,
+  // as they are first used
+  deferred,
+};
+
+enum class isolation {
+  // the module is opened by the host process
+  in_process,
+  // the module is opened by a runner process, so that a crash in the plugin
+  // leaves the host running; calls then fail with PASMP_UNAVAILABLE
+  out_of_process,
+  // the module is opened by a PluginHostDaemon, shared with the other hosts
+  // connected to it, and must be one the daemon was started with; calls fail
+  // with PASMP_UNAVAILABLE once disconnected
+  daemon,
+};
+
+struct load_options {
+  binding bind = binding::eager;
+  relocation relocate = relocation::immediate;
+  isolation isolate = isolation::in_process;
+  // runner for out of process modules, PluginRunner next to the host
+  // executable if empty
+  std::filesystem::path runner;
+  // socket the daemon listens on, for daemon isolation
+  std::filesystem::path endpoint;
+};
+
+struct load_stats {
+  std::chrono::nanoseconds open;
+  std::chrono::nanoseconds version_check;
+  // keeps growing as lazily bound functions are first called
+  std::chrono::nanoseconds resolve;
+  uint32_t resolved;
+};
+
 class loaded_module {
 private:
+  friend class module_registry;
+
   struct impl;
   std::shared_ptr<const impl> handle_;
 
+  explicit loaded_module(std::shared_ptr<const impl>) noexcept;
+
+  // a non-empty copy is opened instead of the path, and removed once closed
+  static std::shared_ptr<const impl> open(const std::filesystem::path &,
+                                          const load_options &, uint32_t id,
+                                          std::filesystem::path copy = {});
+
 public:
   struct functions {
     version_create_t version_create;
@@ -44,7 +104,11 @@ public:
     action_collection_destroy_t action_collection_destroy;
     action_collection_size_t action_collection_size;
     action_collection_at_t action_collection_at;
+    action_collection_read_t action_collection_read;
     plugin_actions_t plugin_actions;
+    plugin_serialize_t plugin_serialize;
+    plugin_deserialize_t plugin_deserialize;
+    plugin_extract_t plugin_extract;
 
     plugin_configure_gui_t plugin_configure_gui;
     plugin_configure_cli_t plugin_configure_cli;
@@ -57,16 +121,32 @@ public:
     action_name_t action_name;
     action_description_t action_description;
     action_execute_t action_execute;
+    action_payload_type_t action_payload_type;
+    action_execute_int32_t action_execute_int32;
+    action_prepare_t action_prepare;
+    prepared_action_destroy_t prepared_action_destroy;
     action_execute_async_t action_execute_async;
+    action_execute_async_owned_t action_execute_async_owned;
     action_hash_t action_hash;
     action_equal_t action_equal;
 
+    plugin_limit_t plugin_limit;
+    action_limit_t action_limit;
+    action_admission_stats_t action_admission_stats;
+
     explicit functions(const impl &);
   };
 
-  explicit loaded_module(const std::filesystem::path &);
+  // same as module_registry::load
+  explicit loaded_module(const std::filesystem::path &, load_options = {});
 
+  // unique among the modules loaded during the lifetime of the process
+  uint32_t id() const noexcept;
   library_version version() const noexcept;
+  load_stats stats() const noexcept;
+  // false once the process hosting an isolated module has exited or
+  // disconnected
+  bool alive() const noexcept;
   const std::string &path() const noexcept;
   const std::string &filename() const noexcept;
   const functions &funcs() const noexcept;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <module_load/module.hpp>
+
+#include <cstddef>
+#include <filesystem>
+
+namespace modl {
+
+// Process-wide set of the loaded modules. Paths are canonicalized, so that
+// every load of the same file shares a single instance, and therefore a
+// single id, for as long as any loaded_module refers to it. Loads out of
+// process share instances of their own. Other options only apply to the load
+// that actually opens the library.
+class module_registry {
+public:
+  static loaded_module load(const std::filesystem::path &, load_options = {});
+
+  // Opens a private copy of the file in the temporary directory, bypassing
+  // both the registry and the dynamic loader's reuse of libraries by path, so
+  // that a file rebuilt in place is picked up while its previous build is
+  // still loaded. The copy is removed once the module is unloaded.
+  static loaded_module load_copy(const std::filesystem::path &,
+                                 load_options = {});
+
+  // number of modules currently loaded
+  static size_t size();
+
+private:
+  struct state;
+  static state &get_state();
+};
+
+} // namespace modl
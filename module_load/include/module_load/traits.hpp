@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 
 namespace modl {
 
@@ -25,8 +29,54 @@ struct module_function_traits_t<R(Args...)> {
 };
 
 template <auto Val>
-using module_function_traits =
-    module_function_traits_t<std::remove_pointer_t<decltype(Val)>>;
+struct module_function_traits
+    : module_function_traits_t<std::remove_pointer_t<decltype(Val)>> {
+  // only referenced, and therefore only needed at link time, when the plugin
+  // is linked into the host
+  static constexpr auto function = Val;
+};
+
+#if defined(PASMP_STATIC_PLUGIN)
+inline constexpr bool linked_plugin = true;
+#else
+inline constexpr bool linked_plugin = false;
+#endif
+
+// calls of one ABI function, see call_tracer
+struct trace_site {
+  const char *name;
+  std::atomic<uint32_t> slot = 0;
+};
+
+template <typename Traits> inline trace_site trace_site_of{Traits::name};
+
+extern std::atomic<bool> tracing;
+
+void record_call(trace_site &, std::chrono::nanoseconds) noexcept;
+
+template <typename Traits> struct traced_call {
+  using clock = std::chrono::steady_clock;
+  clock::time_point start = clock::now();
+  ~traced_call() { record_call(trace_site_of<Traits>, clock::now() - start); }
+};
+
+template <typename Traits, typename Pointer, typename... Args>
+typename Traits::return_type invoke(Pointer fn, Args &&...x) {
+  if (!tracing.load(std::memory_order_relaxed)) [[likely]]
+    return fn(std::forward<Args>(x)...);
+  traced_call<Traits> tc;
+  return fn(std::forward<Args>(x)...);
+}
+
+// looks up the functions that are bound on first use; throws if the symbol
+// is missing
+class function_binder {
+public:
+  virtual void *bind(const char *name) const = 0;
+
+protected:
+  ~function_binder() = default;
+};
 
 } // namespace detail
 
@@ -37,17 +87,84 @@ public:
   using pointer_type = typename traits::pointer_type;
 
   explicit module_function(pointer_type x) noexcept : value_(x) {}
+  // binds on first use, when a missing symbol throws function_load_error
+  explicit module_function(const detail::function_binder &b) noexcept
+      : value_(nullptr), binder_(&b) {}
+
+  module_function(const module_function &x) noexcept
+      : value_(x.value_.load(std::memory_order_acquire)), binder_(x.binder_) {}
+  module_function &operator=(const module_function &) = delete;
 
-  template <typename... Args> typename traits::return_type call(Args &&...x) {
-    return value_(std::forward<Args>(x)...);
+  template <typename... Args>
+  typename traits::return_type call(Args &&...x) const {
+    return detail::invoke<traits>(get(), std::forward<Args>(x)...);
   }
 
-  pointer_type get() const noexcept { return value_; }
-  pointer_type operator()() const noexcept { return value_; }
-  operator pointer_type() const noexcept { return value_; }
+  template <typename... Args>
+    requires(sizeof...(Args) > 0)
+  typename traits::return_type operator()(Args &&...x) const {
+    return call(std::forward<Args>(x)...);
+  }
+
+  pointer_type get() const {
+    if (auto p = value_.load(std::memory_order_acquire))
+      return p;
+    return bind();
+  }
+  pointer_type operator()() const { return get(); }
+  operator pointer_type() const { return get(); }
 
 private:
-  pointer_type value_;
+  // racing threads resolve the same address, so either store wins
+  pointer_type bind() const {
+    auto p = reinterpret_cast<pointer_type>(binder_->bind(traits::name));
+    value_.store(p, std::memory_order_release);
+    return p;
+  }
+
+  mutable std::atomic<pointer_type> value_;
+  const detail::function_binder *binder_ = nullptr;
 };
 
+// Calls the entry point of the plugin linked into the host, which the
+// compiler sees through and may inline. Same interface as module_function.
+template <typename Traits> struct linked_function {
+public:
+  using traits = Traits;
+  using type = typename traits::type;
+  using pointer_type = typename traits::pointer_type;
+
+  template <typename... Args>
+  typename traits::return_type call(Args &&...x) const {
+    return detail::invoke<traits>(traits::function, std::forward<Args>(x)...);
+  }
+
+  template <typename... Args>
+    requires(sizeof...(Args) > 0)
+  typename traits::return_type operator()(Args &&...x) const {
+    return call(std::forward<Args>(x)...);
+  }
+
+  constexpr pointer_type get() const noexcept { return traits::function; }
+  constexpr pointer_type operator()() const noexcept { return get(); }
+  constexpr operator pointer_type() const noexcept { return get(); }
+};
+
+namespace detail {
+
+template <typename Traits, bool Linked> struct function_backend {
+  using type = module_function<Traits>;
+};
+
+template <typename Traits> struct function_backend<Traits, true> {
+  using type = linked_function<Traits>;
+};
+
+} // namespace detail
+
+// linked_function if built with PASMP_STATIC_PLUGIN, module_function otherwise
+template <typename Traits>
+using bound_function =
+    typename detail::function_backend<Traits, detail::linked_plugin>::type;
+
 } // namespace modl
@@ -127,11 +127,26 @@ struct action_collection_at_tr
   static constexpr char name[] = "PASMP_action_collection_at";
 };
 
+struct action_collection_read_tr
+    : detail::module_function_traits<PASMP_action_collection_read> {
+  static constexpr char name[] = "PASMP_action_collection_read";
+};
+
 struct plugin_actions_tr
     : detail::module_function_traits<PASMP_plugin_actions> {
   static constexpr char name[] = "PASMP_plugin_actions";
 };
 
+struct plugin_serialize_tr
+    : detail::module_function_traits<PASMP_plugin_serialize> {
+  static constexpr char name[] = "PASMP_plugin_serialize";
+};
+
+struct plugin_deserialize_tr
+    : detail::module_function_traits<PASMP_plugin_deserialize> {
+  static constexpr char name[] = "PASMP_plugin_deserialize";
+};
+
 struct plugin_configure_gui_tr
     : detail::module_function_traits<PASMP_plugin_configure_gui> {
   static constexpr char name[] = "PASMP_plugin_configure_gui";
@@ -142,6 +157,11 @@ struct plugin_configure_cli_tr
   static constexpr char name[] = "PASMP_plugin_configure_cli";
 };
 
+struct plugin_extract_tr
+    : detail::module_function_traits<PASMP_plugin_extract> {
+  static constexpr char name[] = "PASMP_plugin_extract";
+};
+
 struct action_serialize_tr
     : detail::module_function_traits<PASMP_action_serialize> {
   static constexpr char name[] = "PASMP_action_serialize";
@@ -181,11 +201,36 @@ struct action_execute_tr
   static constexpr char name[] = "PASMP_action_execute";
 };
 
+struct action_payload_type_tr
+    : detail::module_function_traits<PASMP_action_payload_type> {
+  static constexpr char name[] = "PASMP_action_payload_type";
+};
+
+struct action_execute_int32_tr
+    : detail::module_function_traits<PASMP_action_execute_int32> {
+  static constexpr char name[] = "PASMP_action_execute_int32";
+};
+
+struct action_prepare_tr
+    : detail::module_function_traits<PASMP_action_prepare> {
+  static constexpr char name[] = "PASMP_action_prepare";
+};
+
+struct prepared_action_destroy_tr
+    : detail::module_function_traits<PASMP_prepared_action_destroy> {
+  static constexpr char name[] = "PASMP_prepared_action_destroy";
+};
+
 struct action_execute_async_tr
     : detail::module_function_traits<PASMP_action_execute_async> {
   static constexpr char name[] = "PASMP_action_execute_async";
 };
 
+struct action_execute_async_owned_tr
+    : detail::module_function_traits<PASMP_action_execute_async_owned> {
+  static constexpr char name[] = "PASMP_action_execute_async_owned";
+};
+
 struct action_hash_tr : detail::module_function_traits<PASMP_action_hash> {
   static constexpr char name[] = "PASMP_action_hash";
 };
@@ -194,58 +239,86 @@ struct action_equal_tr : detail::module_function_traits<PASMP_action_equal> {
   static constexpr char name[] = "PASMP_action_equal";
 };
 
-using version_t = module_function<version_tr>;
-using is_compatible_t = module_function<is_compatible_tr>;
+struct plugin_limit_tr : detail::module_function_traits<PASMP_plugin_limit> {
+  static constexpr char name[] = "PASMP_plugin_limit";
+};
+
+struct action_limit_tr : detail::module_function_traits<PASMP_action_limit> {
+  static constexpr char name[] = "PASMP_action_limit";
+};
+
+struct action_admission_stats_tr
+    : detail::module_function_traits<PASMP_action_admission_stats> {
+  static constexpr char name[] = "PASMP_action_admission_stats";
+};
+
+using version_t = bound_function<version_tr>;
+using is_compatible_t = bound_function<is_compatible_tr>;
 
-using version_create_t = module_function<version_create_tr>;
-using version_destroy_t = module_function<version_destroy_tr>;
-using version_major_t = module_function<version_major_tr>;
-using version_minor_t = module_function<version_minor_tr>;
-using version_patch_t = module_function<version_patch_tr>;
-using version_pre_t = module_function<version_pre_tr>;
-using version_build_t = module_function<version_build_tr>;
+using version_create_t = bound_function<version_create_tr>;
+using version_destroy_t = bound_function<version_destroy_tr>;
+using version_major_t = bound_function<version_major_tr>;
+using version_minor_t = bound_function<version_minor_tr>;
+using version_patch_t = bound_function<version_patch_tr>;
+using version_pre_t = bound_function<version_pre_tr>;
+using version_build_t = bound_function<version_build_tr>;
 
-using plugin_attr_create_t = module_function<plugin_attr_create_tr>;
-using plugin_attr_destroy_t = module_function<plugin_attr_destroy_tr>;
+using plugin_attr_create_t = bound_function<plugin_attr_create_tr>;
+using plugin_attr_destroy_t = bound_function<plugin_attr_destroy_tr>;
 using plugin_attr_on_action_mod_t =
-    module_function<plugin_attr_on_action_mod_tr>;
+    bound_function<plugin_attr_on_action_mod_tr>;
 using plugin_attr_on_action_add_t =
-    module_function<plugin_attr_on_action_add_tr>;
-using plugin_attr_on_action_rm_t = module_function<plugin_attr_on_action_rm_tr>;
+    bound_function<plugin_attr_on_action_add_tr>;
+using plugin_attr_on_action_rm_t = bound_function<plugin_attr_on_action_rm_tr>;
 using plugin_attr_persistence_path_t =
-    module_function<plugin_attr_persistence_path_tr>;
+    bound_function<plugin_attr_persistence_path_tr>;
 
-using plugin_create_t = module_function<plugin_create_tr>;
-using plugin_addref_t = module_function<plugin_addref_tr>;
-using plugin_release_t = module_function<plugin_release_tr>;
+using plugin_create_t = bound_function<plugin_create_tr>;
+using plugin_addref_t = bound_function<plugin_addref_tr>;
+using plugin_release_t = bound_function<plugin_release_tr>;
 
-using plugin_descriptor_create_t = module_function<plugin_descriptor_create_tr>;
+using plugin_descriptor_create_t = bound_function<plugin_descriptor_create_tr>;
 using plugin_descriptor_destroy_t =
-    module_function<plugin_descriptor_destroy_tr>;
-using plugin_name_t = module_function<plugin_name_tr>;
-using plugin_description_t = module_function<plugin_description_tr>;
+    bound_function<plugin_descriptor_destroy_tr>;
+using plugin_name_t = bound_function<plugin_name_tr>;
+using plugin_description_t = bound_function<plugin_description_tr>;
 
-using action_collection_create_t = module_function<action_collection_create_tr>;
+using action_collection_create_t = bound_function<action_collection_create_tr>;
 using action_collection_destroy_t =
-    module_function<action_collection_destroy_tr>;
-using action_collection_size_t = module_function<action_collection_size_tr>;
-using action_collection_at_t = module_function<action_collection_at_tr>;
-using plugin_actions_t = module_function<plugin_actions_tr>;
-
-using plugin_configure_gui_t = module_function<plugin_configure_gui_tr>;
-using plugin_configure_cli_t = module_function<plugin_configure_cli_tr>;
-
-using action_serialize_t = module_function<action_serialize_tr>;
-using action_deserialize_t = module_function<action_deserialize_tr>;
-using action_destroy_t = module_function<action_destroy_tr>;
-using action_descriptor_create_t = module_function<action_descriptor_create_tr>;
+    bound_function<action_collection_destroy_tr>;
+using action_collection_size_t = bound_function<action_collection_size_tr>;
+using action_collection_at_t = bound_function<action_collection_at_tr>;
+using action_collection_read_t = bound_function<action_collection_read_tr>;
+using plugin_actions_t = bound_function<plugin_actions_tr>;
+
+using plugin_serialize_t = bound_function<plugin_serialize_tr>;
+using plugin_deserialize_t = bound_function<plugin_deserialize_tr>;
+using plugin_extract_t = bound_function<plugin_extract_tr>;
+
+using plugin_configure_gui_t = bound_function<plugin_configure_gui_tr>;
+using plugin_configure_cli_t = bound_function<plugin_configure_cli_tr>;
+
+using action_serialize_t = bound_function<action_serialize_tr>;
+using action_deserialize_t = bound_function<action_deserialize_tr>;
+using action_destroy_t = bound_function<action_destroy_tr>;
+using action_descriptor_create_t = bound_function<action_descriptor_create_tr>;
 using action_descriptor_destroy_t =
-    module_function<action_descriptor_destroy_tr>;
-using action_name_t = module_function<action_name_tr>;
-using action_description_t = module_function<action_description_tr>;
-using action_execute_t = module_function<action_execute_tr>;
-using action_execute_async_t = module_function<action_execute_async_tr>;
-using action_hash_t = module_function<action_hash_tr>;
-using action_equal_t = module_function<action_equal_tr>;
+    bound_function<action_descriptor_destroy_tr>;
+using action_name_t = bound_function<action_name_tr>;
+using action_description_t = bound_function<action_description_tr>;
+using action_execute_t = bound_function<action_execute_tr>;
+using action_payload_type_t = bound_function<action_payload_type_tr>;
+using action_execute_int32_t = bound_function<action_execute_int32_tr>;
+using action_prepare_t = bound_function<action_prepare_tr>;
+using prepared_action_destroy_t = bound_function<prepared_action_destroy_tr>;
+using action_execute_async_t = bound_function<action_execute_async_tr>;
+using action_execute_async_owned_t =
+    bound_function<action_execute_async_owned_tr>;
+using action_hash_t = bound_function<action_hash_tr>;
+using action_equal_t = bound_function<action_equal_tr>;
+
+using plugin_limit_t = bound_function<plugin_limit_tr>;
+using action_limit_t = bound_function<action_limit_tr>;
+using action_admission_stats_t = bound_function<action_admission_stats_tr>;
 
 } // namespace modl
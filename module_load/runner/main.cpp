@@ -0,0 +1,141 @@
+// Hosts a module on behalf of another process, see modl::isolation.
+// Usage: PluginRunner <module> <shared memory name>
+
+#include "../src/remote_dispatch.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace remote = modl::detail::remote;
+
+constexpr size_t worker_count = 4;
+
+// events go to the ring of the segment, in the order they are pushed
+class event_ring final : public remote::event_sink {
+public:
+  explicit event_ring(remote::segment &seg) : seg_(seg) {}
+
+  void push(const remote::event &ev) noexcept override {
+    std::scoped_lock lk(mtx_);
+    auto head = seg_.event_head.load(std::memory_order_relaxed);
+    for (auto tail = seg_.event_tail.load(std::memory_order_acquire);
+         head - tail >= remote::event_count;
+         tail = seg_.event_tail.load(std::memory_order_acquire))
+      if (!remote::wait_while(seg_.event_tail, seg_.event_waiters, tail,
+                              [this]() { return !seg_.stop.load(); }))
+        return;
+    seg_.events[head % remote::event_count] = ev;
+    remote::publish(seg_.event_head, seg_.event_waiters, head + 1);
+  }
+
+private:
+  remote::segment &seg_;
+  std::mutex mtx_;
+};
+
+class runner {
+public:
+  runner(remote::segment &seg, const remote::hosted_module &host)
+      : seg_(seg), dispatch_(host),
+        events_(std::make_shared<event_ring>(seg)) {}
+
+  void run() {
+    std::vector<std::jthread> workers;
+    for (size_t i = 0; i < worker_count; i++)
+      workers.emplace_back([this]() { serve(); });
+    remote::publish(seg_.started, seg_.event_waiters, remote::start_ok);
+    while (!stopping()) {
+      remote::futex_wait(seg_.stop, 0, std::chrono::seconds(1));
+      // the host may crash as well, which must not leave the runner behind
+      if (!host_alive())
+        std::_Exit(EXIT_FAILURE);
+    }
+  }
+
+private:
+  bool stopping() const noexcept { return seg_.stop.load(); }
+
+  bool host_alive() const noexcept { return getppid() == seg_.host_pid; }
+
+  void serve() noexcept {
+    auto keep_waiting = [this]() { return !stopping(); };
+    while (!stopping()) {
+      auto ticket = seg_.tail.fetch_add(1, std::memory_order_relaxed);
+      auto &s = seg_.slots[ticket % remote::slot_count];
+      while (true) {
+        uint32_t st = s.state.load(std::memory_order_acquire);
+        if (st == remote::slot_ready &&
+            s.state.compare_exchange_strong(st, remote::slot_running,
+                                            std::memory_order_acquire))
+          break;
+        if (!remote::wait_while(s.state, s.waiters, st, keep_waiting))
+          return;
+      }
+      if (s.code == remote::op::noop) {
+        remote::publish(s.state, s.waiters, remote::slot_free);
+        continue;
+      }
+      dispatch_(s, events_);
+      remote::publish(s.state, s.waiters, remote::slot_done);
+    }
+  }
+
+  remote::segment &seg_;
+  remote::dispatcher dispatch_;
+  std::shared_ptr<remote::event_sink> events_;
+};
+
+void fail(remote::segment &seg, std::string_view msg) {
+  auto n = std::min(msg.size(), sizeof(seg.load_error) - 1);
+  std::memcpy(seg.load_error, msg.data(), n);
+  seg.load_error[n] = 0;
+  remote::publish(seg.started, seg.event_waiters, remote::start_failed);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::fprintf(stderr, "Usage: %s <module> <shared memory name>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  int fd = shm_open(argv[2], O_RDWR, 0);
+  if (fd < 0) {
+    std::perror("shm_open");
+    return EXIT_FAILURE;
+  }
+  void *addr = mmap(nullptr, sizeof(remote::segment), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::perror("mmap");
+    return EXIT_FAILURE;
+  }
+  auto &seg = *static_cast<remote::segment *>(addr);
+  // the host may already be gone
+  if (seg.magic != remote::magic || getppid() != seg.host_pid)
+    return EXIT_FAILURE;
+
+  try {
+    remote::hosted_module host(argv[1]);
+    seg.plugin_version = host.plugin_version;
+    runner(seg, host).run();
+  } catch (const std::exception &e) {
+    fail(seg, e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+#include <module_load/call_tracer.hpp>
+#include <module_load/traits.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// log-linear buckets: every value below 8ns has a bucket of its own, every
+// later power of two is split into 8
+constexpr unsigned sub_bits = 3;
+constexpr uint64_t sub_count = uint64_t{1} << sub_bits;
+constexpr size_t bucket_count = (64 - sub_bits + 1) * sub_count;
+
+size_t bucket_of(uint64_t ns) noexcept {
+  if (ns < sub_count)
+    return ns;
+  unsigned e = std::bit_width(ns) - 1;
+  return (e - sub_bits + 1) * sub_count +
+         ((ns >> (e - sub_bits)) & (sub_count - 1));
+}
+
+uint64_t upper_bound_of(size_t bucket) noexcept {
+  if (bucket < sub_count)
+    return bucket;
+  unsigned e = bucket / sub_count + sub_bits - 1;
+  uint64_t width = uint64_t{1} << (e - sub_bits);
+  return (sub_count + bucket % sub_count) * width + (width - 1);
+}
+
+struct histogram {
+  std::array<std::atomic<uint64_t>, bucket_count> buckets{};
+  std::atomic<uint64_t> calls = 0;
+  std::atomic<uint64_t> total = 0;
+  std::atomic<uint64_t> max = 0;
+
+  void record(uint64_t ns) noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    buckets[bucket_of(ns)].fetch_add(1, relaxed);
+    calls.fetch_add(1, relaxed);
+    total.fetch_add(ns, relaxed);
+    auto m = max.load(relaxed);
+    while (ns > m && !max.compare_exchange_weak(m, ns, relaxed))
+      ;
+  }
+
+  void add_to(histogram &x) const noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    for (size_t i = 0; i < bucket_count; i++)
+      x.buckets[i].fetch_add(buckets[i].load(relaxed), relaxed);
+    x.calls.fetch_add(calls.load(relaxed), relaxed);
+    x.total.fetch_add(total.load(relaxed), relaxed);
+    x.max.store(std::max(x.max.load(relaxed), max.load(relaxed)), relaxed);
+  }
+
+  void clear() noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    for (auto &b : buckets)
+      b.store(0, relaxed);
+    calls.store(0, relaxed);
+    total.store(0, relaxed);
+    max.store(0, relaxed);
+  }
+
+  std::chrono::nanoseconds percentile(uint64_t count, double q) const noexcept {
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(count * q + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; i++) {
+      seen += buckets[i].load(std::memory_order_relaxed);
+      if (seen >= rank)
+        return std::chrono::nanoseconds(upper_bound_of(i));
+    }
+    return std::chrono::nanoseconds(max.load(std::memory_order_relaxed));
+  }
+};
+
+using histograms = std::vector<std::unique_ptr<histogram>>;
+
+struct thread_log;
+
+struct tracer_state {
+  // guards every table below as well as the growth of each thread's log; a
+  // thread records into its own histograms without it
+  std::mutex mtx;
+  // site of slot x is at x - 1, as is its histogram in every table
+  std::vector<modl::detail::trace_site *> sites;
+  std::vector<thread_log *> threads;
+  // folded histograms of the threads that have exited
+  histograms retired;
+};
+
+tracer_state &get_state() {
+  static tracer_state x;
+  return x;
+}
+
+histogram &slot_of(histograms &h, uint32_t slot) {
+  if (h.size() < slot)
+    h.resize(slot);
+  auto &p = h[slot - 1];
+  if (!p)
+    p = std::make_unique<histogram>();
+  return *p;
+}
+
+struct thread_log {
+  histograms by_slot;
+
+  thread_log() {
+    auto &st = get_state();
+    std::scoped_lock lk(st.mtx);
+    st.threads.push_back(this);
+  }
+
+  ~thread_log() {
+    auto &st = get_state();
+    std::scoped_lock lk(st.mtx);
+    std::erase(st.threads, this);
+    try {
+      for (uint32_t i = 0; i < by_slot.size(); i++)
+        if (by_slot[i])
+          by_slot[i]->add_to(slot_of(st.retired, i + 1));
+    } catch (const std::bad_alloc &) {
+      // the calls of this thread are lost to the report
+    }
+  }
+
+  histogram &at(uint32_t slot) {
+    if (slot <= by_slot.size() && by_slot[slot - 1])
+      return *by_slot[slot - 1];
+    std::scoped_lock lk(get_state().mtx);
+    return slot_of(by_slot, slot);
+  }
+};
+
+uint32_t assign_slot(modl::detail::trace_site &site) {
+  auto &st = get_state();
+  std::scoped_lock lk(st.mtx);
+  if (auto slot = site.slot.load(std::memory_order_relaxed))
+    return slot;
+  st.sites.push_back(&site);
+  auto slot = static_cast<uint32_t>(st.sites.size());
+  site.slot.store(slot, std::memory_order_release);
+  return slot;
+}
+
+} // namespace
+
+namespace modl {
+
+namespace detail {
+
+std::atomic<bool> tracing = false;
+
+void record_call(trace_site &site, std::chrono::nanoseconds d) noexcept {
+  try {
+    auto slot = site.slot.load(std::memory_order_acquire);
+    if (!slot)
+      slot = assign_slot(site);
+    thread_local thread_log log;
+    log.at(slot).record(static_cast<uint64_t>(d.count()));
+  } catch (const std::bad_alloc &) {
+    // the call goes unrecorded
+  }
+}
+
+} // namespace detail
+
+void call_tracer::enable(bool on) noexcept {
+  detail::tracing.store(on, std::memory_order_relaxed);
+}
+
+bool call_tracer::enabled() noexcept {
+  return detail::tracing.load(std::memory_order_relaxed);
+}
+
+std::vector<call_stats> call_tracer::report() {
+  auto &st = get_state();
+  std::vector<call_stats> retval;
+  std::scoped_lock lk(st.mtx);
+  for (uint32_t i = 0; i < st.sites.size(); i++) {
+    histogram sum;
+    if (i < st.retired.size() && st.retired[i])
+      st.retired[i]->add_to(sum);
+    for (const auto *t : st.threads)
+      if (i < t->by_slot.size() && t->by_slot[i])
+        t->by_slot[i]->add_to(sum);
+    // counts are read while threads keep recording, so go by the buckets
+    uint64_t calls = 0;
+    for (const auto &b : sum.buckets)
+      calls += b.load(std::memory_order_relaxed);
+    if (!calls)
+      continue;
+    retval.push_back(
+        {.name = st.sites[i]->name,
+         .calls = calls,
+         .total = std::chrono::nanoseconds(sum.total.load()),
+         .p50 = sum.percentile(calls, 0.50),
+         .p90 = sum.percentile(calls, 0.90),
+         .p99 = sum.percentile(calls, 0.99),
+         .max = std::chrono::nanoseconds(sum.max.load())});
+  }
+  std::sort(retval.begin(), retval.end(),
+            [](const call_stats &lhs, const call_stats &rhs) {
+              return lhs.total > rhs.total;
+            });
+  return retval;
+}
+
+void call_tracer::reset() noexcept {
+  auto &st = get_state();
+  std::scoped_lock lk(st.mtx);
+  for (auto &h : st.retired)
+    if (h)
+      h->clear();
+  for (auto *t : st.threads)
+    for (auto &h : t->by_slot)
+      if (h)
+        h->clear();
+}
+
+} // namespace modl
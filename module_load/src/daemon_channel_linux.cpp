@@ -0,0 +1,402 @@
+#include "remote_channel.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+namespace remote = modl::detail::remote;
+
+std::system_error last_system_error(const char *what) {
+  return {std::error_code(errno, std::system_category()), what};
+}
+
+bool write_all(int fd, const char *first, size_t size) noexcept {
+  while (size) {
+    auto n = send(fd, first, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    first += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool read_all(int fd, char *first, size_t size) noexcept {
+  while (size) {
+    auto n = recv(fd, first, size, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    first += n;
+    size -= n;
+  }
+  return true;
+}
+
+template <typename T> void append(std::vector<char> &out, const T &x) {
+  auto *bytes = reinterpret_cast<const char *>(&x);
+  out.insert(out.end(), bytes, bytes + sizeof(x));
+}
+
+// Requests are sent as frames over a connection to the daemon and may be in
+// flight together. Callers append their frames to a shared buffer and the
+// first one to find no write in progress sends the whole buffer, taking along
+// whatever the others append meanwhile. Responses are matched to their
+// requests by id on a reader thread; events are delivered on a thread of
+// their own, so that callbacks can make calls.
+class daemon_channel final : public modl::detail::remote_library::channel {
+public:
+  daemon_channel(const std::filesystem::path &socket,
+                 const std::filesystem::path &module);
+  ~daemon_channel() override;
+
+  bool alive() const noexcept override {
+    return connected_.load(std::memory_order_acquire);
+  }
+
+  uint32_t plugin_version() const noexcept override { return version_; }
+
+  remote::slot *acquire() noexcept override;
+  bool exchange(remote::slot &) noexcept override;
+  void release(remote::slot &, bool exchanged) noexcept override;
+
+private:
+  void open(const std::string &module);
+  bool send(const remote::frame_header &, const remote::call_header &,
+            const char *data) noexcept;
+  void read_frames() noexcept;
+  bool complete(uint64_t id, const char *body, size_t size) noexcept;
+  void disconnect() noexcept;
+  void dispatch_events() noexcept;
+
+  int fd_ = -1;
+  uint32_t version_ = 0;
+  std::atomic<bool> connected_ = true;
+
+  std::mutex slots_mtx_;
+  std::vector<std::unique_ptr<remote::slot>> slots_;
+  std::vector<remote::slot *> free_;
+
+  std::mutex pending_mtx_;
+  uint64_t next_id_ = 1;
+  std::unordered_map<uint64_t, remote::slot *> pending_;
+
+  std::mutex out_mtx_;
+  bool flushing_ = false;
+  std::vector<char> out_;
+  std::vector<char> flush_;
+
+  std::mutex events_mtx_;
+  std::condition_variable events_cv_;
+  std::deque<remote::event> events_;
+  bool stopping_ = false;
+  bool disconnected_ = false;
+
+  std::jthread reader_;
+  std::jthread delivery_;
+};
+
+daemon_channel::daemon_channel(const std::filesystem::path &socket,
+                               const std::filesystem::path &module) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  auto endpoint = socket.string();
+  if (endpoint.empty() || endpoint.size() >= sizeof(addr.sun_path))
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                            "Invalid plugin host daemon endpoint");
+  std::memcpy(addr.sun_path, endpoint.data(), endpoint.size());
+  fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0)
+    throw last_system_error("Error creating plugin host daemon connection");
+  try {
+    if (connect(fd_, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)))
+      throw last_system_error("Error connecting to plugin host daemon");
+    // the daemon resolves the path from its own working directory
+    open(std::filesystem::absolute(module).string());
+  } catch (...) {
+    close(fd_);
+    throw;
+  }
+  reader_ = std::jthread([this]() { read_frames(); });
+  delivery_ = std::jthread([this]() { dispatch_events(); });
+}
+
+void daemon_channel::open(const std::string &module) {
+  if (module.size() > remote::frame_capacity)
+    throw std::system_error(std::make_error_code(std::errc::filename_too_long),
+                            "Error opening module in plugin host daemon");
+  std::vector<char> request;
+  append(request, remote::frame_header{static_cast<uint32_t>(module.size()),
+                                       remote::frame_kind::open, 0});
+  request.insert(request.end(), module.begin(), module.end());
+  remote::frame_header h;
+  remote::call_header c;
+  if (!write_all(fd_, request.data(), request.size()) ||
+      !read_all(fd_, reinterpret_cast<char *>(&h), sizeof(h)) ||
+      h.kind != remote::frame_kind::open || h.size < sizeof(c) ||
+      h.size > remote::frame_capacity ||
+      !read_all(fd_, reinterpret_cast<char *>(&c), sizeof(c)))
+    throw std::system_error(std::make_error_code(std::errc::io_error),
+                            "Plugin host daemon closed the connection");
+  std::string error(h.size - sizeof(c), '\0');
+  if (!read_all(fd_, error.data(), error.size()))
+    throw std::system_error(std::make_error_code(std::errc::io_error),
+                            "Plugin host daemon closed the connection");
+  if (c.status)
+    throw std::system_error(std::make_error_code(std::errc::io_error), error);
+  version_ = static_cast<uint32_t>(c.args[0]);
+}
+
+daemon_channel::~daemon_channel() {
+  shutdown(fd_, SHUT_RDWR);
+  reader_.join();
+  {
+    std::scoped_lock lk(events_mtx_);
+    stopping_ = true;
+  }
+  events_cv_.notify_one();
+  delivery_.join();
+  close(fd_);
+}
+
+remote::slot *daemon_channel::acquire() noexcept {
+  if (!alive())
+    return nullptr;
+  std::scoped_lock lk(slots_mtx_);
+  remote::slot *s;
+  if (!free_.empty()) {
+    s = free_.back();
+    free_.pop_back();
+  } else {
+    try {
+      free_.reserve(slots_.size() + 1);
+      s = slots_.emplace_back(std::make_unique<remote::slot>()).get();
+    } catch (const std::bad_alloc &) {
+      return nullptr;
+    }
+  }
+  s->state.store(remote::slot_writing, std::memory_order_relaxed);
+  return s;
+}
+
+bool daemon_channel::exchange(remote::slot &s) noexcept {
+  remote::call_header c{s.code, PASMP_SUCCESS, {}, s.error_size, 0,
+                        s.data_size};
+  std::memcpy(c.args, s.args, sizeof(c.args));
+  remote::frame_header h{static_cast<uint32_t>(sizeof(c) + s.data_size),
+                         remote::frame_kind::call, 0};
+  // the response may arrive before send returns
+  s.state.store(remote::slot_ready, std::memory_order_relaxed);
+  {
+    std::scoped_lock lk(pending_mtx_);
+    if (!alive())
+      return false;
+    h.id = next_id_++;
+    try {
+      pending_.emplace(h.id, &s);
+    } catch (const std::bad_alloc &) {
+      return false;
+    }
+  }
+  if (!send(h, c, s.data)) {
+    std::scoped_lock lk(pending_mtx_);
+    if (pending_.erase(h.id))
+      return false;
+  }
+  auto keep_waiting = [this]() { return alive(); };
+  if (!remote::wait_while(s.state, s.waiters, remote::slot_ready,
+                          keep_waiting)) {
+    // the reader may still be abandoning the slot
+    std::scoped_lock lk(pending_mtx_);
+  }
+  return s.state.load(std::memory_order_acquire) == remote::slot_done;
+}
+
+void daemon_channel::release(remote::slot &s, bool) noexcept {
+  std::scoped_lock lk(slots_mtx_);
+  s.state.store(remote::slot_free, std::memory_order_relaxed);
+  free_.push_back(&s);
+}
+
+bool daemon_channel::send(const remote::frame_header &h,
+                          const remote::call_header &c,
+                          const char *data) noexcept {
+  std::unique_lock lk(out_mtx_);
+  try {
+    append(out_, h);
+    append(out_, c);
+    out_.insert(out_.end(), data, data + c.data_size);
+  } catch (const std::bad_alloc &) {
+    return false;
+  }
+  if (flushing_)
+    return true;
+  flushing_ = true;
+  bool ok = true;
+  while (ok && !out_.empty()) {
+    std::swap(out_, flush_);
+    lk.unlock();
+    ok = write_all(fd_, flush_.data(), flush_.size());
+    flush_.clear();
+    lk.lock();
+  }
+  flushing_ = false;
+  if (!ok) {
+    out_.clear();
+    // the reader then abandons whatever is pending
+    shutdown(fd_, SHUT_RDWR);
+  }
+  return ok;
+}
+
+void daemon_channel::read_frames() noexcept {
+  constexpr size_t max_frame =
+      sizeof(remote::frame_header) + remote::frame_capacity;
+  std::vector<char> buf;
+  try {
+    buf.resize(2 * max_frame);
+  } catch (const std::bad_alloc &) {
+    disconnect();
+    return;
+  }
+  size_t first = 0, last = 0;
+  while (true) {
+    while (last - first >= sizeof(remote::frame_header)) {
+      remote::frame_header h;
+      std::memcpy(&h, buf.data() + first, sizeof(h));
+      if (h.size > remote::frame_capacity) {
+        disconnect();
+        return;
+      }
+      if (last - first < sizeof(h) + h.size)
+        break;
+      const char *body = buf.data() + first + sizeof(h);
+      if (h.kind == remote::frame_kind::event) {
+        remote::event ev{};
+        std::memcpy(&ev, body, std::min<size_t>(h.size, sizeof(ev)));
+        ev.message_size =
+            std::min<uint64_t>(ev.message_size, remote::message_capacity);
+        try {
+          std::scoped_lock lk(events_mtx_);
+          events_.push_back(ev);
+        } catch (const std::bad_alloc &) {
+        }
+        events_cv_.notify_one();
+      } else if (!complete(h.id, body, h.size)) {
+        disconnect();
+        return;
+      }
+      first += sizeof(h) + h.size;
+    }
+    if (first == last) {
+      first = last = 0;
+    } else if (buf.size() - last < max_frame) {
+      std::memmove(buf.data(), buf.data() + first, last - first);
+      last -= first;
+      first = 0;
+    }
+    auto n = recv(fd_, buf.data() + last, buf.size() - last, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    last += n;
+  }
+  disconnect();
+}
+
+bool daemon_channel::complete(uint64_t id, const char *body,
+                              size_t size) noexcept {
+  remote::call_header c;
+  if (size < sizeof(c))
+    return false;
+  std::memcpy(&c, body, sizeof(c));
+  if (c.error_length > remote::error_capacity ||
+      c.data_size > remote::data_capacity ||
+      sizeof(c) + c.error_length + c.data_size > size)
+    return false;
+  std::scoped_lock lk(pending_mtx_);
+  auto it = pending_.find(id);
+  if (it == pending_.end())
+    return true;
+  auto &s = *it->second;
+  pending_.erase(it);
+  s.status = c.status;
+  std::memcpy(s.args, c.args, sizeof(s.args));
+  s.error_size = c.error_size;
+  std::memcpy(s.error, body + sizeof(c), c.error_length);
+  std::memcpy(s.data, body + sizeof(c) + c.error_length, c.data_size);
+  s.data_size = c.data_size;
+  remote::publish(s.state, s.waiters, remote::slot_done);
+  return true;
+}
+
+void daemon_channel::disconnect() noexcept {
+  {
+    std::scoped_lock lk(pending_mtx_);
+    connected_.store(false, std::memory_order_release);
+    // anything but slot_done tells the caller that no response came
+    for (auto [id, s] : pending_)
+      remote::publish(s->state, s->waiters, remote::slot_running);
+    pending_.clear();
+  }
+  // the completions are failed by the delivery thread, behind the events
+  // that were received before
+  {
+    std::scoped_lock lk(events_mtx_);
+    disconnected_ = true;
+  }
+  events_cv_.notify_one();
+}
+
+void daemon_channel::dispatch_events() noexcept {
+  std::unique_lock lk(events_mtx_);
+  while (true) {
+    events_cv_.wait(lk, [this]() {
+      return stopping_ || disconnected_ || !events_.empty();
+    });
+    if (events_.empty() && disconnected_) {
+      disconnected_ = false;
+      lk.unlock();
+      fail_completions("Plugin host daemon disconnected");
+      lk.lock();
+      continue;
+    }
+    if (events_.empty())
+      return;
+    auto ev = events_.front();
+    events_.pop_front();
+    lk.unlock();
+    deliver(ev);
+    lk.lock();
+  }
+}
+
+} // namespace
+
+namespace modl::detail {
+
+remote_library::channel_ptr
+connect_daemon(const std::filesystem::path &socket,
+               const std::filesystem::path &module) {
+  return remote_library::channel_ptr(new daemon_channel(socket, module));
+}
+
+} // namespace modl::detail
@@ -1,12 +1,15 @@
 #include <module_load/exception.hpp>
 #include <module_load/module.hpp>
+#include <module_load/module_registry.hpp>
 
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-#include <libloaderapi.h>
+#include "remote_library.hpp"
+#include "shared_library.hpp"
 
-#include <cassert>
-#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <system_error>
+#include <type_traits>
+#include <variant>
 
 namespace {
 
@@ -49,69 +52,175 @@ constexpr auto is_module_function_traits_v =
 
 } // namespace detail
 
-std::error_code get_last_error() noexcept {
-  return {static_cast<int>(GetLastError()), std::system_category()};
+using clock = std::chrono::steady_clock;
+
+std::chrono::nanoseconds since(clock::time_point start) noexcept {
+  return clock::now() - start;
+}
+
+modl::library_version to_library_version(uint32_t ver) noexcept {
+  return {.major = static_cast<uint16_t>((ver >> 16) & 0xffff),
+          .minor = static_cast<uint16_t>(ver & 0xffff)};
 }
 
 } // namespace
 
 namespace modl {
 
-struct loaded_module::impl {
-  using module_t = std::remove_pointer_t<HMODULE>;
+struct loaded_module::impl final : modl::detail::function_binder {
+  // the plugin linked into the host has no library to open
+  using library_t = std::conditional_t<
+      modl::detail::linked_plugin, std::monostate,
+      std::variant<modl::detail::shared_library, modl::detail::remote_library>>;
 
-  module_t *module_ = nullptr;
+  load_options options_;
   std::string path_;
   std::string filename_;
+  std::chrono::nanoseconds open_time_{};
+  std::chrono::nanoseconds version_time_{};
+  mutable std::atomic<int64_t> resolve_ns_ = 0;
+  mutable std::atomic<uint32_t> resolved_ = 0;
+
+  uint32_t id_;
+  // opening the library is timed from here up to get_version()
+  clock::time_point open_start_;
+  // declared before the library, so that it is only removed once closed
+  struct scratch_file {
+    std::filesystem::path path;
+    ~scratch_file() {
+      std::error_code ec;
+      if (!path.empty())
+        std::filesystem::remove(path, ec);
+    }
+  } copy_;
+  library_t library_;
   library_version version_;
   loaded_module::functions funcs_;
 
-  explicit impl(const std::filesystem::path &path)
-      : module_(load_library(path)),
-        path_(std::filesystem::relative(path).string()),
-        filename_(path.filename().string()), version_(get_version()),
-        funcs_(*this) {}
+  impl(const std::filesystem::path &path, const load_options &opts,
+       uint32_t id, std::filesystem::path copy)
+      : options_(opts), path_(std::filesystem::relative(path).string()),
+        filename_(path.filename().string()), id_(id), open_start_(clock::now()),
+        copy_{std::move(copy)},
+        library_(open_library(copy_.path.empty() ? path : copy_.path, opts)),
+        version_(get_version()), funcs_(*this) {}
 
-  ~impl() {
-    if (BOOL res; module_ && !(res = FreeLibrary(module_))) {
-      assert(false);
-      std::cerr << "Error freeing library: " << get_last_error();
+  template <typename Library = library_t>
+  static Library open_library(const std::filesystem::path &path,
+                              const load_options &opts) {
+    using modl::detail::remote_library;
+    using modl::detail::shared_library;
+    if constexpr (modl::detail::linked_plugin) {
+      if (opts.isolate != isolation::in_process)
+        throw std::system_error(std::make_error_code(std::errc::not_supported),
+                                "Plugin is linked into the host");
+      return {};
+    } else {
+      switch (opts.isolate) {
+      case isolation::out_of_process:
+        return Library(std::in_place_type<remote_library>,
+                       modl::detail::spawn_runner(path, opts.runner));
+      case isolation::daemon:
+        return Library(std::in_place_type<remote_library>,
+                       modl::detail::connect_daemon(opts.endpoint, path));
+      default:
+        return Library(std::in_place_type<shared_library>, path,
+                       opts.relocate == relocation::immediate);
+      }
     }
   }
 
-  library_version get_version() const {
-    uint32_t ver = load_function<version_tr>()();
-    library_version found = {.major = ((ver >> 16) && 0xffff),
-                             .minor = (ver && 0xffff)};
-    if (!load_function<is_compatible_tr>()(PASMP_VERSION)) {
-      library_version current = {.major = ((PASMP_VERSION >> 16) && 0xffff),
-                                 .minor = (PASMP_VERSION && 0xffff)};
-      throw module_incompatible(current, found);
-    }
+  library_version get_version() {
+    auto start = clock::now();
+    open_time_ = start - open_start_;
+    library_version found = to_library_version(resolve<version_tr>()());
+    // an older minor lacks entry points the host resolves
+    if (found.major != PASMP_VERSION_MAJOR ||
+        found.minor < PASMP_VERSION_MINOR ||
+        !resolve<is_compatible_tr>()(PASMP_VERSION))
+      throw module_incompatible(to_library_version(PASMP_VERSION), found);
+    version_time_ = since(start);
     return found;
   }
 
-  static module_t *load_library(const std::filesystem::path &path) {
-    module_t *mod = LoadLibraryW(path.native().c_str());
-    if (!mod)
-      throw std::system_error(get_last_error(), "Error loading library");
-    return mod;
+  bool alive() const noexcept { return alive(library_); }
+
+  template <typename Library>
+  static bool alive(const Library &lib) noexcept {
+    if constexpr (modl::detail::linked_plugin) {
+      return true;
+    } else {
+      auto *remote = std::get_if<modl::detail::remote_library>(&lib);
+      return !remote || remote->alive();
+    }
+  }
+
+  load_stats stats() const noexcept {
+    return {.open = open_time_,
+            .version_check = version_time_,
+            .resolve = std::chrono::nanoseconds(
+                resolve_ns_.load(std::memory_order_relaxed)),
+            .resolved = resolved_.load(std::memory_order_relaxed)};
+  }
+
+  void *bind(const char *name) const override { return symbol(library_, name); }
+
+  template <typename Library>
+  void *symbol(const Library &lib, const char *name) const {
+    if constexpr (modl::detail::linked_plugin) {
+      throw function_load_error(
+          std::make_error_code(std::errc::function_not_supported), name);
+    } else {
+      auto start = clock::now();
+      void *func = std::visit([name](const auto &x) { return x.symbol(name); },
+                              lib);
+      resolve_ns_.fetch_add(since(start).count(), std::memory_order_relaxed);
+      if (!func && lib.index())
+        throw function_load_error(
+            std::make_error_code(std::errc::function_not_supported), name);
+      if (!func)
+        throw function_load_error(modl::detail::shared_library::last_error(),
+                                  name);
+      resolved_.fetch_add(1, std::memory_order_relaxed);
+      return func;
+    }
   }
 
   template <typename Traits, typename = std::enable_if_t<
                                  ::detail::is_module_function_traits_v<Traits>>>
-  typename Traits::pointer_type load_function() const {
-    using pointer = typename Traits::pointer_type;
-    auto func = reinterpret_cast<pointer>(
-        reinterpret_cast<intptr_t>((GetProcAddress(module_, Traits::name))));
-    if (func)
-      return func;
-    throw function_load_error(get_last_error(), Traits::name);
+  typename Traits::pointer_type resolve() const {
+    if constexpr (modl::detail::linked_plugin)
+      return Traits::function;
+    else
+      return reinterpret_cast<typename Traits::pointer_type>(
+          bind(Traits::name));
+  }
+
+  template <typename Traits> bound_function<Traits> load_function() const {
+    if constexpr (modl::detail::linked_plugin) {
+      return {};
+    } else {
+      if (options_.bind == binding::eager)
+        return module_function<Traits>{resolve<Traits>()};
+      return module_function<Traits>{
+          static_cast<const modl::detail::function_binder &>(*this)};
+    }
   }
 };
 
-loaded_module::loaded_module(const std::filesystem::path &p)
-    : handle_(std::make_shared<loaded_module::impl>(p)) {}
+loaded_module::loaded_module(const std::filesystem::path &p, load_options opts)
+    : loaded_module(module_registry::load(p, opts)) {}
+
+loaded_module::loaded_module(std::shared_ptr<const impl> x) noexcept
+    : handle_(std::move(x)) {}
+
+std::shared_ptr<const loaded_module::impl>
+loaded_module::open(const std::filesystem::path &p, const load_options &opts,
+                    uint32_t id, std::filesystem::path copy) {
+  return std::make_shared<impl>(p, opts, id, std::move(copy));
+}
+
+uint32_t loaded_module::id() const noexcept { return handle_->id_; }
 
 const std::string &loaded_module::path() const noexcept {
   return handle_->path_;
@@ -129,6 +238,10 @@ library_version loaded_module::version() const noexcept {
   return handle_->version_;
 }
 
+load_stats loaded_module::stats() const noexcept { return handle_->stats(); }
+
+bool loaded_module::alive() const noexcept { return handle_->alive(); }
+
 loaded_module::functions::functions(const impl &h)
     : version_create{h.load_function<decltype(version_create)::traits>()},
       version_destroy{h.load_function<decltype(version_destroy)::traits>()},
@@ -167,7 +280,13 @@ loaded_module::functions::functions(const impl &h)
           h.load_function<decltype(action_collection_size)::traits>()},
       action_collection_at{
           h.load_function<decltype(action_collection_at)::traits>()},
+      action_collection_read{
+          h.load_function<decltype(action_collection_read)::traits>()},
       plugin_actions{h.load_function<decltype(plugin_actions)::traits>()},
+      plugin_serialize{h.load_function<decltype(plugin_serialize)::traits>()},
+      plugin_deserialize{
+          h.load_function<decltype(plugin_deserialize)::traits>()},
+      plugin_extract{h.load_function<decltype(plugin_extract)::traits>()},
       plugin_configure_gui{
           h.load_function<decltype(plugin_configure_gui)::traits>()},
       plugin_configure_cli{
@@ -184,13 +303,26 @@ loaded_module::functions::functions(const impl &h)
       action_description{
           h.load_function<decltype(action_description)::traits>()},
       action_execute{h.load_function<decltype(action_execute)::traits>()},
+      action_payload_type{
+          h.load_function<decltype(action_payload_type)::traits>()},
+      action_execute_int32{
+          h.load_function<decltype(action_execute_int32)::traits>()},
+      action_prepare{h.load_function<decltype(action_prepare)::traits>()},
+      prepared_action_destroy{
+          h.load_function<decltype(prepared_action_destroy)::traits>()},
       action_execute_async{
           h.load_function<decltype(action_execute_async)::traits>()},
+      action_execute_async_owned{
+          h.load_function<decltype(action_execute_async_owned)::traits>()},
       action_hash{h.load_function<decltype(action_hash)::traits>()},
-      action_equal{h.load_function<decltype(action_equal)::traits>()} {}
+      action_equal{h.load_function<decltype(action_equal)::traits>()},
+      plugin_limit{h.load_function<decltype(plugin_limit)::traits>()},
+      action_limit{h.load_function<decltype(action_limit)::traits>()},
+      action_admission_stats{
+          h.load_function<decltype(action_admission_stats)::traits>()} {}
 
 bool operator==(const loaded_module &lhs, const loaded_module &rhs) noexcept {
-  return lhs.path() == rhs.path();
+  return lhs.id() == rhs.id();
 }
 
 } // namespace modl
@@ -0,0 +1,107 @@
+#include <module_load/module_registry.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// bare file names are left to the loader's own search rules
+std::filesystem::path canonical_or_same(const std::filesystem::path &p) {
+  std::error_code ec;
+  auto retval = std::filesystem::canonical(p, ec);
+  return ec ? p : retval;
+}
+
+} // namespace
+
+namespace modl {
+
+struct module_registry::state {
+  // each path is loaded under its own lock, so that loading distinct modules
+  // does not serialize
+  struct slot {
+    std::mutex mtx;
+    std::weak_ptr<const loaded_module::impl> module;
+  };
+
+  std::mutex mtx;
+  std::unordered_map<std::string, std::shared_ptr<slot>> slots;
+  std::atomic<uint32_t> next_id = 1;
+};
+
+module_registry::state &module_registry::get_state() {
+  static state x;
+  return x;
+}
+
+loaded_module module_registry::load(const std::filesystem::path &p,
+                                    load_options opts) {
+  auto &st = get_state();
+  auto path = canonical_or_same(p);
+  std::shared_ptr<state::slot> s;
+  {
+    std::scoped_lock lk(st.mtx);
+    auto key = path.string();
+    if (opts.isolate == isolation::out_of_process)
+      key.insert(0, "runner:");
+    else if (opts.isolate == isolation::daemon)
+      key.insert(0, "daemon:" + opts.endpoint.string() + ":");
+    auto &entry = st.slots[key];
+    if (!entry)
+      entry = std::make_shared<state::slot>();
+    s = entry;
+  }
+  std::scoped_lock lk(s->mtx);
+  if (auto existing = s->module.lock())
+    return loaded_module{std::move(existing)};
+  auto module = loaded_module::open(
+      path, opts, st.next_id.fetch_add(1, std::memory_order_relaxed));
+  s->module = module;
+  return loaded_module{std::move(module)};
+}
+
+loaded_module module_registry::load_copy(const std::filesystem::path &p,
+                                         load_options opts) {
+  auto &st = get_state();
+  auto path = canonical_or_same(p);
+  auto id = st.next_id.fetch_add(1, std::memory_order_relaxed);
+  // other processes may be copying the same file
+  auto copy = std::filesystem::temp_directory_path() /
+              (path.stem().string() + "." +
+               std::to_string(std::random_device{}()) + "." +
+               std::to_string(id) + path.extension().string());
+  std::filesystem::copy_file(path, copy,
+                             std::filesystem::copy_options::overwrite_existing);
+  try {
+    return loaded_module{loaded_module::open(path, opts, id, copy)};
+  } catch (...) {
+    std::error_code ec;
+    std::filesystem::remove(copy, ec);
+    throw;
+  }
+}
+
+size_t module_registry::size() {
+  auto &st = get_state();
+  std::vector<std::shared_ptr<state::slot>> slots;
+  {
+    std::scoped_lock lk(st.mtx);
+    slots.reserve(st.slots.size());
+    for (const auto &[path, s] : st.slots)
+      slots.push_back(s);
+  }
+  size_t count = 0;
+  for (const auto &s : slots) {
+    std::scoped_lock lk(s->mtx);
+    count += !s->module.expired();
+  }
+  return count;
+}
+
+} // namespace modl
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "remote_library.hpp"
+#include "remote_protocol.hpp"
+
+#include <plugin/plugin_interface.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace modl::detail {
+
+// Transport between the stubs of a remote_library and the process hosting
+// its module. A call acquires a slot, fills in the request, exchanges it for
+// the response and releases it; callbacks arrive as events, which the
+// transport hands to deliver().
+struct remote_library::channel {
+  struct subscription {
+    PASMP_on_action_added_t *on_add = nullptr;
+    void *add_data = nullptr;
+    PASMP_on_action_modified_t *on_mod = nullptr;
+    void *mod_data = nullptr;
+    PASMP_on_action_removed_t *on_rm = nullptr;
+    void *rm_data = nullptr;
+  };
+
+  struct completion {
+    PASMP_on_config_finish_t *on_config;
+    PASMP_on_action_finish_t *on_finish;
+    void *data;
+  };
+
+  virtual ~channel() = default;
+
+  virtual bool alive() const noexcept = 0;
+  virtual uint32_t plugin_version() const noexcept = 0;
+
+  // null once the other side is gone
+  virtual remote::slot *acquire() noexcept = 0;
+  // false once the other side is gone, leaving the response unset
+  virtual bool exchange(remote::slot &) noexcept = 0;
+  // exchanged tells whether the slot holds a response
+  virtual void release(remote::slot &, bool exchanged) noexcept = 0;
+
+  // cookies identify the callbacks to the other side
+  uint64_t subscribe(const subscription &);
+  uint64_t add_completion(completion);
+  void drop(uint64_t cookie) noexcept;
+
+  // a plugin's subscriptions are dropped along with its last reference
+  void plugin_created(uint64_t plugin, uint64_t cookie);
+  void plugin_addref(uint64_t plugin) noexcept;
+  void plugin_released(uint64_t plugin) noexcept;
+
+  void deliver(const remote::event &) noexcept;
+  // once the other side is gone, since their events will never arrive
+  void fail_completions(const char *message) noexcept;
+
+  // stub table in use, assigned by remote_library
+  size_t index = 0;
+
+private:
+  std::mutex records_mtx_;
+  uint64_t next_cookie_ = 1;
+  std::unordered_map<uint64_t, subscription> subscriptions_;
+  std::unordered_map<uint64_t, completion> completions_;
+  struct plugin_record {
+    uint64_t refs = 0;
+    // creating the plugin again yields the same one, with a reference more
+    std::vector<uint64_t> cookies;
+  };
+  std::unordered_map<uint64_t, plugin_record> plugins_;
+};
+
+} // namespace modl::detail
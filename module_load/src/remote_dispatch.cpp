@@ -0,0 +1,445 @@
+#include "remote_dispatch.hpp"
+#include "remote_wire.hpp"
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+namespace modl::detail::remote {
+
+struct event_route {
+  std::shared_ptr<event_sink> sink;
+  uint64_t cookie;
+};
+
+namespace {
+
+struct prepared {
+  PASMP_prepared_action_t ctx;
+  PASMP_prepared_execute_t *fn;
+};
+
+// owned by the plugin once handed to an asynchronous execution
+struct owned_payload {
+  PASMP_payload_data_t data;
+  std::string text;
+};
+
+void release_payload(void *x) noexcept {
+  delete static_cast<owned_payload *>(x);
+}
+
+template <typename T> T handle(uint64_t x) noexcept {
+  return reinterpret_cast<T>(static_cast<uintptr_t>(x));
+}
+
+template <typename T> uint64_t value(T x) noexcept {
+  return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(x));
+}
+
+// for callbacks that fire once; the callback takes ownership
+std::unique_ptr<event_route>
+one_shot_route(const std::shared_ptr<event_sink> &sink,
+               uint64_t cookie) noexcept {
+  if (!cookie)
+    return nullptr;
+  return std::unique_ptr<event_route>(new (std::nothrow)
+                                          event_route{sink, cookie});
+}
+
+void push_action(event_kind kind, PASMP_action_t a, void *r) noexcept {
+  const auto &route = *static_cast<const event_route *>(r);
+  event ev{};
+  ev.kind = kind;
+  ev.cookie = route.cookie;
+  ev.action = value(a);
+  route.sink->push(ev);
+}
+
+void PASMP_CALLBACK on_add(PASMP_action_t a, void *route) noexcept {
+  push_action(event_kind::action_added, a, route);
+}
+
+void PASMP_CALLBACK on_mod(PASMP_action_t a, void *route) noexcept {
+  push_action(event_kind::action_modified, a, route);
+}
+
+void PASMP_CALLBACK on_rm(PASMP_action_t a, void *route) noexcept {
+  push_action(event_kind::action_removed, a, route);
+}
+
+void PASMP_CALLBACK on_config(PASMP_status_t status, PASMP_config_status_t cs,
+                              void *r) noexcept {
+  auto route = std::unique_ptr<event_route>(static_cast<event_route *>(r));
+  event ev{};
+  ev.kind = event_kind::config_finished;
+  ev.status = status;
+  ev.config_status = cs;
+  ev.cookie = route->cookie;
+  route->sink->push(ev);
+}
+
+void PASMP_CALLBACK on_finish(PASMP_status_t status, PASMP_string_view_t msg,
+                              void *r) noexcept {
+  auto route = std::unique_ptr<event_route>(static_cast<event_route *>(r));
+  event ev{};
+  ev.kind = event_kind::action_finished;
+  ev.status = status;
+  ev.cookie = route->cookie;
+  ev.message_size = std::min<uint64_t>(msg.size, message_capacity);
+  if (ev.message_size)
+    std::memcpy(ev.message, msg.data, ev.message_size);
+  route->sink->push(ev);
+}
+
+PASMP_status_t too_large(PASMP_error_descriptor_t *err) noexcept {
+  constexpr std::string_view msg =
+      "Response exceeds the capacity of the plugin host channel";
+  if (err && err->size) {
+    auto n = std::min<uint64_t>(err->size - 1, msg.size());
+    std::memcpy(err->what, msg.data(), n);
+    err->what[n] = 0;
+    err->size -= n;
+  }
+  return PASMP_ERROR_SYSTEM;
+}
+
+PASMP_payload_data_t *
+payload_data(slot &s, PASMP_payload_data_t &data) noexcept {
+  if (!s.args[6])
+    return nullptr;
+  if (s.args[5] == PASMP_PAYLOAD_STRING) {
+    auto text = wire_reader(s.data, s.data + s.data_size).get();
+    data.string_value = {text.data(), text.size()};
+  } else {
+    std::memcpy(&data, &s.args[7], sizeof(s.args[7]));
+  }
+  return &data;
+}
+
+PASMP_payload_t payload(slot &s, PASMP_payload_data_t &data) noexcept {
+  auto tag = static_cast<PASMP_payload_tag_t>(s.args[5]);
+  return {tag, payload_data(s, data)};
+}
+
+template <typename Descriptor, typename Name, typename Description>
+PASMP_status_t describe(slot &s, Descriptor d, const Name &name,
+                        const Description &description,
+                        PASMP_error_descriptor_t *err) noexcept {
+  wire_writer w(s.data, s.data + data_capacity);
+  for (int32_t short_variant : {0, 1}) {
+    auto x = name(d, short_variant);
+    w.put({x.data, x.size});
+  }
+  for (int32_t short_variant : {0, 1}) {
+    auto x = description(d, short_variant);
+    w.put({x.data, x.size});
+  }
+  s.data_size = w.size();
+  return w ? PASMP_SUCCESS : too_large(err);
+}
+
+} // namespace
+
+hosted_module::hosted_module(const std::filesystem::path &path)
+    : module(path) {
+  // neither function is part of loaded_module::functions; the module is
+  // already open, so this only looks them up
+  handle_ = dlopen(path.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+  auto *version = reinterpret_cast<uint32_t(PASMP_CALL *)()>(
+      handle_ ? dlsym(handle_, "PASMP_version") : nullptr);
+  is_compatible = reinterpret_cast<int32_t(PASMP_CALL *)(uint32_t)>(
+      handle_ ? dlsym(handle_, "PASMP_is_library_compatible") : nullptr);
+  if (!version || !is_compatible) {
+    if (handle_)
+      dlclose(handle_);
+    throw std::runtime_error("Error resolving the version of the module");
+  }
+  plugin_version = version();
+}
+
+hosted_module::~hosted_module() { dlclose(handle_); }
+
+dispatcher::dispatcher(const hosted_module &host) : host_(host) {}
+
+dispatcher::~dispatcher() = default;
+
+void dispatcher::operator()(slot &s,
+                            const std::shared_ptr<event_sink> &sink) noexcept {
+  PASMP_error_descriptor_t ed{s.error_size ? s.error : nullptr, s.error_size};
+  auto *err = ed.what ? &ed : nullptr;
+  s.status = dispatch(s, err, sink);
+  s.error_size = ed.size;
+}
+
+void *dispatcher::persistent_route(const std::shared_ptr<event_sink> &sink,
+                                   uint64_t cookie) {
+  std::scoped_lock lk(routes_mtx_);
+  return routes_
+      .emplace_back(std::make_unique<event_route>(event_route{sink, cookie}))
+      .get();
+}
+
+PASMP_status_t
+dispatcher::dispatch(slot &s, PASMP_error_descriptor_t *err,
+                     const std::shared_ptr<event_sink> &sink) noexcept {
+  const auto &f = host_.module.funcs();
+  auto *args = s.args;
+  PASMP_payload_data_t data{};
+  switch (s.code) {
+  case op::noop:
+    return PASMP_SUCCESS;
+
+  case op::is_compatible:
+    args[0] = host_.is_compatible(static_cast<uint32_t>(args[0]));
+    return PASMP_SUCCESS;
+
+  case op::version_create: {
+    PASMP_version_t v;
+    if (auto status = f.version_create(&v, err))
+      return status;
+    args[0] = f.version_major(v);
+    args[1] = f.version_minor(v);
+    args[2] = f.version_patch(v);
+    wire_writer w(s.data, s.data + data_capacity);
+    auto pre = f.version_pre(v);
+    auto build = f.version_build(v);
+    w.put({pre.data, pre.size});
+    w.put({build.data, build.size});
+    s.data_size = w.size();
+    f.version_destroy(v);
+    return w ? PASMP_SUCCESS : too_large(err);
+  }
+
+  case op::plugin_descriptor_create: {
+    PASMP_plugin_descriptor_t d;
+    if (auto status = f.plugin_descriptor_create(&d, err))
+      return status;
+    auto status = describe(s, d, f.plugin_name, f.plugin_description, err);
+    f.plugin_descriptor_destroy(d);
+    return status;
+  }
+
+  case op::plugin_create: {
+    void *route;
+    try {
+      route = persistent_route(sink, args[0]);
+    } catch (const std::bad_alloc &) {
+      return PASMP_ERROR_ALLOC;
+    }
+    auto path = wire_reader(s.data, s.data + s.data_size).get();
+    PASMP_plugin_attr_t attr;
+    if (auto status = f.plugin_attr_create(&attr, err))
+      return status;
+    PASMP_status_t status = PASMP_SUCCESS;
+    if (args[1] & 1)
+      status = f.plugin_attr_on_action_add(attr, &on_add, route, err);
+    if (!status && (args[1] & 2))
+      status = f.plugin_attr_on_action_mod(attr, &on_mod, route, err);
+    if (!status && (args[1] & 4))
+      status = f.plugin_attr_on_action_rm(attr, &on_rm, route, err);
+    if (!status && !path.empty())
+      status = f.plugin_attr_persistence_path(
+          attr, {path.data(), path.size()}, err);
+    PASMP_plugin_t p = nullptr;
+    if (!status)
+      status = f.plugin_create(&p, attr, err);
+    f.plugin_attr_destroy(attr);
+    args[2] = value(p);
+    return status;
+  }
+
+  case op::plugin_addref:
+    return f.plugin_addref(handle<PASMP_plugin_t>(args[0]));
+
+  case op::plugin_release:
+    return f.plugin_release(handle<PASMP_plugin_t>(args[0]));
+
+  case op::plugin_actions: {
+    PASMP_action_collection_t c;
+    if (auto status = f.action_collection_create(&c, err))
+      return status;
+    auto status = f.plugin_actions(handle<PASMP_plugin_t>(args[0]), c, err);
+    if (!status) {
+      uint64_t count = f.action_collection_size(c);
+      if (count * sizeof(uint64_t) > data_capacity) {
+        status = too_large(err);
+      } else {
+        auto *out = reinterpret_cast<PASMP_action_t *>(s.data);
+        status = f.action_collection_read(c, 0, out, &count, err);
+        s.data_size = count * sizeof(uint64_t);
+      }
+    }
+    f.action_collection_destroy(c);
+    return status;
+  }
+
+  case op::plugin_serialize:
+  case op::action_serialize: {
+    char *into = args[1] ? s.data : nullptr;
+    if (s.code == op::plugin_serialize)
+      return f.plugin_serialize(handle<PASMP_plugin_t>(args[0]), into,
+                                &args[2], err);
+    return f.action_serialize(handle<PASMP_action_t>(args[0]), into,
+                              &args[2], err);
+  }
+
+  case op::plugin_deserialize:
+    return f.plugin_deserialize(handle<PASMP_plugin_t>(args[0]), s.data,
+                                s.data_size, err);
+
+  case op::plugin_extract:
+    return f.plugin_extract(handle<PASMP_plugin_t>(args[0]),
+                            handle<PASMP_action_t>(args[1]),
+                            args[2] ? s.data : nullptr, &args[3], err);
+
+  case op::action_deserialize: {
+    PASMP_action_t a = nullptr;
+    auto status = f.action_deserialize(&a, s.data, s.data_size, err);
+    args[0] = value(a);
+    return status;
+  }
+
+  case op::plugin_configure_gui:
+  case op::plugin_configure_cli: {
+    auto p = handle<PASMP_plugin_t>(args[0]);
+    auto route = one_shot_route(sink, args[1]);
+    if (args[1] && !route)
+      return PASMP_ERROR_ALLOC;
+    auto *cb = route ? &on_config : nullptr;
+    auto status = s.code == op::plugin_configure_gui
+                      ? f.plugin_configure_gui(p, cb, route.get(), err)
+                      : f.plugin_configure_cli(p, cb, route.get(), err);
+    if (!status)
+      route.release();
+    return status;
+  }
+
+  case op::plugin_limit: {
+    PASMP_rate_limit_t limit;
+    std::memcpy(&limit, s.data, sizeof(limit));
+    return f.plugin_limit(handle<PASMP_plugin_t>(args[0]), limit, err);
+  }
+
+  case op::action_limit: {
+    PASMP_rate_limit_t limit;
+    std::memcpy(&limit, s.data, sizeof(limit));
+    return f.action_limit(handle<PASMP_plugin_t>(args[0]),
+                          handle<PASMP_action_t>(args[1]), limit, err);
+  }
+
+  case op::action_admission_stats: {
+    PASMP_admission_stats_t stats;
+    auto status = f.action_admission_stats(handle<PASMP_plugin_t>(args[0]),
+                                           handle<PASMP_action_t>(args[1]),
+                                           &stats, err);
+    std::memcpy(s.data, &stats, sizeof(stats));
+    s.data_size = sizeof(stats);
+    return status;
+  }
+
+  case op::action_destroy:
+    return f.action_destroy(handle<PASMP_action_t>(args[0]));
+
+  case op::action_descriptor_create: {
+    PASMP_action_descriptor_t d;
+    if (auto status = f.action_descriptor_create(
+            handle<PASMP_plugin_t>(args[0]), handle<PASMP_action_t>(args[1]),
+            &d, err))
+      return status;
+    auto status = describe(s, d, f.action_name, f.action_description, err);
+    f.action_descriptor_destroy(d);
+    return status;
+  }
+
+  case op::action_execute:
+    return f.action_execute(handle<PASMP_plugin_t>(args[0]),
+                            handle<PASMP_action_t>(args[1]),
+                            payload(s, data), err);
+
+  case op::action_payload_type: {
+    PASMP_payload_tag_t tag = PASMP_PAYLOAD_NONE;
+    auto status = f.action_payload_type(handle<PASMP_plugin_t>(args[0]),
+                                        handle<PASMP_action_t>(args[1]),
+                                        &tag, err);
+    args[2] = tag;
+    return status;
+  }
+
+  case op::action_execute_int32:
+    return f.action_execute_int32(handle<PASMP_plugin_t>(args[0]),
+                                  handle<PASMP_action_t>(args[1]),
+                                  static_cast<int32_t>(args[2]), err);
+
+  case op::action_prepare: {
+    auto prep = std::unique_ptr<prepared>(new (std::nothrow) prepared{});
+    if (!prep)
+      return PASMP_ERROR_ALLOC;
+    if (auto status = f.action_prepare(
+            handle<PASMP_plugin_t>(args[0]), handle<PASMP_action_t>(args[1]),
+            static_cast<PASMP_payload_tag_t>(args[2]), &prep->ctx, &prep->fn,
+            err))
+      return status;
+    args[3] = value(prep.release());
+    return PASMP_SUCCESS;
+  }
+
+  case op::prepared_execute: {
+    const auto &prep = *handle<prepared *>(args[0]);
+    return prep.fn(prep.ctx, payload_data(s, data), err);
+  }
+
+  case op::prepared_action_destroy: {
+    auto prep = std::unique_ptr<prepared>(handle<prepared *>(args[0]));
+    return f.prepared_action_destroy(prep->ctx);
+  }
+
+  case op::action_execute_async: {
+    auto *owned = new (std::nothrow) owned_payload{};
+    if (!owned)
+      return PASMP_ERROR_ALLOC;
+    auto in = payload(s, data);
+    try {
+      if (in.data) {
+        owned->data = *in.data;
+        if (in.tag == PASMP_PAYLOAD_STRING) {
+          owned->text.assign(data.string_value.data, data.string_value.size);
+          owned->data.string_value = {owned->text.data(), owned->text.size()};
+        }
+        in.data = &owned->data;
+      }
+    } catch (const std::bad_alloc &) {
+      delete owned;
+      return PASMP_ERROR_ALLOC;
+    }
+    auto route = one_shot_route(sink, args[2]);
+    if (args[2] && !route) {
+      release_payload(owned);
+      return PASMP_ERROR_ALLOC;
+    }
+    auto *cb = route ? &on_finish : nullptr;
+    auto status = f.action_execute_async_owned(
+        handle<PASMP_plugin_t>(args[0]), handle<PASMP_action_t>(args[1]), in,
+        &release_payload, owned, cb, route.get(), err);
+    if (!status)
+      route.release();
+    return status;
+  }
+
+  case op::action_hash:
+    args[1] = f.action_hash(handle<PASMP_action_t>(args[0]));
+    return PASMP_SUCCESS;
+
+  case op::action_equal:
+    args[2] = f.action_equal(handle<PASMP_action_t>(args[0]),
+                             handle<PASMP_action_t>(args[1]));
+    return PASMP_SUCCESS;
+  }
+  return PASMP_INVALID_ARGUMENT;
+}
+
+} // namespace modl::detail::remote
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "remote_protocol.hpp"
+
+#include <module_load/module.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Serving side of remote_library: carries out the calls in slots against a
+// module opened by this process, as the runner and the daemon do.
+namespace modl::detail::remote {
+
+class event_sink {
+public:
+  virtual void push(const event &) noexcept = 0;
+
+protected:
+  ~event_sink() = default;
+};
+
+struct hosted_module {
+  explicit hosted_module(const std::filesystem::path &);
+  ~hosted_module();
+
+  hosted_module(const hosted_module &) = delete;
+  hosted_module &operator=(const hosted_module &) = delete;
+
+  loaded_module module;
+  uint32_t plugin_version;
+  int32_t(PASMP_CALL *is_compatible)(uint32_t);
+
+private:
+  void *handle_;
+};
+
+struct event_route;
+
+class dispatcher {
+public:
+  explicit dispatcher(const hosted_module &);
+  ~dispatcher();
+
+  dispatcher(const dispatcher &) = delete;
+  dispatcher &operator=(const dispatcher &) = delete;
+
+  // fills in the response; the callbacks registered by the call push their
+  // events to the sink
+  void operator()(slot &, const std::shared_ptr<event_sink> &) noexcept;
+
+private:
+  PASMP_status_t dispatch(slot &, PASMP_error_descriptor_t *,
+                          const std::shared_ptr<event_sink> &) noexcept;
+  void *persistent_route(const std::shared_ptr<event_sink> &, uint64_t);
+
+  const hosted_module &host_;
+  std::mutex routes_mtx_;
+  // routes of callbacks that fire for as long as the plugin lives
+  std::vector<std::unique_ptr<event_route>> routes_;
+};
+
+} // namespace modl::detail::remote
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+namespace modl::detail {
+
+// Stands in for shared_library when a module is hosted by another process:
+// a runner spawned for it, or a daemon shared with other hosts. Every symbol
+// resolves to a stub that forwards the call through the channel. Once the
+// other side is gone, calls fail with PASMP_UNAVAILABLE instead of taking the
+// host down with it.
+class remote_library {
+public:
+  struct channel;
+  // the channel stays incomplete for those that only pass it along
+  struct channel_deleter {
+    void operator()(channel *) const noexcept;
+  };
+  using channel_ptr = std::unique_ptr<channel, channel_deleter>;
+
+  explicit remote_library(channel_ptr);
+  ~remote_library();
+
+  remote_library(const remote_library &) = delete;
+  remote_library &operator=(const remote_library &) = delete;
+
+  // null if the symbol is not part of the plugin interface
+  void *symbol(const char *) const noexcept;
+
+  // false once the other side has exited or disconnected
+  bool alive() const noexcept;
+
+private:
+  channel_ptr channel_;
+};
+
+// an empty runner path picks the PluginRunner next to the host executable
+remote_library::channel_ptr
+spawn_runner(const std::filesystem::path &module,
+             const std::filesystem::path &runner);
+
+// the daemon opens the module on behalf of the host, or shares the copy it
+// has already opened
+remote_library::channel_ptr
+connect_daemon(const std::filesystem::path &socket,
+               const std::filesystem::path &module);
+
+} // namespace modl::detail
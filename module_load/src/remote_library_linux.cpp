@@ -0,0 +1,1062 @@
+#include "remote_channel.hpp"
+#include "remote_wire.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace {
+
+namespace remote = modl::detail::remote;
+using channel = modl::detail::remote_library::channel;
+
+// stubs cannot carry a context, so every loaded module gets a stub table of
+// its own that finds its channel through a fixed index
+constexpr size_t max_channels = 8;
+std::array<std::atomic<channel *>, max_channels> channels{};
+
+void fill_error(PASMP_error_descriptor_t *err, std::string_view msg) noexcept {
+  if (!err || !err->size || msg.empty())
+    return;
+  auto n = std::min<uint64_t>(err->size - 1, msg.size());
+  std::memcpy(err->what, msg.data(), n);
+  err->what[n] = 0;
+  err->size -= n;
+}
+
+PASMP_status_t transport_error(PASMP_error_descriptor_t *err) noexcept {
+  fill_error(err, "Transfer exceeds the capacity of the plugin host channel");
+  return PASMP_ERROR_SYSTEM;
+}
+
+struct version_proxy {
+  uint16_t major;
+  uint16_t minor;
+  uint16_t patch;
+  std::string pre;
+  std::string build;
+};
+
+// strings are indexed by short_variant
+struct descriptor_proxy {
+  std::string name[2];
+  std::string description[2];
+};
+
+struct attr_proxy {
+  std::string path;
+  channel::subscription callbacks;
+};
+
+struct collection_proxy {
+  std::vector<uint64_t> actions;
+};
+
+struct prepared_proxy {
+  uint64_t remote;
+  PASMP_payload_tag_t tag;
+};
+
+PASMP_string_view_t view_of(const std::string &s) noexcept {
+  return {s.data(), s.size()};
+}
+
+// One call on a slot of the channel, released on destruction
+class request {
+public:
+  request(channel &ch, remote::op code, PASMP_error_descriptor_t *err) noexcept
+      : ch_(ch), code_(code), err_(err), slot_(ch.acquire()) {
+    if (slot_)
+      slot_->data_size = 0;
+  }
+
+  ~request() {
+    if (slot_)
+      ch_.release(*slot_, exchanged_);
+  }
+
+  request(const request &) = delete;
+  request &operator=(const request &) = delete;
+
+  explicit operator bool() const noexcept { return slot_; }
+
+  uint64_t &arg(size_t ix) noexcept { return slot_->args[ix]; }
+
+  char *data() noexcept { return slot_->data; }
+  uint64_t data_size() const noexcept { return slot_->data_size; }
+  void data_size(uint64_t x) noexcept { slot_->data_size = x; }
+
+  remote::wire_writer writer() noexcept {
+    return {slot_->data, slot_->data + remote::data_capacity};
+  }
+  remote::wire_reader reader() const noexcept {
+    return {slot_->data, slot_->data + slot_->data_size};
+  }
+
+  PASMP_status_t send() noexcept {
+    if (!slot_)
+      return unavailable();
+    auto error_size =
+        err_ ? std::min<uint64_t>(err_->size, remote::error_capacity) : 0;
+    slot_->code = code_;
+    slot_->error_size = error_size;
+    if (!ch_.exchange(*slot_))
+      return unavailable();
+    exchanged_ = true;
+    if (auto written = error_size - slot_->error_size) {
+      std::memcpy(err_->what, slot_->error,
+                  std::min(written + 1, error_size));
+      err_->size -= written;
+    }
+    return slot_->status;
+  }
+
+private:
+  PASMP_status_t unavailable() noexcept {
+    fill_error(err_, "Plugin host exited");
+    return PASMP_UNAVAILABLE;
+  }
+
+  channel &ch_;
+  remote::op code_;
+  PASMP_error_descriptor_t *err_;
+  remote::slot *slot_;
+  bool exchanged_ = false;
+};
+
+PASMP_status_t put_payload(request &r, PASMP_payload_tag_t tag,
+                           const PASMP_payload_data_t *data) noexcept {
+  r.arg(5) = tag;
+  r.arg(6) = data != nullptr;
+  r.arg(7) = 0;
+  if (!data)
+    return PASMP_SUCCESS;
+  if (tag != PASMP_PAYLOAD_STRING) {
+    static_assert(sizeof(r.arg(7)) >= sizeof(data->double_value));
+    std::memcpy(&r.arg(7), data, sizeof(r.arg(7)));
+    return PASMP_SUCCESS;
+  }
+  auto w = r.writer();
+  w.put({data->string_value.data, data->string_value.size});
+  if (!w)
+    return PASMP_ERROR_SYSTEM;
+  r.data_size(w.size());
+  return PASMP_SUCCESS;
+}
+
+template <size_t Slot> struct stubs {
+  static channel &ch() noexcept {
+    return *channels[Slot].load(std::memory_order_acquire);
+  }
+
+  template <typename T> static T handle(uint64_t x) noexcept {
+    return reinterpret_cast<T>(static_cast<uintptr_t>(x));
+  }
+
+  template <typename T> static uint64_t value(T x) noexcept {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(x));
+  }
+
+  static uint32_t PASMP_CALL version() noexcept {
+    return ch().plugin_version();
+  }
+
+  static int32_t PASMP_CALL is_compatible(uint32_t v) noexcept {
+    request r(ch(), remote::op::is_compatible, nullptr);
+    if (!r)
+      return 0;
+    r.arg(0) = v;
+    if (r.send())
+      return 0;
+    return static_cast<int32_t>(r.arg(0));
+  }
+
+  static PASMP_status_t PASMP_CALL
+  version_create(PASMP_version_t *out, PASMP_error_descriptor_t *err) noexcept {
+    if (!out)
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::version_create, err);
+    if (auto status = r.send())
+      return status;
+    try {
+      auto in = r.reader();
+      auto v = std::make_unique<version_proxy>(
+          static_cast<uint16_t>(r.arg(0)), static_cast<uint16_t>(r.arg(1)),
+          static_cast<uint16_t>(r.arg(2)), std::string(in.get()),
+          std::string(in.get()));
+      *out = reinterpret_cast<PASMP_version_t>(v.release());
+    } catch (const std::bad_alloc &) {
+      return PASMP_ERROR_ALLOC;
+    }
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL version_destroy(PASMP_version_t v) noexcept {
+    delete reinterpret_cast<version_proxy *>(v);
+    return PASMP_SUCCESS;
+  }
+
+  static const version_proxy &ver(PASMP_version_t v) noexcept {
+    return *reinterpret_cast<const version_proxy *>(v);
+  }
+
+  static uint16_t PASMP_CALL version_major(PASMP_version_t v) noexcept {
+    return ver(v).major;
+  }
+  static uint16_t PASMP_CALL version_minor(PASMP_version_t v) noexcept {
+    return ver(v).minor;
+  }
+  static uint16_t PASMP_CALL version_patch(PASMP_version_t v) noexcept {
+    return ver(v).patch;
+  }
+  static PASMP_string_view_t PASMP_CALL
+  version_pre(PASMP_version_t v) noexcept {
+    return view_of(ver(v).pre);
+  }
+  static PASMP_string_view_t PASMP_CALL
+  version_build(PASMP_version_t v) noexcept {
+    return view_of(ver(v).build);
+  }
+
+  // attributes stay on this side until a plugin is created from them
+
+  static PASMP_status_t PASMP_CALL
+  plugin_attr_create(PASMP_plugin_attr_t *out,
+                     PASMP_error_descriptor_t *) noexcept {
+    if (!out)
+      return PASMP_INVALID_ARGUMENT;
+    auto *attr = new (std::nothrow) attr_proxy;
+    if (!attr)
+      return PASMP_ERROR_ALLOC;
+    *out = reinterpret_cast<PASMP_plugin_attr_t>(attr);
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_attr_destroy(PASMP_plugin_attr_t attr) noexcept {
+    delete reinterpret_cast<attr_proxy *>(attr);
+    return PASMP_SUCCESS;
+  }
+
+  static attr_proxy *attributes(PASMP_plugin_attr_t attr) noexcept {
+    return reinterpret_cast<attr_proxy *>(attr);
+  }
+
+  static PASMP_status_t PASMP_CALL plugin_attr_on_action_mod(
+      PASMP_plugin_attr_t attr, PASMP_on_action_modified_t *cb, void *data,
+      PASMP_error_descriptor_t *) noexcept {
+    if (!attr)
+      return PASMP_INVALID_ARGUMENT;
+    attributes(attr)->callbacks.on_mod = cb;
+    attributes(attr)->callbacks.mod_data = data;
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL plugin_attr_on_action_add(
+      PASMP_plugin_attr_t attr, PASMP_on_action_added_t *cb, void *data,
+      PASMP_error_descriptor_t *) noexcept {
+    if (!attr)
+      return PASMP_INVALID_ARGUMENT;
+    attributes(attr)->callbacks.on_add = cb;
+    attributes(attr)->callbacks.add_data = data;
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL plugin_attr_on_action_rm(
+      PASMP_plugin_attr_t attr, PASMP_on_action_removed_t *cb, void *data,
+      PASMP_error_descriptor_t *) noexcept {
+    if (!attr)
+      return PASMP_INVALID_ARGUMENT;
+    attributes(attr)->callbacks.on_rm = cb;
+    attributes(attr)->callbacks.rm_data = data;
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_attr_persistence_path(PASMP_plugin_attr_t attr,
+                               PASMP_string_view_t path,
+                               PASMP_error_descriptor_t *) noexcept {
+    if (!attr || (path.size && !path.data))
+      return PASMP_INVALID_ARGUMENT;
+    try {
+      attributes(attr)->path.assign(path.data, path.size);
+    } catch (const std::bad_alloc &) {
+      return PASMP_ERROR_ALLOC;
+    }
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t descriptor(request &r, void *&out) noexcept {
+    if (auto status = r.send())
+      return status;
+    try {
+      auto in = r.reader();
+      auto d = std::make_unique<descriptor_proxy>();
+      for (auto &s : d->name)
+        s = in.get();
+      for (auto &s : d->description)
+        s = in.get();
+      out = d.release();
+    } catch (const std::bad_alloc &) {
+      return PASMP_ERROR_ALLOC;
+    }
+    return PASMP_SUCCESS;
+  }
+
+  static const descriptor_proxy &descr(void *d) noexcept {
+    return *static_cast<const descriptor_proxy *>(d);
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_descriptor_create(PASMP_plugin_descriptor_t *out,
+                           PASMP_error_descriptor_t *err) noexcept {
+    if (!out)
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::plugin_descriptor_create, err);
+    void *d = nullptr;
+    auto status = descriptor(r, d);
+    if (!status)
+      *out = static_cast<PASMP_plugin_descriptor_t>(d);
+    return status;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_descriptor_destroy(PASMP_plugin_descriptor_t d) noexcept {
+    delete reinterpret_cast<descriptor_proxy *>(d);
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_string_view_t PASMP_CALL
+  plugin_name(PASMP_plugin_descriptor_t d, int32_t short_variant) noexcept {
+    return view_of(descr(d).name[short_variant != 0]);
+  }
+
+  static PASMP_string_view_t PASMP_CALL plugin_description(
+      PASMP_plugin_descriptor_t d, int32_t short_variant) noexcept {
+    return view_of(descr(d).description[short_variant != 0]);
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_create(PASMP_plugin_t *out, PASMP_plugin_attr_t attr,
+                PASMP_error_descriptor_t *err) noexcept {
+    if (!out || !attr)
+      return PASMP_INVALID_ARGUMENT;
+    const auto &a = *attributes(attr);
+    uint64_t cookie;
+    try {
+      cookie = ch().subscribe(a.callbacks);
+    } catch (const std::bad_alloc &) {
+      return PASMP_ERROR_ALLOC;
+    }
+    request r(ch(), remote::op::plugin_create, err);
+    if (r) {
+      r.arg(0) = cookie;
+      const auto &cb = a.callbacks;
+      r.arg(1) = (cb.on_add ? 1 : 0) | (cb.on_mod ? 2 : 0) | (cb.on_rm ? 4 : 0);
+      auto w = r.writer();
+      w.put(a.path);
+      if (!w) {
+        ch().drop(cookie);
+        return transport_error(err);
+      }
+      r.data_size(w.size());
+    }
+    if (auto status = r.send()) {
+      ch().drop(cookie);
+      return status;
+    }
+    try {
+      ch().plugin_created(r.arg(2), cookie);
+    } catch (const std::bad_alloc &) {
+      ch().drop(cookie);
+      simple(remote::op::plugin_release, r.arg(2));
+      return PASMP_ERROR_ALLOC;
+    }
+    *out = handle<PASMP_plugin_t>(r.arg(2));
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t simple(remote::op code, uint64_t x) noexcept {
+    request r(ch(), code, nullptr);
+    if (r)
+      r.arg(0) = x;
+    return r.send();
+  }
+
+  static PASMP_status_t PASMP_CALL plugin_addref(PASMP_plugin_t p) noexcept {
+    auto status = simple(remote::op::plugin_addref, value(p));
+    if (!status)
+      ch().plugin_addref(value(p));
+    return status;
+  }
+
+  static PASMP_status_t PASMP_CALL plugin_release(PASMP_plugin_t p) noexcept {
+    // no more events for the plugin's callbacks, even should the call fail
+    ch().plugin_released(value(p));
+    return simple(remote::op::plugin_release, value(p));
+  }
+
+  // collections are filled in one go by plugin_actions and read locally
+
+  static PASMP_status_t PASMP_CALL
+  action_collection_create(PASMP_action_collection_t *out,
+                           PASMP_error_descriptor_t *) noexcept {
+    if (!out)
+      return PASMP_INVALID_ARGUMENT;
+    auto *c = new (std::nothrow) collection_proxy;
+    if (!c)
+      return PASMP_ERROR_ALLOC;
+    *out = reinterpret_cast<PASMP_action_collection_t>(c);
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_collection_destroy(PASMP_action_collection_t c) noexcept {
+    delete reinterpret_cast<collection_proxy *>(c);
+    return PASMP_SUCCESS;
+  }
+
+  static const std::vector<uint64_t> &
+  actions_of(PASMP_action_collection_t c) noexcept {
+    return reinterpret_cast<const collection_proxy *>(c)->actions;
+  }
+
+  static uint64_t PASMP_CALL
+  action_collection_size(PASMP_action_collection_t c) noexcept {
+    return c ? actions_of(c).size() : 0;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_collection_at(PASMP_action_collection_t c, uint64_t ix,
+                       PASMP_action_t *out,
+                       PASMP_error_descriptor_t *) noexcept {
+    if (!c || !out || ix >= actions_of(c).size())
+      return PASMP_INVALID_ARGUMENT;
+    *out = handle<PASMP_action_t>(actions_of(c)[ix]);
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL action_collection_read(
+      PASMP_action_collection_t c, uint64_t offset, PASMP_action_t *out,
+      uint64_t *count_inout, PASMP_error_descriptor_t *) noexcept {
+    if (!c || !count_inout || (*count_inout && !out))
+      return PASMP_INVALID_ARGUMENT;
+    const auto &actions = actions_of(c);
+    auto first = std::min<uint64_t>(offset, actions.size());
+    auto count = std::min<uint64_t>(*count_inout, actions.size() - first);
+    for (uint64_t i = 0; i < count; i++)
+      out[i] = handle<PASMP_action_t>(actions[first + i]);
+    *count_inout = count;
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_actions(PASMP_plugin_t p, PASMP_action_collection_t c,
+                 PASMP_error_descriptor_t *err) noexcept {
+    if (!p || !c)
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::plugin_actions, err);
+    if (r)
+      r.arg(0) = value(p);
+    if (auto status = r.send())
+      return status;
+    try {
+      auto &actions = reinterpret_cast<collection_proxy *>(c)->actions;
+      actions.resize(r.data_size() / sizeof(uint64_t));
+      if (!actions.empty())
+        std::memcpy(actions.data(), r.data(),
+                    actions.size() * sizeof(uint64_t));
+    } catch (const std::bad_alloc &) {
+      return PASMP_ERROR_ALLOC;
+    }
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t serialize(remote::op code, uint64_t x, char *into,
+                                  uint64_t *size_inout,
+                                  PASMP_error_descriptor_t *err) noexcept {
+    if (!size_inout)
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), code, err);
+    if (r) {
+      r.arg(0) = x;
+      r.arg(1) = into != nullptr;
+      r.arg(2) = std::min<uint64_t>(*size_inout, remote::data_capacity);
+    }
+    auto status = r.send();
+    if (status && status != PASMP_ERROR_TRUNCATED)
+      return status;
+    auto needed = r.arg(2);
+    // the caller made room, but the channel cannot carry it
+    if (status == PASMP_ERROR_TRUNCATED && into && *size_inout >= needed)
+      return transport_error(err);
+    *size_inout = needed;
+    if (!status && into)
+      std::memcpy(into, r.data(), needed);
+    return status;
+  }
+
+  static PASMP_status_t deserialize(request &r, const char *from,
+                                    uint64_t size,
+                                    PASMP_error_descriptor_t *err) noexcept {
+    if (size > remote::data_capacity)
+      return transport_error(err);
+    if (r) {
+      if (size)
+        std::memcpy(r.data(), from, size);
+      r.data_size(size);
+    }
+    return r.send();
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_serialize(PASMP_plugin_t p, char *into, uint64_t *size_inout,
+                   PASMP_error_descriptor_t *err) noexcept {
+    return serialize(remote::op::plugin_serialize, value(p), into, size_inout,
+                     err);
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_deserialize(PASMP_plugin_t p, const char *from, uint64_t size,
+                     PASMP_error_descriptor_t *err) noexcept {
+    if (!p || (size && !from))
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::plugin_deserialize, err);
+    if (r)
+      r.arg(0) = value(p);
+    return deserialize(r, from, size, err);
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_extract(PASMP_plugin_t p, PASMP_action_t a, char *into,
+                 uint64_t *size_inout, PASMP_error_descriptor_t *err) noexcept {
+    if (!size_inout)
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::plugin_extract, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+      r.arg(2) = into != nullptr;
+      r.arg(3) = std::min<uint64_t>(*size_inout, remote::data_capacity);
+    }
+    auto status = r.send();
+    if (status && status != PASMP_ERROR_TRUNCATED)
+      return status;
+    auto needed = r.arg(3);
+    if (status == PASMP_ERROR_TRUNCATED && into && *size_inout >= needed)
+      return transport_error(err);
+    *size_inout = needed;
+    if (!status && into)
+      std::memcpy(into, r.data(), needed);
+    return status;
+  }
+
+  static PASMP_status_t configure(remote::op code, PASMP_plugin_t p,
+                                  PASMP_on_config_finish_t *cb, void *data,
+                                  PASMP_error_descriptor_t *err) noexcept {
+    uint64_t cookie = 0;
+    try {
+      if (cb)
+        cookie = ch().add_completion({cb, nullptr, data});
+    } catch (const std::bad_alloc &) {
+      return PASMP_ERROR_ALLOC;
+    }
+    request r(ch(), code, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = cookie;
+    }
+    auto status = r.send();
+    if (status)
+      ch().drop(cookie);
+    return status;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_configure_gui(PASMP_plugin_t p, PASMP_on_config_finish_t *cb,
+                       void *data, PASMP_error_descriptor_t *err) noexcept {
+    return configure(remote::op::plugin_configure_gui, p, cb, data, err);
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_configure_cli(PASMP_plugin_t p, PASMP_on_config_finish_t *cb,
+                       void *data, PASMP_error_descriptor_t *err) noexcept {
+    return configure(remote::op::plugin_configure_cli, p, cb, data, err);
+  }
+
+  static PASMP_status_t PASMP_CALL
+  plugin_limit(PASMP_plugin_t p, PASMP_rate_limit_t limit,
+               PASMP_error_descriptor_t *err) noexcept {
+    request r(ch(), remote::op::plugin_limit, err);
+    if (r) {
+      r.arg(0) = value(p);
+      std::memcpy(r.data(), &limit, sizeof(limit));
+      r.data_size(sizeof(limit));
+    }
+    return r.send();
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_limit(PASMP_plugin_t p, PASMP_action_t a, PASMP_rate_limit_t limit,
+               PASMP_error_descriptor_t *err) noexcept {
+    request r(ch(), remote::op::action_limit, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+      std::memcpy(r.data(), &limit, sizeof(limit));
+      r.data_size(sizeof(limit));
+    }
+    return r.send();
+  }
+
+  static PASMP_status_t PASMP_CALL action_admission_stats(
+      PASMP_plugin_t p, PASMP_action_t a, PASMP_admission_stats_t *out,
+      PASMP_error_descriptor_t *err) noexcept {
+    if (!out)
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::action_admission_stats, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+    }
+    if (auto status = r.send())
+      return status;
+    std::memcpy(out, r.data(), sizeof(*out));
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_serialize(PASMP_action_t a, char *into, uint64_t *size_inout,
+                   PASMP_error_descriptor_t *err) noexcept {
+    return serialize(remote::op::action_serialize, value(a), into, size_inout,
+                     err);
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_deserialize(PASMP_action_t *out, const char *from, uint64_t size,
+                     PASMP_error_descriptor_t *err) noexcept {
+    if (!out || (size && !from))
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::action_deserialize, err);
+    if (auto status = deserialize(r, from, size, err))
+      return status;
+    *out = handle<PASMP_action_t>(r.arg(0));
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL action_destroy(PASMP_action_t a) noexcept {
+    return simple(remote::op::action_destroy, value(a));
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_descriptor_create(PASMP_plugin_t p, PASMP_action_t a,
+                           PASMP_action_descriptor_t *out,
+                           PASMP_error_descriptor_t *err) noexcept {
+    if (!out)
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::action_descriptor_create, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+    }
+    void *d = nullptr;
+    auto status = descriptor(r, d);
+    if (!status)
+      *out = static_cast<PASMP_action_descriptor_t>(d);
+    return status;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_descriptor_destroy(PASMP_action_descriptor_t d) noexcept {
+    delete reinterpret_cast<descriptor_proxy *>(d);
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_string_view_t PASMP_CALL
+  action_name(PASMP_action_descriptor_t d, int32_t short_variant) noexcept {
+    return view_of(descr(d).name[short_variant != 0]);
+  }
+
+  static PASMP_string_view_t PASMP_CALL action_description(
+      PASMP_action_descriptor_t d, int32_t short_variant) noexcept {
+    return view_of(descr(d).description[short_variant != 0]);
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_execute(PASMP_plugin_t p, PASMP_action_t a, PASMP_payload_t payload,
+                 PASMP_error_descriptor_t *err) noexcept {
+    request r(ch(), remote::op::action_execute, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+      if (put_payload(r, payload.tag, payload.data))
+        return transport_error(err);
+    }
+    return r.send();
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_payload_type(PASMP_plugin_t p, PASMP_action_t a,
+                      PASMP_payload_tag_t *out,
+                      PASMP_error_descriptor_t *err) noexcept {
+    if (!out)
+      return PASMP_INVALID_ARGUMENT;
+    request r(ch(), remote::op::action_payload_type, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+    }
+    if (auto status = r.send())
+      return status;
+    *out = static_cast<PASMP_payload_tag_t>(r.arg(2));
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_execute_int32(PASMP_plugin_t p, PASMP_action_t a, int32_t x,
+                       PASMP_error_descriptor_t *err) noexcept {
+    request r(ch(), remote::op::action_execute_int32, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+      r.arg(2) = static_cast<uint32_t>(x);
+    }
+    return r.send();
+  }
+
+  static PASMP_status_t PASMP_CALL
+  prepared_execute(PASMP_prepared_action_t ctx, const PASMP_payload_data_t *x,
+                   PASMP_error_descriptor_t *err) noexcept {
+    const auto &prep = *reinterpret_cast<const prepared_proxy *>(ctx);
+    request r(ch(), remote::op::prepared_execute, err);
+    if (r) {
+      r.arg(0) = prep.remote;
+      if (put_payload(r, prep.tag, x))
+        return transport_error(err);
+    }
+    return r.send();
+  }
+
+  static PASMP_status_t PASMP_CALL
+  action_prepare(PASMP_plugin_t p, PASMP_action_t a, PASMP_payload_tag_t tag,
+                 PASMP_prepared_action_t *ctx_out,
+                 PASMP_prepared_execute_t **fn_out,
+                 PASMP_error_descriptor_t *err) noexcept {
+    if (!ctx_out || !fn_out)
+      return PASMP_INVALID_ARGUMENT;
+    auto prep = std::unique_ptr<prepared_proxy>(new (std::nothrow)
+                                                    prepared_proxy{0, tag});
+    if (!prep)
+      return PASMP_ERROR_ALLOC;
+    request r(ch(), remote::op::action_prepare, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+      r.arg(2) = tag;
+    }
+    if (auto status = r.send())
+      return status;
+    prep->remote = r.arg(3);
+    *ctx_out = reinterpret_cast<PASMP_prepared_action_t>(prep.release());
+    *fn_out = &prepared_execute;
+    return PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t PASMP_CALL
+  prepared_action_destroy(PASMP_prepared_action_t ctx) noexcept {
+    auto prep = std::unique_ptr<prepared_proxy>(
+        reinterpret_cast<prepared_proxy *>(ctx));
+    return prep ? simple(remote::op::prepared_action_destroy, prep->remote)
+                : PASMP_SUCCESS;
+  }
+
+  static PASMP_status_t execute_async(PASMP_plugin_t p, PASMP_action_t a,
+                                      PASMP_payload_t payload,
+                                      PASMP_on_action_finish_t *cb, void *data,
+                                      PASMP_error_descriptor_t *err) noexcept {
+    uint64_t cookie = 0;
+    try {
+      if (cb)
+        cookie = ch().add_completion({nullptr, cb, data});
+    } catch (const std::bad_alloc &) {
+      return PASMP_ERROR_ALLOC;
+    }
+    request r(ch(), remote::op::action_execute_async, err);
+    if (r) {
+      r.arg(0) = value(p);
+      r.arg(1) = value(a);
+      r.arg(2) = cookie;
+      if (put_payload(r, payload.tag, payload.data)) {
+        ch().drop(cookie);
+        return transport_error(err);
+      }
+    }
+    auto status = r.send();
+    if (status)
+      ch().drop(cookie);
+    return status;
+  }
+
+  static PASMP_status_t PASMP_CALL action_execute_async(
+      PASMP_plugin_t p, PASMP_action_t a, PASMP_payload_t payload,
+      PASMP_on_action_finish_t *cb, void *data,
+      PASMP_error_descriptor_t *err) noexcept {
+    if (!cb)
+      return PASMP_INVALID_ARGUMENT;
+    return execute_async(p, a, payload, cb, data, err);
+  }
+
+  // the payload is copied into the request, so it is released right away
+  static PASMP_status_t PASMP_CALL action_execute_async_owned(
+      PASMP_plugin_t p, PASMP_action_t a, PASMP_payload_t payload,
+      PASMP_payload_release_t *release, void *release_data,
+      PASMP_on_action_finish_t *cb, void *data,
+      PASMP_error_descriptor_t *err) noexcept {
+    auto status = execute_async(p, a, payload, cb, data, err);
+    if (release)
+      release(release_data);
+    return status;
+  }
+
+  static uint64_t PASMP_CALL action_hash(PASMP_action_t a) noexcept {
+    request r(ch(), remote::op::action_hash, nullptr);
+    if (r)
+      r.arg(0) = value(a);
+    return r.send() ? 0 : r.arg(1);
+  }
+
+  static int32_t PASMP_CALL action_equal(PASMP_action_t a,
+                                         PASMP_action_t b) noexcept {
+    request r(ch(), remote::op::action_equal, nullptr);
+    if (r) {
+      r.arg(0) = value(a);
+      r.arg(1) = value(b);
+    }
+    return r.send() ? 0 : static_cast<int32_t>(r.arg(2));
+  }
+
+  struct entry {
+    const char *name;
+    void *address;
+  };
+
+  template <typename F> static entry make(const char *name, F *f) noexcept {
+    return {name, reinterpret_cast<void *>(f)};
+  }
+
+  static const auto &table() noexcept {
+    static const entry entries[] = {
+        make("PASMP_version", &version),
+        make("PASMP_is_library_compatible", &is_compatible),
+        make("PASMP_version_create", &version_create),
+        make("PASMP_version_destroy", &version_destroy),
+        make("PASMP_version_major", &version_major),
+        make("PASMP_version_minor", &version_minor),
+        make("PASMP_version_patch", &version_patch),
+        make("PASMP_version_pre", &version_pre),
+        make("PASMP_version_build", &version_build),
+        make("PASMP_plugin_attr_create", &plugin_attr_create),
+        make("PASMP_plugin_attr_destroy", &plugin_attr_destroy),
+        make("PASMP_plugin_attr_on_action_mod", &plugin_attr_on_action_mod),
+        make("PASMP_plugin_attr_on_action_add", &plugin_attr_on_action_add),
+        make("PASMP_plugin_attr_on_action_rm", &plugin_attr_on_action_rm),
+        make("PASMP_plugin_attr_persistence_path",
+             &plugin_attr_persistence_path),
+        make("PASMP_plugin_descriptor_create", &plugin_descriptor_create),
+        make("PASMP_plugin_descriptor_destroy", &plugin_descriptor_destroy),
+        make("PASMP_plugin_name", &plugin_name),
+        make("PASMP_plugin_description", &plugin_description),
+        make("PASMP_plugin_create", &plugin_create),
+        make("PASMP_plugin_addref", &plugin_addref),
+        make("PASMP_plugin_release", &plugin_release),
+        make("PASMP_action_collection_create", &action_collection_create),
+        make("PASMP_action_collection_destroy", &action_collection_destroy),
+        make("PASMP_action_collection_size", &action_collection_size),
+        make("PASMP_action_collection_at", &action_collection_at),
+        make("PASMP_action_collection_read", &action_collection_read),
+        make("PASMP_plugin_actions", &plugin_actions),
+        make("PASMP_plugin_serialize", &plugin_serialize),
+        make("PASMP_plugin_deserialize", &plugin_deserialize),
+        make("PASMP_plugin_extract", &plugin_extract),
+        make("PASMP_plugin_configure_gui", &plugin_configure_gui),
+        make("PASMP_plugin_configure_cli", &plugin_configure_cli),
+        make("PASMP_plugin_limit", &plugin_limit),
+        make("PASMP_action_limit", &action_limit),
+        make("PASMP_action_admission_stats", &action_admission_stats),
+        make("PASMP_action_serialize", &action_serialize),
+        make("PASMP_action_deserialize", &action_deserialize),
+        make("PASMP_action_destroy", &action_destroy),
+        make("PASMP_action_descriptor_create", &action_descriptor_create),
+        make("PASMP_action_descriptor_destroy", &action_descriptor_destroy),
+        make("PASMP_action_name", &action_name),
+        make("PASMP_action_description", &action_description),
+        make("PASMP_action_execute", &action_execute),
+        make("PASMP_action_payload_type", &action_payload_type),
+        make("PASMP_action_execute_int32", &action_execute_int32),
+        make("PASMP_action_prepare", &action_prepare),
+        make("PASMP_prepared_action_destroy", &prepared_action_destroy),
+        make("PASMP_action_execute_async", &action_execute_async),
+        make("PASMP_action_execute_async_owned", &action_execute_async_owned),
+        make("PASMP_action_hash", &action_hash),
+        make("PASMP_action_equal", &action_equal),
+    };
+    return entries;
+  }
+
+  static void *lookup(const char *name) noexcept {
+    for (const auto &e : table())
+      if (!std::strcmp(e.name, name))
+        return e.address;
+    return nullptr;
+  }
+};
+
+template <size_t... Ix>
+constexpr auto make_lookups(std::index_sequence<Ix...>) noexcept {
+  return std::array<void *(*)(const char *) noexcept, sizeof...(Ix)>{
+      &stubs<Ix>::lookup...};
+}
+
+constexpr auto lookups = make_lookups(std::make_index_sequence<max_channels>{});
+
+} // namespace
+
+namespace modl::detail {
+
+uint64_t remote_library::channel::subscribe(const subscription &x) {
+  std::scoped_lock lk(records_mtx_);
+  auto cookie = next_cookie_++;
+  subscriptions_.emplace(cookie, x);
+  return cookie;
+}
+
+uint64_t remote_library::channel::add_completion(completion x) {
+  std::scoped_lock lk(records_mtx_);
+  auto cookie = next_cookie_++;
+  completions_.emplace(cookie, x);
+  return cookie;
+}
+
+void remote_library::channel::drop(uint64_t cookie) noexcept {
+  std::scoped_lock lk(records_mtx_);
+  subscriptions_.erase(cookie);
+  completions_.erase(cookie);
+}
+
+void remote_library::channel::plugin_created(uint64_t plugin,
+                                             uint64_t cookie) {
+  std::scoped_lock lk(records_mtx_);
+  auto &rec = plugins_[plugin];
+  rec.cookies.push_back(cookie);
+  rec.refs++;
+}
+
+void remote_library::channel::plugin_addref(uint64_t plugin) noexcept {
+  std::scoped_lock lk(records_mtx_);
+  if (auto it = plugins_.find(plugin); it != plugins_.end())
+    it->second.refs++;
+}
+
+void remote_library::channel::plugin_released(uint64_t plugin) noexcept {
+  std::scoped_lock lk(records_mtx_);
+  auto it = plugins_.find(plugin);
+  if (it == plugins_.end() || --it->second.refs)
+    return;
+  for (auto cookie : it->second.cookies)
+    subscriptions_.erase(cookie);
+  plugins_.erase(it);
+}
+
+void remote_library::channel::fail_completions(const char *message) noexcept {
+  std::unordered_map<uint64_t, completion> pending;
+  {
+    std::scoped_lock lk(records_mtx_);
+    pending.swap(completions_);
+  }
+  PASMP_string_view_t msg{message, std::strlen(message)};
+  for (const auto &[cookie, c] : pending) {
+    if (c.on_config)
+      c.on_config(PASMP_UNAVAILABLE, PASMP_CONFIG_CANCEL, c.data);
+    else if (c.on_finish)
+      c.on_finish(PASMP_UNAVAILABLE, msg, c.data);
+  }
+}
+
+void remote_library::channel::deliver(const remote::event &ev) noexcept {
+  using remote::event_kind;
+  auto action = reinterpret_cast<PASMP_action_t>(ev.action);
+  std::unique_lock lk(records_mtx_);
+  switch (ev.kind) {
+  case event_kind::action_added:
+  case event_kind::action_modified:
+  case event_kind::action_removed: {
+    auto it = subscriptions_.find(ev.cookie);
+    if (it == subscriptions_.end())
+      return;
+    auto sub = it->second;
+    lk.unlock();
+    if (ev.kind == event_kind::action_added && sub.on_add)
+      sub.on_add(action, sub.add_data);
+    else if (ev.kind == event_kind::action_modified && sub.on_mod)
+      sub.on_mod(action, sub.mod_data);
+    else if (ev.kind == event_kind::action_removed && sub.on_rm)
+      sub.on_rm(action, sub.rm_data);
+  } break;
+  case event_kind::config_finished:
+  case event_kind::action_finished: {
+    auto it = completions_.find(ev.cookie);
+    if (it == completions_.end())
+      return;
+    auto c = it->second;
+    completions_.erase(it);
+    lk.unlock();
+    if (c.on_config)
+      c.on_config(ev.status, ev.config_status, c.data);
+    else if (c.on_finish)
+      c.on_finish(ev.status,
+                  {ev.message, std::min<uint64_t>(ev.message_size,
+                                                  remote::message_capacity)},
+                  c.data);
+  } break;
+  }
+}
+
+void remote_library::channel_deleter::operator()(channel *ch) const noexcept {
+  delete ch;
+}
+
+remote_library::remote_library(channel_ptr ch) : channel_(std::move(ch)) {
+  size_t ix = 0;
+  for (; ix < max_channels; ix++) {
+    channel *expected = nullptr;
+    if (channels[ix].compare_exchange_strong(expected, channel_.get(),
+                                             std::memory_order_acq_rel))
+      break;
+  }
+  if (ix == max_channels)
+    throw std::system_error(
+        std::make_error_code(std::errc::resource_unavailable_try_again),
+        "Too many modules hosted out of process");
+  channel_->index = ix;
+}
+
+remote_library::~remote_library() {
+  auto ix = channel_->index;
+  channel_.reset();
+  channels[ix].store(nullptr, std::memory_order_release);
+}
+
+void *remote_library::symbol(const char *name) const noexcept {
+  return lookups[channel_->index](name);
+}
+
+bool remote_library::alive() const noexcept { return channel_->alive(); }
+
+} // namespace modl::detail
@@ -0,0 +1,35 @@
+#include "remote_library.hpp"
+
+#include <system_error>
+#include <utility>
+
+namespace modl::detail {
+
+// the transports rely on futexes and Unix domain sockets
+struct remote_library::channel {};
+
+void remote_library::channel_deleter::operator()(channel *ch) const noexcept {
+  delete ch;
+}
+
+remote_library::remote_library(channel_ptr ch) : channel_(std::move(ch)) {}
+
+remote_library::~remote_library() = default;
+
+void *remote_library::symbol(const char *) const noexcept { return nullptr; }
+
+bool remote_library::alive() const noexcept { return false; }
+
+remote_library::channel_ptr
+spawn_runner(const std::filesystem::path &, const std::filesystem::path &) {
+  throw std::system_error(std::make_error_code(std::errc::not_supported),
+                          "Out of process modules are not supported");
+}
+
+remote_library::channel_ptr
+connect_daemon(const std::filesystem::path &, const std::filesystem::path &) {
+  throw std::system_error(std::make_error_code(std::errc::not_supported),
+                          "Plugin host daemons are not supported");
+}
+
+} // namespace modl::detail
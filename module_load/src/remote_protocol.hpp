@@ -0,0 +1,245 @@
+#pragma once
+
+#include <plugin/plugin_interface.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// Layout of the shared memory segment between a host and the runner process
+// that hosts a module for it, see remote_library. Calls go through a ring of
+// slots, each carrying one request and its response; callbacks come back
+// through a ring of events. Waiting sides spin briefly, then sleep on a futex.
+namespace modl::detail::remote {
+
+constexpr uint32_t magic = 0x504d5341; // "ASMP"
+constexpr size_t slot_count = 64;
+constexpr size_t arg_count = 8;
+constexpr size_t data_capacity = 64 * 1024;
+constexpr size_t error_capacity = 512;
+constexpr size_t event_count = 256;
+constexpr size_t message_capacity = 256;
+
+enum class op : uint32_t {
+  // releases the slot without a response, for requests that were abandoned
+  noop,
+  is_compatible,
+  version_create,
+  plugin_descriptor_create,
+  plugin_create,
+  plugin_addref,
+  plugin_release,
+  plugin_actions,
+  plugin_serialize,
+  plugin_deserialize,
+  plugin_extract,
+  plugin_configure_gui,
+  plugin_configure_cli,
+  plugin_limit,
+  action_limit,
+  action_admission_stats,
+  action_serialize,
+  action_deserialize,
+  action_destroy,
+  action_descriptor_create,
+  action_execute,
+  action_payload_type,
+  action_execute_int32,
+  action_prepare,
+  prepared_execute,
+  prepared_action_destroy,
+  action_execute_async,
+  action_hash,
+  action_equal,
+};
+
+enum slot_state : uint32_t {
+  slot_free,
+  slot_writing,
+  slot_ready,
+  slot_running,
+  slot_done,
+};
+
+struct slot {
+  std::atomic<uint32_t> state;
+  std::atomic<uint32_t> waiters;
+  op code;
+  PASMP_status_t status;
+  uint64_t args[arg_count];
+  // capacity of the caller's error descriptor in the request, what is left of
+  // it in the response
+  uint64_t error_size;
+  uint64_t data_size;
+  char error[error_capacity];
+  char data[data_capacity];
+};
+
+enum class event_kind : uint32_t {
+  action_added,
+  action_modified,
+  action_removed,
+  config_finished,
+  action_finished,
+};
+
+struct event {
+  event_kind kind;
+  PASMP_status_t status;
+  PASMP_config_status_t config_status;
+  uint64_t cookie;
+  uint64_t action;
+  uint64_t message_size;
+  char message[message_capacity];
+};
+
+struct segment {
+  uint32_t magic;
+  // set by the runner once the module is loaded, or failed to load
+  std::atomic<uint32_t> started;
+  std::atomic<uint32_t> stop;
+  uint32_t plugin_version;
+  // set by the host before spawning the runner, which exits once it has
+  // another parent
+  int32_t host_pid;
+  char load_error[error_capacity];
+
+  // tickets, each mapping to the slot at ticket % slot_count
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+  slot slots[slot_count];
+
+  std::atomic<uint32_t> event_head;
+  std::atomic<uint32_t> event_tail;
+  std::atomic<uint32_t> event_waiters;
+  event events[event_count];
+};
+
+enum start_state : uint32_t {
+  start_pending,
+  start_ok,
+  start_failed,
+};
+
+// the segment is shared between processes, so these cannot be private futexes
+inline void futex_wait(std::atomic<uint32_t> &word, uint32_t expected,
+                       std::chrono::nanoseconds timeout) noexcept {
+  timespec ts{.tv_sec = static_cast<time_t>(timeout.count() / 1'000'000'000),
+              .tv_nsec = static_cast<long>(timeout.count() % 1'000'000'000)};
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected,
+          &ts, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t> &word) noexcept {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT32_MAX,
+          nullptr, nullptr, 0);
+}
+
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// the other side is usually spinning already, in which case this skips the
+// system call
+inline void publish(std::atomic<uint32_t> &word, std::atomic<uint32_t> &waiters,
+                    uint32_t value) noexcept {
+  word.store(value, std::memory_order_seq_cst);
+  if (waiters.load(std::memory_order_seq_cst))
+    futex_wake(word);
+}
+
+// spinning only pays off while the other side runs on another core
+inline int spin_count() noexcept {
+  static const int x = std::thread::hardware_concurrency() > 1 ? 4096 : 0;
+  return x;
+}
+
+// waits while word holds from; gives up, returning false, once keep_waiting
+// returns false after a timed out sleep
+template <typename Predicate>
+bool wait_while(std::atomic<uint32_t> &word, std::atomic<uint32_t> &waiters,
+                uint32_t from, Predicate keep_waiting) noexcept {
+  const int spins = spin_count();
+  constexpr std::chrono::milliseconds nap{20};
+  for (int i = 0; i < spins; i++) {
+    if (word.load(std::memory_order_acquire) != from)
+      return true;
+    cpu_relax();
+  }
+  while (word.load(std::memory_order_acquire) == from) {
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    if (word.load(std::memory_order_seq_cst) == from)
+      futex_wait(word, from, nap);
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+    if (word.load(std::memory_order_acquire) == from && !keep_waiting())
+      return false;
+  }
+  return true;
+}
+
+// The daemon carries the same calls over a stream socket, in frames of a
+// frame_header followed by size bytes. A call holds a call_header and the
+// request data; its response holds a call_header, the error text and the
+// response data, and may overtake the responses to earlier calls. An event
+// holds an event cut short after its message. The first frame of a connection
+// is an open naming the module; its response holds the plugin version in
+// args[0].
+enum class frame_kind : uint32_t {
+  open,
+  call,
+  event,
+};
+
+struct frame_header {
+  uint32_t size;
+  frame_kind kind;
+  uint64_t id;
+};
+
+struct call_header {
+  op code;
+  PASMP_status_t status;
+  uint64_t args[arg_count];
+  uint64_t error_size;
+  uint64_t error_length;
+  uint64_t data_size;
+};
+
+constexpr size_t frame_capacity =
+    sizeof(call_header) + error_capacity + data_capacity;
+
+inline size_t event_size(const event &ev) noexcept {
+  return offsetof(event, message) + ev.message_size;
+}
+
+// the requests of the other calls leave their data in the slot
+inline uint64_t response_data_size(const slot &s) noexcept {
+  switch (s.code) {
+  case op::version_create:
+  case op::plugin_descriptor_create:
+  case op::plugin_actions:
+  case op::action_admission_stats:
+  case op::action_descriptor_create:
+    return s.data_size;
+  case op::plugin_serialize:
+  case op::action_serialize:
+    return s.args[1] && s.status == PASMP_SUCCESS ? s.args[2] : 0;
+  case op::plugin_extract:
+    return s.args[2] && s.status == PASMP_SUCCESS ? s.args[3] : 0;
+  default:
+    return 0;
+  }
+}
+
+} // namespace modl::detail::remote
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace modl::detail::remote {
+
+// Strings in the data area of a slot, each preceded by its size
+class wire_writer {
+public:
+  wire_writer(char *first, char *last) noexcept
+      : first_(first), pos_(first), last_(last) {}
+
+  void put(std::string_view x) noexcept {
+    uint64_t size = x.size();
+    if (!ok_ || static_cast<size_t>(last_ - pos_) < sizeof(size) + size) {
+      ok_ = false;
+      return;
+    }
+    std::memcpy(pos_, &size, sizeof(size));
+    if (size)
+      std::memcpy(pos_ + sizeof(size), x.data(), size);
+    pos_ += sizeof(size) + size;
+  }
+
+  explicit operator bool() const noexcept { return ok_; }
+  uint64_t size() const noexcept { return pos_ - first_; }
+
+private:
+  char *first_;
+  char *pos_;
+  char *last_;
+  bool ok_ = true;
+};
+
+class wire_reader {
+public:
+  wire_reader(const char *first, const char *last) noexcept
+      : pos_(first), last_(last) {}
+
+  // empty once the data runs out
+  std::string_view get() noexcept {
+    uint64_t size;
+    if (static_cast<size_t>(last_ - pos_) < sizeof(size))
+      return {};
+    std::memcpy(&size, pos_, sizeof(size));
+    pos_ += sizeof(size);
+    if (static_cast<size_t>(last_ - pos_) < size)
+      size = last_ - pos_;
+    std::string_view x(pos_, size);
+    pos_ += size;
+    return x;
+  }
+
+private:
+  const char *pos_;
+  const char *last_;
+};
+
+} // namespace modl::detail::remote
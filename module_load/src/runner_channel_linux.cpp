@@ -0,0 +1,226 @@
+#include "remote_channel.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+extern char **environ;
+
+namespace {
+
+namespace remote = modl::detail::remote;
+
+std::system_error last_system_error(const char *what) {
+  return {std::error_code(errno, std::system_category()), what};
+}
+
+std::filesystem::path default_runner() {
+  return std::filesystem::read_symlink("/proc/self/exe").parent_path() /
+         "PluginRunner";
+}
+
+std::string segment_name() {
+  static std::atomic<uint32_t> counter = 0;
+  return "/pasmp-" + std::to_string(getpid()) + "-" +
+         std::to_string(counter.fetch_add(1));
+}
+
+// Requests go through the slots of a segment shared with a runner spawned for
+// the module. Slots are claimed in ticket order, matching the order in which
+// the runner's workers wait on them, so a claimed slot that ends up unused is
+// still handed over, as a noop.
+class runner_channel final : public modl::detail::remote_library::channel {
+public:
+  runner_channel(const std::filesystem::path &module,
+                 const std::filesystem::path &runner);
+  ~runner_channel() override;
+
+  bool alive() const noexcept override;
+
+  uint32_t plugin_version() const noexcept override {
+    return seg_->plugin_version;
+  }
+
+  remote::slot *acquire() noexcept override;
+  bool exchange(remote::slot &) noexcept override;
+  void release(remote::slot &, bool exchanged) noexcept override;
+
+private:
+  void dispatch_events(std::stop_token);
+  bool reap() const noexcept;
+
+  remote::segment *seg_ = nullptr;
+  pid_t pid_ = -1;
+  mutable std::mutex reap_mtx_;
+  mutable std::atomic<bool> exited_ = false;
+  std::jthread events_;
+};
+
+runner_channel::runner_channel(const std::filesystem::path &module,
+                               const std::filesystem::path &runner) {
+  auto name = segment_name();
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0)
+    throw last_system_error("Error creating plugin runner channel");
+  if (ftruncate(fd, sizeof(remote::segment))) {
+    auto e = last_system_error("Error sizing plugin runner channel");
+    close(fd);
+    shm_unlink(name.c_str());
+    throw e;
+  }
+  void *addr = mmap(nullptr, sizeof(remote::segment), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    auto e = last_system_error("Error mapping plugin runner channel");
+    shm_unlink(name.c_str());
+    throw e;
+  }
+  // the mapping is zero-filled, which is the initial state of every member
+  seg_ = static_cast<remote::segment *>(addr);
+  seg_->magic = remote::magic;
+  seg_->host_pid = getpid();
+
+  auto runner_path = runner.empty() ? default_runner() : runner;
+  auto module_path = module.string();
+  std::string runner_str = runner_path.string();
+  char *argv[] = {runner_str.data(), module_path.data(), name.data(), nullptr};
+  if (int e = posix_spawn(&pid_, runner_str.c_str(), nullptr, nullptr, argv,
+                          environ)) {
+    shm_unlink(name.c_str());
+    munmap(seg_, sizeof(remote::segment));
+    throw std::system_error(std::error_code(e, std::system_category()),
+                            "Error starting plugin runner");
+  }
+
+  remote::wait_while(seg_->started, seg_->event_waiters, remote::start_pending,
+                     [this]() { return reap(); });
+  shm_unlink(name.c_str());
+  if (seg_->started.load() != remote::start_ok) {
+    std::string msg = seg_->started.load() == remote::start_failed
+                          ? seg_->load_error
+                          : "Plugin runner exited while loading the module";
+    if (reap())
+      kill(pid_, SIGKILL);
+    waitpid(pid_, nullptr, 0);
+    munmap(seg_, sizeof(remote::segment));
+    throw std::system_error(std::make_error_code(std::errc::io_error), msg);
+  }
+  events_ = std::jthread([this](std::stop_token st) { dispatch_events(st); });
+}
+
+runner_channel::~runner_channel() {
+  events_.request_stop();
+  remote::futex_wake(seg_->event_head);
+  events_.join();
+
+  seg_->stop.store(1);
+  remote::futex_wake(seg_->stop);
+  for (auto &s : seg_->slots)
+    remote::futex_wake(s.state);
+  using namespace std::chrono_literals;
+  for (auto deadline = std::chrono::steady_clock::now() + 1s;
+       reap() && std::chrono::steady_clock::now() < deadline;)
+    std::this_thread::sleep_for(1ms);
+  if (reap()) {
+    kill(pid_, SIGKILL);
+    waitpid(pid_, nullptr, 0);
+  }
+  munmap(seg_, sizeof(remote::segment));
+}
+
+bool runner_channel::alive() const noexcept {
+  return !exited_.load(std::memory_order_acquire);
+}
+
+// costs a system call, so only made after a timed out wait, by the event
+// thread among others
+bool runner_channel::reap() const noexcept {
+  if (exited_.load(std::memory_order_acquire))
+    return false;
+  std::scoped_lock lk(reap_mtx_);
+  if (exited_.load(std::memory_order_relaxed))
+    return false;
+  if (waitpid(pid_, nullptr, WNOHANG) != 0) {
+    exited_.store(true, std::memory_order_release);
+    return false;
+  }
+  return true;
+}
+
+remote::slot *runner_channel::acquire() noexcept {
+  if (!alive())
+    return nullptr;
+  auto ticket = seg_->head.fetch_add(1, std::memory_order_relaxed);
+  auto &s = seg_->slots[ticket % remote::slot_count];
+  auto keep_waiting = [this]() { return reap(); };
+  while (true) {
+    uint32_t expected = remote::slot_free;
+    if (s.state.compare_exchange_strong(expected, remote::slot_writing,
+                                        std::memory_order_acquire))
+      return &s;
+    if (!remote::wait_while(s.state, s.waiters, expected, keep_waiting))
+      return nullptr;
+  }
+}
+
+bool runner_channel::exchange(remote::slot &s) noexcept {
+  remote::publish(s.state, s.waiters, remote::slot_ready);
+  auto keep_waiting = [this]() { return reap(); };
+  for (auto st = s.state.load(std::memory_order_acquire);
+       st != remote::slot_done; st = s.state.load(std::memory_order_acquire))
+    if (!remote::wait_while(s.state, s.waiters, st, keep_waiting))
+      return false;
+  return true;
+}
+
+void runner_channel::release(remote::slot &s, bool exchanged) noexcept {
+  if (exchanged) {
+    remote::publish(s.state, s.waiters, remote::slot_free);
+  } else if (s.state.load(std::memory_order_relaxed) == remote::slot_writing) {
+    s.code = remote::op::noop;
+    remote::publish(s.state, s.waiters, remote::slot_ready);
+  }
+}
+
+void runner_channel::dispatch_events(std::stop_token st) {
+  auto &head = seg_->event_head;
+  auto tail = seg_->event_tail.load(std::memory_order_relaxed);
+  auto keep_waiting = [&]() { return !st.stop_requested() && reap(); };
+  while (!st.stop_requested()) {
+    if (head.load(std::memory_order_acquire) == tail) {
+      if (!remote::wait_while(head, seg_->event_waiters, tail, keep_waiting) &&
+          !st.stop_requested()) {
+        // every event the runner raised before exiting was delivered
+        fail_completions("Plugin host exited");
+        return;
+      }
+      continue;
+    }
+    remote::event ev = seg_->events[tail % remote::event_count];
+    remote::publish(seg_->event_tail, seg_->event_waiters, ++tail);
+    deliver(ev);
+  }
+}
+
+} // namespace
+
+namespace modl::detail {
+
+remote_library::channel_ptr
+spawn_runner(const std::filesystem::path &module,
+             const std::filesystem::path &runner) {
+  return remote_library::channel_ptr(new runner_channel(module, runner));
+}
+
+} // namespace modl::detail
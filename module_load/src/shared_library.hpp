@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <system_error>
+
+namespace modl::detail {
+
+// Thin wrapper over the platform's dynamic loader: LoadLibraryW and
+// GetProcAddress on Windows, dlopen and dlsym elsewhere.
+class shared_library {
+public:
+  // resolve_now asks the loader to bind the library's own dependencies
+  // immediately where the platform allows choosing
+  shared_library(const std::filesystem::path &, bool resolve_now);
+  ~shared_library();
+
+  shared_library(const shared_library &) = delete;
+  shared_library &operator=(const shared_library &) = delete;
+
+  // null if the library does not export the symbol
+  void *symbol(const char *) const noexcept;
+
+  static std::error_code last_error() noexcept;
+
+private:
+  void *handle_;
+};
+
+} // namespace modl::detail
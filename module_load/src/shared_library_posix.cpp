@@ -0,0 +1,39 @@
+#include "shared_library.hpp"
+
+#include <dlfcn.h>
+
+#include <cassert>
+#include <cerrno>
+#include <iostream>
+#include <string>
+
+namespace modl::detail {
+
+shared_library::shared_library(const std::filesystem::path &path,
+                               bool resolve_now)
+    : handle_(dlopen(path.c_str(),
+                     (resolve_now ? RTLD_NOW : RTLD_LAZY) | RTLD_LOCAL)) {
+  if (!handle_)
+    throw std::system_error(last_error(),
+                            std::string("Error loading library: ")
+                                .append(dlerror()));
+}
+
+shared_library::~shared_library() {
+  if (dlclose(handle_)) {
+    assert(false);
+    std::cerr << "Error freeing library: " << dlerror();
+  }
+}
+
+void *shared_library::symbol(const char *name) const noexcept {
+  return dlsym(handle_, name);
+}
+
+// dlopen and dlsym only describe errors through dlerror(), errno is merely
+// a best effort
+std::error_code shared_library::last_error() noexcept {
+  return {errno ? errno : ENOENT, std::generic_category()};
+}
+
+} // namespace modl::detail
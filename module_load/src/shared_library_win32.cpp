@@ -0,0 +1,34 @@
+#include "shared_library.hpp"
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <libloaderapi.h>
+
+#include <cassert>
+#include <iostream>
+
+namespace modl::detail {
+
+shared_library::shared_library(const std::filesystem::path &path, bool)
+    : handle_(LoadLibraryW(path.native().c_str())) {
+  if (!handle_)
+    throw std::system_error(last_error(), "Error loading library");
+}
+
+shared_library::~shared_library() {
+  if (!FreeLibrary(static_cast<HMODULE>(handle_))) {
+    assert(false);
+    std::cerr << "Error freeing library: " << last_error();
+  }
+}
+
+void *shared_library::symbol(const char *name) const noexcept {
+  return reinterpret_cast<void *>(reinterpret_cast<intptr_t>(
+      GetProcAddress(static_cast<HMODULE>(handle_), name)));
+}
+
+std::error_code shared_library::last_error() noexcept {
+  return {static_cast<int>(GetLastError()), std::system_category()};
+}
+
+} // namespace modl::detail
@@ -1,13 +1,41 @@
 #include "plugin_impl.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <charconv>
 #include <iostream>
+#include <iterator>
 
 namespace {
 
-plugin::action_id next_id() {
-  static std::atomic<plugin::action_id> id = 0;
-  return ++id;
+std::atomic<plugin::action_id> last_id = 0;
+
+plugin::action_id next_id() { return ++last_id; }
+
+// ids handed out from now on stay clear of an imported one
+void reserve_id(plugin::action_id x) {
+  auto current = last_id.load();
+  while (current < x && !last_id.compare_exchange_weak(current, x))
+    ;
+}
+
+template <typename T>
+bool parse_field(std::string_view &in, char delim, T &out, int base = 10) {
+  auto end = in.find(delim);
+  if (end == std::string_view::npos)
+    return false;
+  auto [ptr, ec] = std::from_chars(in.data(), in.data() + end, out, base);
+  if (ec != std::errc{} || ptr != in.data() + end)
+    return false;
+  in.remove_prefix(end + 1);
+  return true;
+}
+
+void write_action(std::string &out, plugin::action_id id,
+                  const plugin::action_descriptor_t &desc) {
+  fmt::format_to(std::back_inserter(out), "{:x} {} {}\n{}{}", id,
+                 desc.name().size(), desc.description().size(), desc.name(),
+                 desc.description());
 }
 
 } // namespace
@@ -25,6 +53,11 @@ plugin_descriptor_t::plugin_descriptor_t()
 action::action(action_descriptor_t desc)
     : id_(next_id()), desc_(std::move(desc)) {}
 
+action::action(action_id id, action_descriptor_t desc)
+    : id_(id), desc_(std::move(desc)) {
+  reserve_id(id);
+}
+
 action::action(const action &x) : action(x, readlock_t{x.mut_}) {}
 
 action::action(action &&x) : action(std::move(x), writelock_t{x.mut_}) {}
@@ -82,6 +115,54 @@ void action::execute(std::ostream &os, int32_t val) {
   os << val << "\n";
 }
 
+void admission_gate::limit(rate_limit_t x) {
+  std::scoped_lock lk(mtx_);
+  limit_ = x;
+  tokens_ = static_cast<double>(x.burst);
+  last_ = clock::now();
+}
+
+bool admission_gate::try_acquire() {
+  std::scoped_lock lk(mtx_);
+  if (limit_.max_in_flight && in_flight_ >= limit_.max_in_flight)
+    return false;
+  if (limit_.rate > 0) {
+    auto now = clock::now();
+    std::chrono::duration<double> elapsed = now - last_;
+    tokens_ = std::min(static_cast<double>(limit_.burst),
+                       tokens_ + elapsed.count() * limit_.rate);
+    last_ = now;
+    if (tokens_ < 1)
+      return false;
+    tokens_ -= 1;
+  }
+  in_flight_++;
+  return true;
+}
+
+void admission_gate::refund() noexcept {
+  std::scoped_lock lk(mtx_);
+  if (limit_.rate > 0)
+    tokens_ = std::min(static_cast<double>(limit_.burst), tokens_ + 1);
+  in_flight_--;
+}
+
+void admission_gate::release() noexcept {
+  std::scoped_lock lk(mtx_);
+  in_flight_--;
+}
+
+void admission_gate::count(bool admitted) noexcept {
+  (admitted ? admitted_ : rejected_).fetch_add(1, std::memory_order_relaxed);
+}
+
+admission_stats_t admission_gate::stats() const {
+  std::scoped_lock lk(mtx_);
+  return {.admitted = admitted_.load(std::memory_order_relaxed),
+          .rejected = rejected_.load(std::memory_order_relaxed),
+          .in_flight = in_flight_};
+}
+
 action_descriptor_t::action_descriptor_t(std::string name, std::string desc)
     : name_(std::move(name)), desc_(std::move(desc)) {}
 
@@ -162,6 +243,10 @@ void my_plugin::insert(action x) {
   auto [it, inserted] = actions_.insert(std::move(x));
   if (!inserted)
     throw action_already_exists(x.id());
+  {
+    std::scoped_lock glk(states_mtx_);
+    states_.try_emplace(it->id(), std::make_shared<action_state>());
+  }
   attr_.on_action_added(it->id());
 }
 
@@ -172,6 +257,7 @@ void my_plugin::modify(action x) {
     throw action_does_not_exist(x.id());
   // modifiable values do not affect the hash computation
   const_cast<action &>(*it) = std::move(x);
+  state(it->id())->generation.fetch_add(1, std::memory_order_relaxed);
   attr_.on_action_modified(it->id());
 }
 
@@ -181,6 +267,12 @@ void my_plugin::remove(action_id id) {
   if (it == actions_.end())
     throw action_does_not_exist(id);
   actions_.erase(it);
+  {
+    std::scoped_lock glk(states_mtx_);
+    auto sit = states_.find(id);
+    sit->second->generation.fetch_add(1, std::memory_order_relaxed);
+    states_.erase(sit);
+  }
   attr_.on_action_removed(id);
 }
 
@@ -208,7 +300,53 @@ bool my_plugin::configure(config_callback_t cb) {
   return res;
 }
 
+my_plugin::admission_ticket::admission_ticket(
+    std::shared_ptr<action_state> state, admission_gate &plugin_gate)
+    : state_(std::move(state)), plugin_gate_(plugin_gate) {}
+
+my_plugin::admission_ticket::~admission_ticket() {
+  state_->gate.release();
+  plugin_gate_.release();
+}
+
+std::shared_ptr<action_state> my_plugin::state(action_id id) const {
+  std::shared_lock lk(states_mtx_);
+  auto it = states_.find(id);
+  if (it == states_.end())
+    throw action_does_not_exist(id);
+  return it->second;
+}
+
+my_plugin::admission_ticket my_plugin::admit(action_id id) const {
+  return admit(state(id), id);
+}
+
+my_plugin::admission_ticket my_plugin::admit(std::shared_ptr<action_state> s,
+                                             action_id id) const {
+  bool admitted = s->gate.try_acquire();
+  if (admitted && !plugin_gate_.try_acquire()) {
+    s->gate.refund();
+    admitted = false;
+  }
+  s->gate.count(admitted);
+  plugin_gate_.count(admitted);
+  if (!admitted)
+    throw admission_rejected(id);
+  return admission_ticket{std::move(s), plugin_gate_};
+}
+
+void my_plugin::limit(rate_limit_t x) { plugin_gate_.limit(x); }
+
+void my_plugin::limit(action_id id, rate_limit_t x) {
+  state(id)->gate.limit(x);
+}
+
+admission_stats_t my_plugin::admission(action_id id) const {
+  return state(id)->gate.stats();
+}
+
 void my_plugin::execute(action_id id, int32_t val) const {
+  auto ticket = admit(id);
   readlock_t lk(mtx_);
   auto it = actions_.find(id);
   if (it == actions_.end())
@@ -216,6 +354,34 @@ void my_plugin::execute(action_id id, int32_t val) const {
   const_cast<action &>(*it).execute(std::cout, val);
 }
 
+std::unique_ptr<my_plugin::prepared> my_plugin::prepare(action_id id) {
+  readlock_t lk(mtx_);
+  auto it = actions_.find(id);
+  if (it == actions_.end())
+    throw action_does_not_exist(id);
+  return std::unique_ptr<prepared>(new prepared(*this, id, *it, state(id)));
+}
+
+my_plugin::prepared::prepared(my_plugin &p, action_id id, const action &a,
+                              std::shared_ptr<action_state> s)
+    : plugin_(p), id_(id), action_(a), state_(std::move(s)),
+      generation_(state_->generation.load(std::memory_order_relaxed)) {
+  plugin_.addref();
+}
+
+my_plugin::prepared::~prepared() { plugin_.release(); }
+
+void my_plugin::prepared::execute(int32_t val) const {
+  if (state_->generation.load(std::memory_order_relaxed) != generation_)
+    throw action_stale(id_);
+  auto ticket = plugin_.admit(state_, id_);
+  readlock_t lk(plugin_.mtx_);
+  // checked again now that the action can no longer be removed from under us
+  if (state_->generation.load(std::memory_order_relaxed) != generation_)
+    throw action_stale(id_);
+  const_cast<action &>(action_).execute(std::cout, val);
+}
+
 action my_plugin::retrieve(action_id id) const {
   readlock_t lk(mtx_);
   auto it = actions_.find(id);
@@ -224,6 +390,48 @@ action my_plugin::retrieve(action_id id) const {
   return *it;
 }
 
+// every action is written as "<hex id> <name size> <description size>\n"
+// followed by the name and description; an id of zero stands for a new one
+std::string my_plugin::serialize() const {
+  std::string out;
+  readlock_t lk(mtx_);
+  for (const auto &a : actions_)
+    write_action(out, a.id(), a.descriptor());
+  return out;
+}
+
+std::string my_plugin::serialize(action_id id) const {
+  std::string out;
+  write_action(out, 0, retrieve(id).descriptor());
+  return out;
+}
+
+void my_plugin::deserialize(std::string_view in) {
+  std::vector<action> imported;
+  while (!in.empty()) {
+    action_id id;
+    size_t name_size, desc_size;
+    if (!parse_field(in, ' ', id, 16) || !parse_field(in, ' ', name_size) ||
+        !parse_field(in, '\n', desc_size) ||
+        in.size() < name_size + desc_size)
+      throw malformed_state();
+    action_descriptor_t desc{std::string(in.substr(0, name_size)),
+                             std::string(in.substr(name_size, desc_size))};
+    if (id)
+      imported.emplace_back(id, std::move(desc));
+    else
+      imported.emplace_back(std::move(desc));
+    in.remove_prefix(name_size + desc_size);
+  }
+  for (auto &a : imported) {
+    try {
+      insert(a);
+    } catch (const action_already_exists &) {
+      modify(std::move(a));
+    }
+  }
+}
+
 std::vector<action_id> my_plugin::snapshot() const {
   readlock_t lk(mtx_);
   std::vector<action_id> ids;
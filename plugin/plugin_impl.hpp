@@ -1,12 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <iosfwd>
+#include <memory>
+#include <mutex>
 #include <semaphore>
 #include <shared_mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <fmt/format.h>
@@ -55,6 +61,31 @@ private:
   }
 };
 
+class admission_rejected : public action_error {
+public:
+  explicit admission_rejected(action_id x) : action_error(message(x)) {}
+
+private:
+  std::string message(action_id x) const {
+    return fmt::format("Execution of action {} rejected by admission limit", x);
+  }
+};
+
+class action_stale : public action_error {
+public:
+  explicit action_stale(action_id x) : action_error(message(x)) {}
+
+private:
+  std::string message(action_id x) const {
+    return fmt::format("Action {} changed since it was prepared", x);
+  }
+};
+
+class malformed_state : public error {
+public:
+  malformed_state() : error("Malformed plugin state") {}
+};
+
 class invalid_path : public std::system_error {
 public:
   using system_error::system_error;
@@ -89,6 +120,51 @@ struct plugin_attributes_t {
   std::filesystem::path persistence_path;
 };
 
+struct rate_limit_t {
+  double rate = 0;
+  uint64_t burst = 0;
+  uint64_t max_in_flight = 0;
+};
+
+struct admission_stats_t {
+  uint64_t admitted = 0;
+  uint64_t rejected = 0;
+  uint64_t in_flight = 0;
+};
+
+// Token bucket combined with a cap on concurrent executions. A zero rate or
+// in-flight limit disables the respective check.
+class admission_gate {
+public:
+  using clock = std::chrono::steady_clock;
+
+  void limit(rate_limit_t);
+
+  bool try_acquire();
+  void refund() noexcept;
+  void release() noexcept;
+
+  void count(bool admitted) noexcept;
+  admission_stats_t stats() const;
+
+private:
+  mutable std::mutex mtx_;
+  rate_limit_t limit_;
+  double tokens_ = 0;
+  clock::time_point last_;
+  uint64_t in_flight_ = 0;
+  std::atomic<uint64_t> admitted_ = 0;
+  std::atomic<uint64_t> rejected_ = 0;
+};
+
+// Per-action state that outlives the action for as long as a prepared
+// execution or an admitted one refers to it. The generation advances, under
+// the plugin's write lock, whenever the action is modified or removed.
+struct action_state {
+  admission_gate gate;
+  std::atomic<uint64_t> generation = 0;
+};
+
 struct action_descriptor_t {
 public:
   action_descriptor_t(std::string name, std::string desc);
@@ -118,6 +194,8 @@ public:
   };
 
   explicit action(action_descriptor_t);
+  // keeps the identity of an action moved over from another instance
+  action(action_id, action_descriptor_t);
   action(const action &);
   action(action &&);
 
@@ -154,12 +232,48 @@ struct my_plugin {
   my_plugin(const my_plugin &) = delete;
   my_plugin &operator=(const my_plugin &) = delete;
 
+  // an action resolved once, executed without looking it up again
+  class prepared {
+  public:
+    prepared(const prepared &) = delete;
+    prepared &operator=(const prepared &) = delete;
+    ~prepared();
+
+    void execute(int32_t) const;
+
+  private:
+    friend my_plugin;
+
+    prepared(my_plugin &, action_id, const action &,
+             std::shared_ptr<action_state>);
+
+    my_plugin &plugin_;
+    action_id id_;
+    // only dereferenced while the generation is unchanged
+    const action &action_;
+    std::shared_ptr<action_state> state_;
+    uint64_t generation_;
+  };
+
   void execute(action_id, int32_t) const;
+  std::unique_ptr<prepared> prepare(action_id);
 
   action retrieve(action_id) const;
   std::vector<action_id> snapshot() const;
+
+  // the actions, to be moved to another instance of the module
+  std::string serialize() const;
+  // a single action without its id, which deserialize() adds as a new one
+  std::string serialize(action_id) const;
+  // adds or updates the actions, keeping their ids
+  void deserialize(std::string_view);
+  void remove(action_id);
   bool configure(config_callback_t);
 
+  void limit(rate_limit_t);
+  void limit(action_id, rate_limit_t);
+  admission_stats_t admission(action_id) const;
+
   static my_plugin &create(const plugin_attributes_t &attr) {
     static std::mutex mux;
     return create(attr, std::unique_lock{mux});
@@ -194,15 +308,37 @@ private:
 
   void insert(action);
   void modify(action);
-  void remove(action_id);
 
   void configuration_procedure(std::stop_token);
 
+  // holds the gates of an admitted execution until it finishes
+  class admission_ticket {
+  public:
+    admission_ticket(std::shared_ptr<action_state>, admission_gate &);
+    admission_ticket(const admission_ticket &) = delete;
+    admission_ticket &operator=(const admission_ticket &) = delete;
+    ~admission_ticket();
+
+  private:
+    std::shared_ptr<action_state> state_;
+    admission_gate &plugin_gate_;
+  };
+
+  std::shared_ptr<action_state> state(action_id) const;
+  admission_ticket admit(action_id) const;
+  admission_ticket admit(std::shared_ptr<action_state>, action_id) const;
+
   std::atomic<int64_t> count_;
   plugin_attributes_t attr_;
   std::unordered_set<action, action::hash, action::equal> actions_;
   mutable mutex_t mtx_;
 
+  // admission is decided under its own lock so that rejected executions never
+  // contend on mtx_
+  std::unordered_map<action_id, std::shared_ptr<action_state>> states_;
+  mutable admission_gate plugin_gate_;
+  mutable std::shared_mutex states_mtx_;
+
   mutable std::binary_semaphore sem_to_cfg_;
   mutable std::binary_semaphore sem_from_cfg_;
   config_callback_t cfgcallback_;
@@ -6,6 +6,7 @@
 #include <charconv>
 #include <iostream>
 #include <string_view>
+#include <utility>
 
 namespace {
 
@@ -88,6 +89,14 @@ PASMP_status_t invalid_argument(PASMP_error_descriptor_t *err,
   return PASMP_INVALID_ARGUMENT;
 }
 
+bool is_valid(PASMP_rate_limit_t x) noexcept {
+  return x.rate >= 0 && (x.rate == 0 || x.burst > 0);
+}
+
+plugin::rate_limit_t to_rate_limit(PASMP_rate_limit_t x) noexcept {
+  return {.rate = x.rate, .burst = x.burst, .max_in_flight = x.max_in_flight};
+}
+
 plugin::action_id remove_msb(plugin::action_id x) {
   return x & (std::numeric_limits<decltype(x)>::max() >> 1);
 }
@@ -137,6 +146,20 @@ PASMP_status_t PASMP_action_collection_at(PASMP_action_collection_t col,
   return PASMP_SUCCESS;
 }
 
+PASMP_status_t PASMP_action_collection_read(PASMP_action_collection_t col,
+                                            uint64_t offset,
+                                            PASMP_action_t *out,
+                                            uint64_t *count_inout,
+                                            PASMP_error_descriptor_t *) {
+  if (!col || !count_inout || (*count_inout && !out))
+    return PASMP_INVALID_ARGUMENT;
+  auto first = std::min<uint64_t>(offset, col->actions.size());
+  auto count = std::min<uint64_t>(*count_inout, col->actions.size() - first);
+  std::copy_n(col->actions.begin() + first, count, out);
+  *count_inout = count;
+  return PASMP_SUCCESS;
+}
+
 PASMP_status_t PASMP_plugin_actions(PASMP_plugin_t plugin,
                                     PASMP_action_collection_t col,
                                     PASMP_error_descriptor_t *err_out) {
@@ -158,6 +181,83 @@ PASMP_status_t PASMP_plugin_actions(PASMP_plugin_t plugin,
   return PASMP_SUCCESS;
 }
 
+PASMP_status_t PASMP_plugin_serialize(PASMP_plugin_t plugin, char *into,
+                                      uint64_t *size_inout,
+                                      PASMP_error_descriptor_t *err_out) {
+  if (!plugin || !size_inout)
+    return PASMP_INVALID_ARGUMENT;
+  try {
+    const auto &p = *reinterpret_cast<plugin::my_plugin *>(plugin);
+    auto state = p.serialize();
+    auto available = std::exchange(*size_inout, state.size());
+    if (!into)
+      return PASMP_SUCCESS;
+    if (available < state.size()) {
+      fill_error_descriptor(err_out, "Plugin state does not fit the buffer");
+      return PASMP_ERROR_TRUNCATED;
+    }
+    std::copy(state.begin(), state.end(), into);
+  } catch (const std::bad_alloc &) {
+    return alloc_error(err_out, "Error allocating space for plugin state");
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_plugin_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
+PASMP_status_t PASMP_plugin_deserialize(PASMP_plugin_t plugin,
+                                        const char *from, uint64_t size,
+                                        PASMP_error_descriptor_t *err_out) {
+  if (!plugin || (size && !from))
+    return PASMP_INVALID_ARGUMENT;
+  try {
+    auto &p = *reinterpret_cast<plugin::my_plugin *>(plugin);
+    p.deserialize({from, size});
+  } catch (const plugin::malformed_state &) {
+    return serialization_error(
+        err_out, std::make_error_code(std::errc::illegal_byte_sequence));
+  } catch (const std::bad_alloc &) {
+    return alloc_error(err_out, "Error allocating space for plugin state");
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_plugin_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
+PASMP_status_t PASMP_plugin_extract(PASMP_plugin_t plugin, PASMP_action_t a,
+                                    char *into, uint64_t *size_inout,
+                                    PASMP_error_descriptor_t *err_out) {
+  if (!plugin || !a || !size_inout)
+    return PASMP_INVALID_ARGUMENT;
+  try {
+    auto &p = *reinterpret_cast<plugin::my_plugin *>(plugin);
+    auto id = std::bit_cast<plugin::action_id>(a);
+    auto state = p.serialize(id);
+    auto available = std::exchange(*size_inout, state.size());
+    if (!into)
+      return PASMP_SUCCESS;
+    if (available < state.size()) {
+      fill_error_descriptor(err_out, "Action state does not fit the buffer");
+      return PASMP_ERROR_TRUNCATED;
+    }
+    p.remove(id);
+    std::copy(state.begin(), state.end(), into);
+  } catch (const plugin::action_does_not_exist &) {
+    return PASMP_ERROR_ACTION_NOENT;
+  } catch (const std::bad_alloc &) {
+    return alloc_error(err_out, "Error allocating space for action state");
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_action_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
 #pragma endregion
 
 #pragma region plugin_operations_impl
@@ -235,6 +335,7 @@ PASMP_status_t PASMP_plugin_configure_cli(PASMP_plugin_t handle,
               status = PASMP_UNKNOWN;
             }
             cb(status, {}, data);
+            return;
           }
           switch (s) {
           case plugin::configuration_status::finish:
@@ -516,6 +617,53 @@ PASMP_status_t PASMP_action_execute(PASMP_plugin_t p, PASMP_action_t a,
     plug.execute(id, payload.data->int32_value);
   } catch (const plugin::action_does_not_exist &) {
     return PASMP_ERROR_ACTION_NOENT;
+  } catch (const plugin::admission_rejected &e) {
+    fill_error_descriptor(err_out, e.what());
+    return PASMP_UNAVAILABLE;
+  } catch (const plugin::action_error &e) {
+    fill_error_descriptor(err_out, e.what());
+    return PASMP_ERROR_ACTION_EXEC;
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_action_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
+PASMP_status_t PASMP_action_payload_type(PASMP_plugin_t p, PASMP_action_t a,
+                                         PASMP_payload_tag_t *out,
+                                         PASMP_error_descriptor_t *err_out) {
+  if (!p || !a || !out)
+    return PASMP_INVALID_ARGUMENT;
+  try {
+    const auto &plug = *reinterpret_cast<plugin::my_plugin *>(p);
+    // every action of this plugin takes a 32-bit signed integer
+    plug.retrieve(std::bit_cast<plugin::action_id>(a));
+    *out = PASMP_PAYLOAD_INT32;
+  } catch (const plugin::action_does_not_exist &) {
+    return PASMP_ERROR_ACTION_NOENT;
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_action_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
+PASMP_status_t PASMP_action_execute_int32(PASMP_plugin_t p, PASMP_action_t a,
+                                          int32_t value,
+                                          PASMP_error_descriptor_t *err_out) {
+  if (!p || !a)
+    return PASMP_INVALID_ARGUMENT;
+  try {
+    auto &plug = *reinterpret_cast<plugin::my_plugin *>(p);
+    plug.execute(std::bit_cast<plugin::action_id>(a), value);
+  } catch (const plugin::action_does_not_exist &) {
+    return PASMP_ERROR_ACTION_NOENT;
+  } catch (const plugin::admission_rejected &e) {
+    fill_error_descriptor(err_out, e.what());
+    return PASMP_UNAVAILABLE;
   } catch (const plugin::action_error &e) {
     fill_error_descriptor(err_out, e.what());
     return PASMP_ERROR_ACTION_EXEC;
@@ -527,6 +675,68 @@ PASMP_status_t PASMP_action_execute(PASMP_plugin_t p, PASMP_action_t a,
   return PASMP_SUCCESS;
 }
 
+namespace {
+
+PASMP_status_t PASMP_CALLBACK
+execute_prepared_int32(PASMP_prepared_action_t ctx,
+                       const PASMP_payload_data_t *data,
+                       PASMP_error_descriptor_t *err_out) {
+  if (!ctx || !data)
+    return PASMP_INVALID_ARGUMENT;
+  try {
+    reinterpret_cast<const plugin::my_plugin::prepared *>(ctx)->execute(
+        data->int32_value);
+  } catch (const plugin::action_stale &) {
+    return PASMP_ERROR_ACTION_STALE;
+  } catch (const plugin::admission_rejected &e) {
+    fill_error_descriptor(err_out, e.what());
+    return PASMP_UNAVAILABLE;
+  } catch (const plugin::action_error &e) {
+    fill_error_descriptor(err_out, e.what());
+    return PASMP_ERROR_ACTION_EXEC;
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_action_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
+} // namespace
+
+PASMP_status_t PASMP_action_prepare(PASMP_plugin_t p, PASMP_action_t a,
+                                    PASMP_payload_tag_t tag,
+                                    PASMP_prepared_action_t *ctx_out,
+                                    PASMP_prepared_execute_t **fn_out,
+                                    PASMP_error_descriptor_t *err_out) {
+  if (!p || !a || !ctx_out || !fn_out)
+    return PASMP_INVALID_ARGUMENT;
+  if (tag != PASMP_PAYLOAD_INT32) {
+    fill_error_descriptor(err_out, "Payload must be a 32-bit signed integer");
+    return PASMP_ERROR_PAYLOAD_INVALID;
+  }
+  try {
+    auto &plug = *reinterpret_cast<plugin::my_plugin *>(p);
+    auto prepared = plug.prepare(std::bit_cast<plugin::action_id>(a));
+    *ctx_out = reinterpret_cast<PASMP_prepared_action_t>(prepared.release());
+    *fn_out = &execute_prepared_int32;
+  } catch (const plugin::action_does_not_exist &) {
+    return PASMP_ERROR_ACTION_NOENT;
+  } catch (const std::bad_alloc &) {
+    return alloc_error(err_out, "Error allocating space for prepared action");
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_action_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
+PASMP_status_t PASMP_prepared_action_destroy(PASMP_prepared_action_t ctx) {
+  delete reinterpret_cast<plugin::my_plugin::prepared *>(ctx);
+  return PASMP_SUCCESS;
+}
+
 PASMP_status_t PASMP_action_execute_async(PASMP_plugin_t p, PASMP_action_t a,
                                           PASMP_payload_t payload,
                                           PASMP_on_action_finish_t *cb,
@@ -545,7 +755,11 @@ PASMP_status_t PASMP_action_execute_async(PASMP_plugin_t p, PASMP_action_t a,
     auto id = std::bit_cast<plugin::action_id>(a);
     plug.execute(id, payload.data->int32_value);
   } catch (const plugin::action_does_not_exist &) {
-    status = PASMP_ERROR_ACTION_NOENT;
+    // failed before submission, the callback is not invoked
+    return PASMP_ERROR_ACTION_NOENT;
+  } catch (const plugin::admission_rejected &e) {
+    fill_error_descriptor(err_out, e.what());
+    return PASMP_UNAVAILABLE;
   } catch (const plugin::action_error &e) {
     fill_error_descriptor(err_out, e.what());
     status = PASMP_ERROR_ACTION_EXEC;
@@ -555,7 +769,54 @@ PASMP_status_t PASMP_action_execute_async(PASMP_plugin_t p, PASMP_action_t a,
     status = unknown_error(err_out);
   }
   cb(status, {.data = err_out->what, .size = size - err_out->size}, data);
-  return status;
+  return PASMP_SUCCESS;
+}
+
+PASMP_status_t PASMP_action_execute_async_owned(
+    PASMP_plugin_t p, PASMP_action_t a, PASMP_payload_t payload,
+    PASMP_payload_release_t *release, void *release_data,
+    PASMP_on_action_finish_t *cb, void *data,
+    PASMP_error_descriptor_t *err_out) {
+  if (!release)
+    return PASMP_INVALID_ARGUMENT;
+  // execution is synchronous, so the payload is released before returning
+  struct release_guard {
+    PASMP_payload_release_t *release;
+    void *data;
+    ~release_guard() { release(data); }
+  } guard{release, release_data};
+  if (!p || !a)
+    return PASMP_INVALID_ARGUMENT;
+  if (payload.tag != PASMP_PAYLOAD_INT32) {
+    fill_error_descriptor(err_out, "Payload must be a 32-bit signed integer");
+    return PASMP_ERROR_PAYLOAD_INVALID;
+  }
+  auto size = err_out ? err_out->size : 0;
+  auto status = PASMP_SUCCESS;
+  try {
+    auto &plug = *reinterpret_cast<plugin::my_plugin *>(p);
+    auto id = std::bit_cast<plugin::action_id>(a);
+    plug.execute(id, payload.data->int32_value);
+  } catch (const plugin::action_does_not_exist &) {
+    return PASMP_ERROR_ACTION_NOENT;
+  } catch (const plugin::admission_rejected &e) {
+    fill_error_descriptor(err_out, e.what());
+    return PASMP_UNAVAILABLE;
+  } catch (const plugin::action_error &e) {
+    fill_error_descriptor(err_out, e.what());
+    status = PASMP_ERROR_ACTION_EXEC;
+  } catch (const std::exception &e) {
+    status = generic_error<PASMP_action_t>(err_out, e);
+  } catch (...) {
+    status = unknown_error(err_out);
+  }
+  if (cb) {
+    PASMP_string_view_t msg{};
+    if (err_out)
+      msg = {.data = err_out->what, .size = size - err_out->size};
+    cb(status, msg, data);
+  }
+  return PASMP_SUCCESS;
 }
 
 uint64_t PASMP_action_hash(PASMP_action_t a) {
@@ -571,6 +832,61 @@ int32_t PASMP_action_equal(PASMP_action_t lhs, PASMP_action_t rhs) {
 
 #pragma endregion
 
+#pragma region admission_operations_impl
+
+PASMP_status_t PASMP_plugin_limit(PASMP_plugin_t p, PASMP_rate_limit_t limit,
+                                  PASMP_error_descriptor_t *err_out) {
+  if (!p)
+    return PASMP_INVALID_ARGUMENT;
+  if (!is_valid(limit))
+    return invalid_argument(err_out, "Token rate requires a non-zero burst");
+  reinterpret_cast<plugin::my_plugin *>(p)->limit(to_rate_limit(limit));
+  return PASMP_SUCCESS;
+}
+
+PASMP_status_t PASMP_action_limit(PASMP_plugin_t p, PASMP_action_t a,
+                                  PASMP_rate_limit_t limit,
+                                  PASMP_error_descriptor_t *err_out) {
+  if (!p || !a)
+    return PASMP_INVALID_ARGUMENT;
+  if (!is_valid(limit))
+    return invalid_argument(err_out, "Token rate requires a non-zero burst");
+  try {
+    auto &plug = *reinterpret_cast<plugin::my_plugin *>(p);
+    plug.limit(std::bit_cast<plugin::action_id>(a), to_rate_limit(limit));
+  } catch (const plugin::action_does_not_exist &) {
+    return PASMP_ERROR_ACTION_NOENT;
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_action_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
+PASMP_status_t PASMP_action_admission_stats(PASMP_plugin_t p, PASMP_action_t a,
+                                            PASMP_admission_stats_t *out,
+                                            PASMP_error_descriptor_t *err_out) {
+  if (!p || !a || !out)
+    return PASMP_INVALID_ARGUMENT;
+  try {
+    const auto &plug = *reinterpret_cast<plugin::my_plugin *>(p);
+    auto stats = plug.admission(std::bit_cast<plugin::action_id>(a));
+    *out = {.admitted = stats.admitted,
+            .rejected = stats.rejected,
+            .in_flight = stats.in_flight};
+  } catch (const plugin::action_does_not_exist &) {
+    return PASMP_ERROR_ACTION_NOENT;
+  } catch (const std::exception &e) {
+    return generic_error<PASMP_action_t>(err_out, e);
+  } catch (...) {
+    return unknown_error(err_out);
+  }
+  return PASMP_SUCCESS;
+}
+
+#pragma endregion
+
 #pragma region version_impl
 
 PASMP_status_t PASMP_version_create(PASMP_version_t *out,
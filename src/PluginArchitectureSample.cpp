@@ -1,5 +1,6 @@
 #include <fmt/format.h>
 #include <midi/midi.hpp>
+#include <module_load/call_tracer.hpp>
 #include <module_load/exception.hpp>
 #include <module_load/module.hpp>
 #include <spdlog/spdlog.h>
@@ -8,6 +9,7 @@
 #include "blocking_queue.hpp"
 #include "misc.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <random>
@@ -23,6 +25,9 @@ struct message_t {
 
 using queue_t = q::blocking_queue<message_t, 256>;
 
+// discovery may list other plugins next to it
+constexpr std::string_view plugin_name = "my_test_plugin";
+
 void on_action_event(queue_t &queue, wrap::action_event e, wrap::action &&h) {
   queue.emplace(e, std::move(h));
 }
@@ -93,13 +98,37 @@ int main() {
     std::uniform_int_distribution<int32_t> dist{-100, 100};
 
     const auto &path = frontend::persistence_path_prefix();
-    auto plugin_path = std::filesystem::path("plugin") / "MyPlugin2.dll";
+    std::filesystem::create_directories(path / "PluginArchitectureSample");
+    wrap::discovery_options dopts;
+    dopts.manifest = path / "PluginArchitectureSample" / "plugins.manifest";
+    auto discovered = wrap::discover_plugins("plugin", dopts);
+    for (const auto &f : discovered.failures)
+      spdlog::warn("Skipping {}: {}", f.path.string(), f.message);
+    for (const auto &p : discovered.plugins)
+      spdlog::info("Found {} {}.{}.{} in {}{}", p.name, p.major, p.minor,
+                   p.patch, p.path.string(), p.cached ? " (cached)" : "");
+    auto found = std::find_if(
+        discovered.plugins.begin(), discovered.plugins.end(),
+        [](const auto &p) { return p.name == frontend::plugin_name; });
+    if (found == discovered.plugins.end())
+      throw std::runtime_error(
+          fmt::format("Plugin {} not found", frontend::plugin_name));
+    auto plugin_path = found->path;
     auto persistence_path = path / "PluginArchitectureSample" /
                             plugin_path.parent_path() / plugin_path.stem();
 
     std::filesystem::create_directories(persistence_path);
 
+    modl::call_tracer::enable(spdlog::should_log(spdlog::level::debug));
     modl::loaded_module mod{plugin_path};
+    {
+      auto stats = mod.stats();
+      spdlog::debug("{} loaded: open {}us, version check {}us, {} functions "
+                    "resolved in {}us",
+                    mod.filename(), stats.open.count() / 1000,
+                    stats.version_check.count() / 1000, stats.resolved,
+                    stats.resolve.count() / 1000);
+    }
 
     wrap::set_default_error_handler(
         [](const char *msg, std::error_code ec) noexcept {
@@ -193,6 +222,12 @@ int main() {
         }
       }
     }
+
+    for (const auto &s : modl::call_tracer::report())
+      spdlog::debug("{}: {} calls, {}us total, p50 {}ns, p90 {}ns, p99 {}ns, "
+                    "max {}ns",
+                    s.name, s.calls, s.total.count() / 1000, s.p50.count(),
+                    s.p90.count(), s.p99.count(), s.max.count());
   } catch (const modl::function_load_error &e) {
     std::cerr << e.code().message() << ": " << e.name() << "\n";
     return 1;
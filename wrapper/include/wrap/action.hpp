@@ -13,6 +13,7 @@
 namespace wrap {
 
 struct error_descriptor;
+class action_ref;
 
 class WRAPPER_DLL_PUBLIC action {
 public:
@@ -22,6 +23,8 @@ public:
 
   action(const plugin &, PASMP_action_t, key<plugin>) noexcept;
   action(const plugin &, std::string_view, error_descriptor &);
+  // copies the borrowed handle
+  explicit action(const action_ref &);
 
   action(const action &);
   action(action &&) noexcept;
@@ -46,7 +49,28 @@ private:
   PASMP_action_t value_;
 };
 
+// Borrowed action handle: neither the handle nor the plugin are copied, so
+// both must outlive the reference. to_owned() makes an independent action.
+class WRAPPER_DLL_PUBLIC action_ref {
+public:
+  action_ref(const plugin &p, PASMP_action_t handle) noexcept
+      : plugin_(&p), value_(handle) {}
+  explicit action_ref(const action &x) noexcept
+      : plugin_(&x.get_plugin()), value_(x.get()) {}
+
+  PASMP_action_t get() const noexcept { return value_; }
+  const plugin &get_plugin() const noexcept { return *plugin_; }
+
+  action to_owned() const { return action{*this}; }
+
+private:
+  const plugin *plugin_;
+  PASMP_action_t value_;
+};
+
 WRAPPER_DLL_PUBLIC bool operator==(const action &, const action &) noexcept;
+WRAPPER_DLL_PUBLIC bool operator==(const action_ref &,
+                                   const action_ref &) noexcept;
 
 WRAPPER_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const action &);
 
@@ -1,22 +1,89 @@
 #pragma once
 
 #include <wrap/action.hpp>
+#include <wrap/payload.hpp>
 
 #include <functional>
-#include <mutex>
+#include <memory>
+#include <optional>
 #include <system_error>
 
 namespace wrap {
 
-class payload;
 struct error_descriptor;
+class notification_queue;
+
+namespace detail {
+struct future_slot;
+} // namespace detail
+
+enum class overflow_policy : uint32_t {
+  block,
+  fail,
+};
+
+// bounds the number of submissions whose completion is still outstanding;
+// a zero limit leaves the window unbounded
+struct in_flight_window {
+  uint32_t limit = 0;
+  overflow_policy on_full = overflow_policy::block;
+};
+
+// Result of a single submission. The shared state lives in a slot owned by
+// the executor, so a future must not outlive the executor that returned it.
+class action_future {
+public:
+  using continuation_t = void (*)(void *, std::error_code, std::string_view);
+
+  action_future() noexcept = default;
+
+  action_future(action_future &&) noexcept;
+  action_future &operator=(action_future &&) noexcept;
+
+  ~action_future();
+
+  explicit operator bool() const noexcept { return slot_ != nullptr; }
+
+  bool ready() const noexcept;
+
+  std::error_code wait() const noexcept;
+  std::optional<std::error_code> try_get() const noexcept;
+
+  // error message reported with the result, valid once the future is ready
+  std::string_view message() const noexcept;
+
+  // at most one continuation per future; runs on the completing thread, or
+  // inline if the result is already available
+  void then(continuation_t, void *) noexcept;
+
+  template <typename F> void then(F &f) noexcept {
+    then(
+        [](void *ctx, std::error_code ec, std::string_view msg) {
+          (*static_cast<F *>(ctx))(ec, msg);
+        },
+        std::addressof(f));
+  }
+
+private:
+  friend class action_executor;
+
+  explicit action_future(detail::future_slot *) noexcept;
+
+  detail::future_slot *slot_ = nullptr;
+};
 
 class action_executor {
 public:
   using on_finish_t = std::function<void(std::error_code, std::string_view)>;
   using on_error_t = std::function<void(std::exception_ptr)>;
 
-  action_executor(const action &, on_finish_t, on_error_t = {});
+  explicit action_executor(const action &, in_flight_window = {});
+  action_executor(const action &, on_finish_t, on_error_t = {},
+                  in_flight_window = {});
+  // on_finish runs from the queue's drain(), which may come after the
+  // executor is gone; futures still complete on the plugin's threads
+  action_executor(const action &, on_finish_t, notification_queue &,
+                  on_error_t = {}, in_flight_window = {});
 
   action_executor(const action_executor &) = delete;
   action_executor &operator=(const action_executor &) = delete;
@@ -25,21 +92,36 @@ public:
 
   const action &get_action() const noexcept { return action_; }
 
-  void submit(const payload &, error_descriptor &);
-  bool submit(const payload &, std::error_code &, error_descriptor &) noexcept;
+  // when the window is full, either blocks until a submission completes or
+  // fails with plugin_errc::unavailable, depending on the window's policy
+  action_future submit(payload_view, error_descriptor &);
+  action_future submit(payload_view, std::error_code &,
+                       error_descriptor &) noexcept;
 
   void await();
 
 private:
   struct helper;
+  struct slot_pool;
   friend helper;
+  friend action_future;
+
+  bool enter_window() noexcept;
+  static void leave_window(slot_pool &) noexcept;
 
   action action_;
   on_finish_t on_finish_;
   on_error_t on_error_;
-
-  std::condition_variable submitcv_;
-  std::atomic<int32_t> submitctr_;
+  notification_queue *queue_ = nullptr;
+  in_flight_window window_;
+  // released to the last completion rather than destroyed, see slot_pool
+  std::unique_ptr<slot_pool> pool_;
 };
 
+// Fire-and-forget submission: ownership of the payload passes to the plugin,
+// which releases it once the execution no longer needs it.
+WRAPPER_DLL_PUBLIC void post(const action &, payload, error_descriptor &);
+WRAPPER_DLL_PUBLIC bool post(const action &, payload, std::error_code &,
+                             error_descriptor &) noexcept;
+
 } // namespace wrap
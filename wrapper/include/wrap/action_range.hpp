@@ -0,0 +1,78 @@
+#pragma once
+
+#include <wrap/action.hpp>
+#include <wrap/passkey.hpp>
+#include <wrap/visibility.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+
+namespace wrap {
+
+class plugin;
+struct error_descriptor;
+
+// Lazily reads a plugin's actions from its collection, chunk_size handles at a
+// time, instead of copying every handle up front. The yielded references
+// borrow the handles owned by the range and remain valid while it is alive;
+// use action_ref::to_owned() to keep one beyond that.
+class WRAPPER_DLL_PUBLIC action_range {
+  struct impl;
+
+public:
+  static constexpr size_t chunk_size = 64;
+
+  class WRAPPER_DLL_PUBLIC iterator {
+  public:
+    using iterator_concept = std::input_iterator_tag;
+    using value_type = action_ref;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() noexcept = default;
+
+    // reading a chunk may fail, in which case the error is thrown; a chunk
+    // shorter than the size reported throws std::out_of_range
+    action_ref operator*() const;
+
+    iterator &operator++() noexcept {
+      index_++;
+      return *this;
+    }
+    void operator++(int) noexcept { ++*this; }
+
+    friend bool operator==(const iterator &it,
+                           std::default_sentinel_t) noexcept {
+      return it.done();
+    }
+
+  private:
+    friend action_range;
+
+    explicit iterator(impl *x) noexcept : impl_(x) {}
+
+    bool done() const noexcept;
+
+    impl *impl_ = nullptr;
+    size_t index_ = 0;
+  };
+
+  action_range() noexcept;
+  action_range(const plugin &, error_descriptor &, key<plugin>);
+
+  action_range(action_range &&) noexcept;
+  action_range &operator=(action_range &&) noexcept;
+
+  ~action_range();
+
+  iterator begin() noexcept { return iterator{impl_.get()}; }
+  std::default_sentinel_t end() const noexcept { return {}; }
+
+  size_t size() const noexcept;
+  bool empty() const noexcept { return !size(); }
+
+private:
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace wrap
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <wrap/visibility.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+namespace wrap {
+
+class action;
+class payload;
+class plugin;
+
+enum class priority_class : uint32_t {
+  realtime,
+  high,
+  normal,
+  bulk,
+};
+
+constexpr size_t priority_class_count = 4;
+
+struct submit_options {
+  using clock = std::chrono::steady_clock;
+
+  priority_class priority = priority_class::normal;
+  // any steady_clock time point converts, including midi::message_data
+  // timestamps, which are anchored to the moment the input device started
+  std::optional<clock::time_point> deadline;
+};
+
+struct scheduler_stats {
+  uint64_t submitted;
+  uint64_t executed;
+  uint64_t deadline_misses;
+};
+
+// Runs submissions on a pool of worker threads. The highest non-empty priority
+// class is always served first; within a class, plugins share the workers'
+// time in proportion to their weight and each plugin's queue is ordered
+// earliest-deadline-first (submissions without a deadline go last, in FIFO
+// order).
+class WRAPPER_DLL_PUBLIC action_scheduler {
+public:
+  using clock = submit_options::clock;
+  using on_finish_t = std::function<void(std::error_code, std::string_view)>;
+  using on_error_t = std::function<void(std::exception_ptr)>;
+
+  static constexpr uint32_t default_weight = 1;
+
+  explicit action_scheduler(size_t workers = 1, on_error_t = {});
+
+  action_scheduler(const action_scheduler &) = delete;
+  action_scheduler &operator=(const action_scheduler &) = delete;
+
+  ~action_scheduler();
+
+  void weight(const plugin &, uint32_t);
+  bool weight(const plugin &, uint32_t, std::error_code &) noexcept;
+  uint32_t weight(const plugin &) const noexcept;
+
+  // drops the plugin's weight and, once they drain, its queues; meant for
+  // plugins that are done with, since another may take over their handle
+  void forget(const plugin &) noexcept;
+
+  void submit(const action &, payload, submit_options, on_finish_t = {});
+  bool submit(const action &, payload, submit_options, on_finish_t,
+              std::error_code &) noexcept;
+
+  // runs a function in the plugin's queue, as if it were one of its actions;
+  // exceptions go to the error handler
+  void post(const plugin &, std::function<void()>, submit_options = {});
+  bool post(const plugin &, std::function<void()>, submit_options,
+            std::error_code &) noexcept;
+
+  scheduler_stats stats(priority_class) const noexcept;
+
+  void await();
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace wrap
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <wrap/action_scheduler.hpp>
+#include <wrap/visibility.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <system_error>
+
+namespace wrap {
+
+class action;
+class payload;
+
+using timer_id = uint64_t;
+
+// Fires executions at requested points in time from a single timer thread.
+// Pending timers are kept in a hierarchical timer wheel with a resolution of
+// one millisecond, so that scheduling and cancellation are constant time. All
+// timers that expire within the same tick are fired as one batch, either
+// directly on the timer thread or by handing them to an action_scheduler with
+// the expiry time as their deadline.
+class WRAPPER_DLL_PUBLIC action_timer {
+public:
+  using clock = std::chrono::steady_clock;
+  using resolution = std::chrono::milliseconds;
+  using on_finish_t = std::function<void(std::error_code, std::string_view)>;
+  using on_error_t = std::function<void(std::exception_ptr)>;
+
+  explicit action_timer(on_error_t = {});
+  action_timer(action_scheduler &, priority_class, on_error_t = {});
+
+  action_timer(const action_timer &) = delete;
+  action_timer &operator=(const action_timer &) = delete;
+
+  ~action_timer();
+
+  timer_id schedule_at(const action &, payload, clock::time_point,
+                       on_finish_t = {});
+  timer_id schedule_at(const action &, payload, clock::time_point, on_finish_t,
+                       std::error_code &) noexcept;
+
+  timer_id schedule_every(const action &, payload, clock::duration,
+                          on_finish_t = {});
+  timer_id schedule_every(const action &, payload, clock::duration,
+                          on_finish_t, std::error_code &) noexcept;
+
+  timer_id schedule_every(const action &, payload, clock::time_point,
+                          clock::duration, on_finish_t = {});
+  timer_id schedule_every(const action &, payload, clock::time_point,
+                          clock::duration, on_finish_t,
+                          std::error_code &) noexcept;
+
+  bool cancel(timer_id) noexcept;
+
+  size_t pending() const noexcept;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace wrap
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <wrap/plugin.hpp>
+#include <wrap/visibility.hpp>
+
+#include <cstdint>
+#include <system_error>
+
+namespace wrap {
+
+class action;
+struct error_descriptor;
+
+struct rate_limit {
+  // tokens per second, zero disables the token bucket
+  double rate = 0;
+  uint64_t burst = 0;
+  // zero disables the in-flight limit
+  uint64_t max_in_flight = 0;
+};
+
+struct admission_stats {
+  uint64_t admitted = 0;
+  uint64_t rejected = 0;
+  uint64_t in_flight = 0;
+};
+
+// Configures the admission limits a plugin enforces before executing an
+// action. Executions over a limit fail immediately with plugin_errc::unavailable.
+class WRAPPER_DLL_PUBLIC admission_control {
+public:
+  explicit admission_control(const plugin &);
+
+  const plugin &get_plugin() const noexcept;
+
+  void limit(rate_limit, error_descriptor &);
+  bool limit(rate_limit, std::error_code &, error_descriptor &) noexcept;
+
+  void limit(const action &, rate_limit, error_descriptor &);
+  bool limit(const action &, rate_limit, std::error_code &,
+             error_descriptor &) noexcept;
+
+  admission_stats stats(const action &, error_descriptor &) const;
+  admission_stats stats(const action &, std::error_code &,
+                        error_descriptor &) const noexcept;
+
+private:
+  plugin plugin_;
+};
+
+} // namespace wrap
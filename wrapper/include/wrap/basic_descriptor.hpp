@@ -1,23 +1,29 @@
 #pragma once
 
+#include <wrap/rcstring.hpp>
 #include <wrap/visibility.hpp>
 
-#include <string>
+#include <string_view>
 
 namespace wrap {
 
+// All strings are interned, so descriptors loaded from the same plugin data
+// share storage and compare by pointer.
 class WRAPPER_DLL_PUBLIC basic_descriptor {
 public:
-  const std::string &name() const noexcept { return name_; };
-  const std::string &descr() const noexcept { return descr_; };
-  const std::string &short_name() const noexcept { return shortname_; };
-  const std::string &short_descr() const noexcept { return shortdescr_; };
+  std::string_view name() const noexcept { return name_; };
+  std::string_view descr() const noexcept { return descr_; };
+  std::string_view short_name() const noexcept { return shortname_; };
+  std::string_view short_descr() const noexcept { return shortdescr_; };
+
+  friend bool operator==(const basic_descriptor &,
+                         const basic_descriptor &) noexcept = default;
 
 protected:
   basic_descriptor() = default;
 
-  basic_descriptor(std::string &&name, std::string &&sname, std::string &&descr,
-                   std::string &&sdescr)
+  basic_descriptor(rc_immutable_string &&name, rc_immutable_string &&sname,
+                   rc_immutable_string &&descr, rc_immutable_string &&sdescr)
       : name_(std::move(name)), shortname_(std::move(sname)),
         descr_(std::move(descr)), shortdescr_(std::move(sdescr)) {}
 
@@ -29,10 +35,10 @@ protected:
 
   ~basic_descriptor() = default;
 
-  std::string name_;
-  std::string shortname_;
-  std::string descr_;
-  std::string shortdescr_;
+  rc_immutable_string name_;
+  rc_immutable_string shortname_;
+  rc_immutable_string descr_;
+  rc_immutable_string shortdescr_;
 };
 
 } // namespace wrap
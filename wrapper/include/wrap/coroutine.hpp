@@ -0,0 +1,249 @@
+#pragma once
+
+#include <wrap/payload.hpp>
+#include <wrap/plugin.hpp>
+#include <wrap/plugin_configurator.hpp>
+#include <wrap/visibility.hpp>
+
+#include <plugin/plugin_interface.h>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <system_error>
+#include <utility>
+
+namespace wrap {
+
+class action;
+struct error_descriptor;
+
+// Resumes coroutines whose awaited operation completed on a plugin thread.
+class scheduler {
+public:
+  virtual void post(std::coroutine_handle<>) noexcept = 0;
+
+protected:
+  ~scheduler() = default;
+};
+
+class inline_scheduler final : public scheduler {
+public:
+  void post(std::coroutine_handle<> h) noexcept override { h.resume(); }
+};
+
+template <typename T = void> class task;
+
+namespace detail {
+
+WRAPPER_DLL_PUBLIC void *allocate_frame(size_t);
+WRAPPER_DLL_PUBLIC void deallocate_frame(void *, size_t) noexcept;
+WRAPPER_DLL_PUBLIC void unhandled_task_exception() noexcept;
+
+struct task_promise_base {
+  std::coroutine_handle<> continuation;
+  std::exception_ptr eptr;
+  bool detached = false;
+
+  // frames are recycled through per-thread size-class free lists
+  static void *operator new(size_t n) { return allocate_frame(n); }
+  static void operator delete(void *p, size_t n) noexcept {
+    deallocate_frame(p, n);
+  }
+
+  struct final_awaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template <typename P>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<P> h) noexcept {
+      auto &p = h.promise();
+      if (p.detached) {
+        if (p.eptr)
+          unhandled_task_exception();
+        h.destroy();
+        return std::noop_coroutine();
+      }
+      if (p.continuation)
+        return p.continuation;
+      return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  final_awaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept { eptr = std::current_exception(); }
+};
+
+template <typename T> struct task_promise : task_promise_base {
+  std::optional<T> value;
+
+  task<T> get_return_object() noexcept;
+
+  template <typename U> void return_value(U &&x) {
+    value.emplace(std::forward<U>(x));
+  }
+
+  T result() {
+    if (eptr)
+      std::rethrow_exception(eptr);
+    return std::move(*value);
+  }
+};
+
+template <> struct task_promise<void> : task_promise_base {
+  task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {}
+
+  void result() const {
+    if (eptr)
+      std::rethrow_exception(eptr);
+  }
+};
+
+// Settles the race between a plugin callback completing an operation and the
+// awaiting coroutine suspending on it. If the callback wins, the coroutine
+// does not suspend at all and continues on its current thread.
+class completion {
+public:
+  explicit completion(scheduler &s) noexcept : sched_(s) {}
+
+  bool suspend(std::coroutine_handle<> h) noexcept {
+    handle_ = h;
+    return state_.exchange(suspended, std::memory_order_acq_rel) != completed;
+  }
+
+  void complete() noexcept {
+    if (state_.exchange(completed, std::memory_order_acq_rel) == suspended)
+      sched_.post(handle_);
+  }
+
+private:
+  enum : uint8_t { idle, suspended, completed };
+
+  scheduler &sched_;
+  std::coroutine_handle<> handle_;
+  std::atomic<uint8_t> state_ = idle;
+};
+
+} // namespace detail
+
+// Lazily started coroutine. Awaiting a task starts it and resumes the awaiter
+// once it finishes; a task nobody awaits is started with detach().
+template <typename T> class [[nodiscard]] task {
+public:
+  using promise_type = detail::task_promise<T>;
+
+  task(task &&x) noexcept : handle_(std::exchange(x.handle_, {})) {}
+
+  task &operator=(task &&x) noexcept {
+    if (this != &x) {
+      if (handle_)
+        handle_.destroy();
+      handle_ = std::exchange(x.handle_, {});
+    }
+    return *this;
+  }
+
+  ~task() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<>
+  await_suspend(std::coroutine_handle<> awaiter) noexcept {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+
+  T await_resume() { return handle_.promise().result(); }
+
+  // the frame destroys itself on completion; an escaping exception is
+  // reported like one thrown from a plugin callback
+  void detach() && {
+    auto h = std::exchange(handle_, {});
+    h.promise().detached = true;
+    h.resume();
+  }
+
+  void detach(scheduler &s) && {
+    auto h = std::exchange(handle_, {});
+    h.promise().detached = true;
+    s.post(h);
+  }
+
+private:
+  friend promise_type;
+
+  explicit task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+task<T> detail::task_promise<T>::get_return_object() noexcept {
+  return task<T>{std::coroutine_handle<task_promise>::from_promise(*this)};
+}
+
+inline task<void> detail::task_promise<void>::get_return_object() noexcept {
+  return task<void>{std::coroutine_handle<task_promise>::from_promise(*this)};
+}
+
+class WRAPPER_DLL_PUBLIC execute_awaitable {
+public:
+  execute_awaitable(const action &, payload_view, error_descriptor &,
+                    scheduler &) noexcept;
+
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<>) noexcept;
+  std::error_code await_resume() const noexcept { return ec_; }
+
+private:
+  static void PASMP_CALLBACK on_finish(PASMP_status_t, PASMP_string_view_t,
+                                       void *);
+
+  const action &action_;
+  payload_view payload_;
+  error_descriptor &ed_;
+  detail::completion done_;
+  std::error_code ec_;
+};
+
+class WRAPPER_DLL_PUBLIC configure_awaitable {
+public:
+  configure_awaitable(const plugin &, configure_mode, error_descriptor &,
+                      scheduler &) noexcept;
+
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<>) noexcept;
+  configure_result await_resume() const noexcept { return result_; }
+
+private:
+  static void PASMP_CALLBACK on_finish(PASMP_status_t, PASMP_config_status_t,
+                                       void *);
+
+  const plugin &plugin_;
+  configure_mode mode_;
+  error_descriptor &ed_;
+  detail::completion done_;
+  configure_result result_;
+};
+
+// co_await execute(a, p, ed, s) yields the error code of the execution, with
+// the plugin's message in ed; s resumes the coroutine if it had to suspend
+WRAPPER_DLL_PUBLIC execute_awaitable execute(const action &, payload_view,
+                                             error_descriptor &,
+                                             scheduler &) noexcept;
+
+WRAPPER_DLL_PUBLIC configure_awaitable configure(const plugin &,
+                                                 configure_mode,
+                                                 error_descriptor &,
+                                                 scheduler &) noexcept;
+
+} // namespace wrap
@@ -57,6 +57,7 @@ enum class action_errc : int32_t {
   serialization,
   invalid_payload,
   other,
+  stale,
 };
 
 [[noreturn]] WRAPPER_DLL_PUBLIC void
@@ -4,6 +4,7 @@
 
 #include <plugin/plugin_interface.h>
 
+#include <string>
 #include <string_view>
 
 namespace wrap {
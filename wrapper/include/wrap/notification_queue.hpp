@@ -0,0 +1,47 @@
+#pragma once
+
+#include <wrap/visibility.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace wrap {
+
+// Hands what plugins report on their own threads over to a host's event
+// loop. Notifications are queued without locking and the native handle is
+// signaled when the queue turns non-empty: an eventfd on Linux, the read end
+// of a pipe elsewhere, an auto-reset event on Windows. drain() then runs
+// them on the calling thread; see plugin_attributes::notify() and
+// action_executor.
+class WRAPPER_DLL_PUBLIC notification_queue {
+public:
+#if defined(_WIN32)
+  using native_handle_type = void *;
+#else
+  using native_handle_type = int;
+#endif
+
+  notification_queue();
+
+  notification_queue(const notification_queue &) = delete;
+  notification_queue &operator=(const notification_queue &) = delete;
+
+  // whatever is still queued is dropped without running
+  ~notification_queue();
+
+  native_handle_type native_handle() const noexcept;
+
+  // from any thread
+  void post(std::function<void()>);
+
+  // runs the notifications in the order they were posted and returns their
+  // count; one thread at a time
+  size_t drain();
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace wrap
@@ -4,9 +4,11 @@
 
 #include <plugin/plugin_interface.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <span>
 #include <string>
-#include <variant>
+#include <string_view>
 
 namespace wrap {
 
@@ -21,18 +23,47 @@ public:
   explicit payload(double x) noexcept;
   explicit payload(std::string x) noexcept;
 
+  payload(const payload &);
+  payload(payload &&) noexcept;
+
+  payload &operator=(const payload &);
+  payload &operator=(payload &&) noexcept;
+
+  operator PASMP_payload_t() const &noexcept;
+  operator PASMP_payload_t() && = delete;
+
+private:
+  friend class payload_view;
+
+  void rebind() noexcept;
+
+  // only string payloads own storage; scalars live in the union alone
+  std::string string_;
+  PASMP_payload_tag_t tag_;
+  PASMP_payload_data_t data_;
+};
+
+// Non-owning counterpart of payload. Strings and byte spans are referenced
+// in place, so whatever they point to must outlive every use of the view.
+class WRAPPER_DLL_PUBLIC payload_view {
+public:
+  payload_view() noexcept;
+  payload_view(const payload &) noexcept;
+  explicit payload_view(int32_t x) noexcept;
+  explicit payload_view(int64_t x) noexcept;
+  explicit payload_view(uint32_t x) noexcept;
+  explicit payload_view(uint64_t x) noexcept;
+  explicit payload_view(float x) noexcept;
+  explicit payload_view(double x) noexcept;
+  explicit payload_view(std::string_view x) noexcept;
+  explicit payload_view(std::span<const std::byte> x) noexcept;
+
   operator PASMP_payload_t() const &noexcept;
   operator PASMP_payload_t() && = delete;
 
 private:
-  using holder_type = std::variant<std::monostate, int32_t, int64_t, uint32_t,
-                                   uint64_t, float, double, std::string>;
-  using union_type = PASMP_payload_data_t;
-  using tag_type = PASMP_payload_tag_t;
-
-  holder_type holder_;
-  tag_type tag_;
-  union_type data_;
+  PASMP_payload_tag_t tag_;
+  PASMP_payload_data_t data_;
 };
 
 } // namespace wrap
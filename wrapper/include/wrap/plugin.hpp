@@ -1,5 +1,6 @@
 #pragma once
 
+#include <wrap/action_descriptor.hpp>
 #include <wrap/action_event.hpp>
 #include <wrap/visibility.hpp>
 
@@ -7,12 +8,15 @@
 #include <plugin/plugin_interface.h>
 
 #include <memory>
+#include <string>
+#include <string_view>
 #include <system_error>
 #include <vector>
 
 namespace wrap {
 
 class action;
+class action_range;
 class plugin_attributes;
 struct error_descriptor;
 
@@ -20,9 +24,39 @@ class WRAPPER_DLL_PUBLIC plugin {
 public:
   plugin(const modl::loaded_module &, plugin_attributes, error_descriptor &);
 
+  // copying a borrowed plugin, such as the one behind an event's action_ref,
+  // yields an owning one
+  plugin(const plugin &);
+  plugin(plugin &&) noexcept = default;
+
+  plugin &operator=(const plugin &);
+  plugin &operator=(plugin &&) noexcept = default;
+
   std::vector<action> actions(error_descriptor &) const;
   std::vector<action> actions(std::error_code &, error_descriptor &) const;
 
+  // reads the actions lazily instead, see action_range
+  action_range actions_view(error_descriptor &) const;
+  action_range actions_view(std::error_code &, error_descriptor &) const;
+
+  // served from the descriptor cache if the attributes enable it
+  action_descriptor descriptor(const action &, error_descriptor &) const;
+  action_descriptor descriptor(const action &, std::error_code &,
+                               error_descriptor &) const noexcept;
+
+  // moves the actions between instances of a module, see reloadable_plugin
+  std::string serialize(error_descriptor &) const;
+  std::string serialize(std::error_code &, error_descriptor &) const noexcept;
+
+  void deserialize(std::string_view, error_descriptor &) const;
+  bool deserialize(std::string_view, std::error_code &,
+                   error_descriptor &) const noexcept;
+
+  // removes an action, returning it in a form that deserialize() adds anew
+  std::string extract(const action &, error_descriptor &) const;
+  std::string extract(const action &, std::error_code &,
+                      error_descriptor &) const noexcept;
+
   PASMP_plugin_t get() const noexcept;
 
   const modl::loaded_module &get_module() const noexcept;
@@ -32,11 +66,17 @@ public:
 private:
   struct impl;
 
+  struct borrow_tag {};
+
   explicit plugin(const impl &);
+  plugin(const impl &, borrow_tag) noexcept;
+
+  static std::shared_ptr<const impl>
+  owning(const std::shared_ptr<const impl> &);
 
   std::shared_ptr<const impl> impl_;
 };
 
-WRAPPER_DLL_PUBLIC bool operator==(const plugin &, const plugin &);
+WRAPPER_DLL_PUBLIC bool operator==(const plugin &, const plugin &) noexcept;
 
 } // namespace wrap
@@ -11,27 +11,57 @@ namespace wrap {
 
 class plugin;
 class action;
+class action_ref;
+class notification_queue;
 
 class WRAPPER_DLL_PUBLIC plugin_attributes {
 public:
   using callback_t = std::function<void(action_event, action)>;
+  // the plugin and handle are only borrowed for the duration of the call,
+  // which spares copying both for every event; see action_ref::to_owned()
+  using ref_callback_t = std::function<void(action_event, action_ref)>;
   using on_error_t = std::function<void(std::exception_ptr)>;
 
   plugin_attributes(std::filesystem::path p, callback_t c,
                     on_error_t e = {}) noexcept
       : path_(std::move(p)), callback_(std::move(c)), on_error_(std::move(e)){};
+  plugin_attributes(std::filesystem::path p, ref_callback_t c,
+                    on_error_t e = {}) noexcept
+      : path_(std::move(p)), ref_callback_(std::move(c)),
+        on_error_(std::move(e)){};
 
   const callback_t &callback(key<plugin>) const noexcept { return callback_; };
+  const ref_callback_t &ref_callback(key<plugin>) const noexcept {
+    return ref_callback_;
+  };
   const on_error_t &on_error(key<plugin>) const noexcept { return on_error_; };
 
   const std::filesystem::path &persistence_path() const noexcept {
     return path_;
   };
 
+  // keep action descriptors on the host, invalidated by action events
+  plugin_attributes &cache_descriptors(bool x) noexcept {
+    cache_descriptors_ = x;
+    return *this;
+  };
+  bool cache_descriptors() const noexcept { return cache_descriptors_; };
+
+  // run the callbacks from the queue's drain() instead of the plugin's
+  // threads; the queue must outlive the plugin
+  plugin_attributes &notify(notification_queue &q) noexcept {
+    queue_ = &q;
+    return *this;
+  };
+  notification_queue *queue() const noexcept { return queue_; };
+
 private:
   std::filesystem::path path_;
   callback_t callback_;
+  ref_callback_t ref_callback_;
   on_error_t on_error_;
+  bool cache_descriptors_ = false;
+  notification_queue *queue_ = nullptr;
 };
 
 } // namespace wrap
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <wrap/visibility.hpp>
+
+#include <module_load/version.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace wrap {
+
+struct discovery_options {
+#if defined(_WIN32)
+  static constexpr const char *default_extension = ".dll";
+#else
+  static constexpr const char *default_extension = ".so";
+#endif
+
+  // where the manifest cache is kept; empty disables it
+  std::filesystem::path manifest;
+  // zero uses one worker per hardware thread
+  size_t workers = 0;
+  std::string extension = default_extension;
+};
+
+struct discovered_plugin {
+  std::filesystem::path path;
+  modl::library_version library_version;
+  uint16_t major;
+  uint16_t minor;
+  uint16_t patch;
+  std::string pre_release;
+  std::string build;
+  std::string name;
+  std::string description;
+  // listed from the manifest, without loading the module
+  bool cached;
+};
+
+struct discovery_failure {
+  std::filesystem::path path;
+  std::string message;
+};
+
+struct discovery_result {
+  // both sorted by path
+  std::vector<discovered_plugin> plugins;
+  std::vector<discovery_failure> failures;
+};
+
+// Lists the compatible plugins in a directory. Candidates are opened and
+// validated on a pool of workers: the module has to be compatible with this
+// host and report its version and descriptor. With a manifest, plugins whose
+// inode, modification time and size are unchanged since the last discovery
+// are listed from it instead, and the manifest is rewritten afterwards.
+// Failing candidates are never cached.
+WRAPPER_DLL_PUBLIC discovery_result
+discover_plugins(const std::filesystem::path &, const discovery_options & = {});
+
+} // namespace wrap
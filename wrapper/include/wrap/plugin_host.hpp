@@ -0,0 +1,84 @@
+#pragma once
+
+#include <wrap/action_scheduler.hpp>
+#include <wrap/plugin.hpp>
+#include <wrap/plugin_attributes.hpp>
+#include <wrap/visibility.hpp>
+
+#include <module_load/modulefwd.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+namespace wrap {
+
+class action;
+class payload;
+struct error_descriptor;
+
+struct plugin_host_stats {
+  // submissions and events not yet finished
+  size_t queued;
+  uint64_t executed;
+  uint64_t events;
+  // from submission, or from the plugin raising the event, to completion
+  std::chrono::nanoseconds mean_latency;
+  std::chrono::nanoseconds max_latency;
+};
+
+// Runs many plugins on one action_scheduler. Each plugin added gets a queue of
+// its own, which holds both the submissions for its actions and its events,
+// so that event handlers run on the scheduler's workers instead of the
+// plugin's threads; plugins share the workers' time in proportion to their
+// weight, so a plugin busy with slow actions or a flood of events only delays
+// itself. The plugins must not be used after the host is gone.
+class WRAPPER_DLL_PUBLIC plugin_host {
+public:
+  using on_finish_t = action_scheduler::on_finish_t;
+  using on_error_t = action_scheduler::on_error_t;
+  using event_handler_t = plugin_attributes::callback_t;
+
+  explicit plugin_host(size_t workers = 1, on_error_t = {});
+
+  plugin_host(const plugin_host &) = delete;
+  plugin_host &operator=(const plugin_host &) = delete;
+
+  // waits for whatever is queued, then releases the plugins
+  ~plugin_host();
+
+  plugin add(const modl::loaded_module &, std::filesystem::path persistence,
+             event_handler_t, error_descriptor &,
+             uint32_t weight = action_scheduler::default_weight);
+  std::optional<plugin> add(const modl::loaded_module &,
+                            std::filesystem::path persistence, event_handler_t,
+                            std::error_code &, error_descriptor &,
+                            uint32_t weight =
+                                action_scheduler::default_weight) noexcept;
+
+  // what is already queued for the plugin still runs
+  void remove(const plugin &);
+  std::vector<plugin> plugins() const;
+
+  void weight(const plugin &, uint32_t);
+  bool weight(const plugin &, uint32_t, std::error_code &) noexcept;
+
+  void submit(const action &, payload, submit_options = {}, on_finish_t = {});
+  bool submit(const action &, payload, submit_options, on_finish_t,
+              std::error_code &) noexcept;
+
+  // zeroed for plugins that were not added
+  plugin_host_stats stats(const plugin &) const noexcept;
+
+  void await();
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace wrap
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <wrap/action.hpp>
+#include <wrap/payload.hpp>
+#include <wrap/visibility.hpp>
+
+#include <plugin/plugin_interface.h>
+
+#include <system_error>
+
+namespace wrap {
+
+struct error_descriptor;
+
+// An action the plugin has resolved once for payloads of a single type.
+// Executions call the entry point the plugin returned for it directly. Once
+// the action is modified or removed they fail with action_errc::stale, after
+// which refresh() prepares it again.
+class WRAPPER_DLL_PUBLIC prepared_action {
+public:
+  prepared_action(const action &, PASMP_payload_tag_t, error_descriptor &);
+
+  prepared_action(const prepared_action &) = delete;
+  prepared_action &operator=(const prepared_action &) = delete;
+
+  prepared_action(prepared_action &&) noexcept;
+  prepared_action &operator=(prepared_action &&) noexcept;
+
+  ~prepared_action();
+
+  // payloads of any other type than the one prepared for are rejected
+  void execute(payload_view, error_descriptor &) const;
+  bool execute(payload_view, std::error_code &,
+               error_descriptor &) const noexcept;
+
+  void refresh(error_descriptor &);
+  bool refresh(std::error_code &, error_descriptor &) noexcept;
+
+  const action &get_action() const noexcept { return action_; }
+  PASMP_payload_tag_t payload_tag() const noexcept { return tag_; }
+
+private:
+  void destroy() noexcept;
+
+  action action_;
+  PASMP_payload_tag_t tag_;
+  PASMP_prepared_action_t ctx_ = nullptr;
+  PASMP_prepared_execute_t *fn_ = nullptr;
+};
+
+} // namespace wrap
@@ -2,26 +2,45 @@
 
 #include <wrap/visibility.hpp>
 
-#include <memory>
-#include <string>
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string_view>
 
 namespace wrap {
 
+namespace detail {
+struct string_rep;
+} // namespace detail
+
+// Immutable, reference counted string. The counter, hash and null-terminated
+// characters share one allocation; interned strings stay in a process-wide
+// pool for as long as some copy of them is alive.
 class WRAPPER_DLL_PUBLIC rc_immutable_string {
 public:
-  using str_type = std::string;
+  using str_type = std::string_view;
   using value_type = str_type::value_type;
   using size_type = str_type::size_type;
   using const_iterator = str_type::const_iterator;
   using const_reverse_iterator = str_type::const_reverse_iterator;
 
+  rc_immutable_string() noexcept;
   explicit rc_immutable_string(std::string_view);
 
-  operator const str_type &() const noexcept;
+  rc_immutable_string(const rc_immutable_string &) noexcept;
+  rc_immutable_string(rc_immutable_string &&) noexcept;
+
+  rc_immutable_string &operator=(const rc_immutable_string &) noexcept;
+  rc_immutable_string &operator=(rc_immutable_string &&) noexcept;
+
+  ~rc_immutable_string();
+
+  operator std::string_view() const noexcept;
 
   const value_type *c_str() const noexcept;
   size_type size() const noexcept;
   bool empty() const noexcept;
+  size_t hash() const noexcept;
 
   const_iterator begin() const noexcept;
   const_iterator cbegin() const noexcept;
@@ -33,8 +52,31 @@ public:
   const_reverse_iterator crbegin() const noexcept;
   const_reverse_iterator crend() const noexcept;
 
+  // live interned strings are equal exactly when their representations are
+  // shared
+  friend WRAPPER_DLL_PUBLIC bool
+  operator==(const rc_immutable_string &,
+             const rc_immutable_string &) noexcept;
+
 private:
-  std::shared_ptr<const str_type> data_;
+  friend WRAPPER_DLL_PUBLIC rc_immutable_string intern(std::string_view);
+
+  explicit rc_immutable_string(detail::string_rep *) noexcept;
+
+  detail::string_rep *rep_;
 };
 
+// Returns the single interned copy of a string, creating it when no copy is
+// alive.
+WRAPPER_DLL_PUBLIC rc_immutable_string intern(std::string_view);
+
+WRAPPER_DLL_PUBLIC std::ostream &operator<<(std::ostream &,
+                                            const rc_immutable_string &);
+
 } // namespace wrap
+
+template <> struct std::hash<wrap::rc_immutable_string> {
+  size_t operator()(const wrap::rc_immutable_string &x) const noexcept {
+    return x.hash();
+  }
+};
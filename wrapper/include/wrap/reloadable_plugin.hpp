@@ -0,0 +1,88 @@
+#pragma once
+
+#include <wrap/action.hpp>
+#include <wrap/admission_control.hpp>
+#include <wrap/plugin.hpp>
+#include <wrap/visibility.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <system_error>
+
+namespace wrap {
+
+class action_scheduler;
+struct error_descriptor;
+
+// A plugin whose module can be swapped for another build while in use.
+// reload() opens the new module alongside the current one, moves the actions
+// across and publishes it as a new epoch, so that every pin taken afterwards
+// targets the new build. Earlier epochs drain: each stays loaded for as long
+// as it is pinned, and its module is unloaded once the last pin and action
+// referring to it are gone. Pins must not outlive the reloadable_plugin.
+// Admission limits and scheduler weights set through it are carried over to
+// every later epoch.
+class WRAPPER_DLL_PUBLIC reloadable_plugin {
+  struct generation;
+
+public:
+  class WRAPPER_DLL_PUBLIC pin {
+  public:
+    const plugin &get() const noexcept;
+    const plugin *operator->() const noexcept { return &get(); }
+    const plugin &operator*() const noexcept { return get(); }
+
+    uint64_t epoch() const noexcept;
+
+  private:
+    friend class reloadable_plugin;
+    explicit pin(std::shared_ptr<const generation>) noexcept;
+
+    std::shared_ptr<const generation> gen_;
+  };
+
+  explicit reloadable_plugin(plugin);
+
+  reloadable_plugin(const reloadable_plugin &) = delete;
+  reloadable_plugin &operator=(const reloadable_plugin &) = delete;
+
+  // waits for the earlier epochs to drain
+  ~reloadable_plugin();
+
+  pin acquire() const noexcept;
+  uint64_t epoch() const noexcept;
+
+  // opens a private copy of the file, so the path may be that of the current
+  // module, rebuilt in place
+  void reload(const std::filesystem::path &, error_descriptor &);
+  bool reload(const std::filesystem::path &, std::error_code &,
+              error_descriptor &) noexcept;
+
+  // looks up an action of an earlier epoch in the current one
+  action rebind(const action &, error_descriptor &) const;
+  std::optional<action> rebind(const action &, std::error_code &,
+                               error_descriptor &) const noexcept;
+
+  void limit(rate_limit, error_descriptor &);
+  bool limit(rate_limit, std::error_code &, error_descriptor &) noexcept;
+
+  void limit(const action &, rate_limit, error_descriptor &);
+  bool limit(const action &, rate_limit, std::error_code &,
+             error_descriptor &) noexcept;
+
+  // the scheduler must outlive the reloadable_plugin
+  void weight(action_scheduler &, uint32_t);
+  bool weight(action_scheduler &, uint32_t, std::error_code &) noexcept;
+
+  // number of earlier epochs that are still pinned
+  size_t draining() const noexcept;
+  void await_drained() const noexcept;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace wrap
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <wrap/action_event.hpp>
+#include <wrap/plugin.hpp>
+#include <wrap/visibility.hpp>
+
+#include <module_load/modulefwd.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+
+namespace wrap {
+
+class action;
+class plugin_attributes;
+struct error_descriptor;
+
+struct replication_options {
+  // a snapshot follows a change after at most snapshot_delay, and is sent
+  // every snapshot_interval regardless
+  std::chrono::milliseconds snapshot_delay{10};
+  std::chrono::milliseconds snapshot_interval{1000};
+};
+
+struct primary_stats {
+  uint64_t seq;
+  uint64_t events;
+  uint64_t snapshots;
+  size_t standbys;
+  // standbys that fell too far behind
+  uint64_t dropped;
+};
+
+struct standby_stats {
+  // of the last frame received and of the snapshot held
+  uint64_t seq;
+  uint64_t snapshot_seq;
+  // received after the snapshot, so not reflected in it yet
+  uint64_t pending_events;
+  // from the primary sending a frame to the standby receiving it
+  std::chrono::nanoseconds lag;
+  std::chrono::nanoseconds max_lag;
+  // since the last frame was received, which grows once the primary is gone
+  std::chrono::nanoseconds idle;
+  bool connected;
+};
+
+// Streams the state of a plugin to standby processes connecting to a Unix
+// socket. Every registry change passed to publish() is forwarded as an event
+// and followed by a snapshot, made with plugin::serialize(), after at most the
+// snapshot delay; a standby that connects starts with a snapshot of its own.
+// Standbys that fall too far behind are dropped, and states too large to send
+// fail the snapshot.
+class WRAPPER_DLL_PUBLIC replication_primary {
+public:
+  // replaces whatever the path names
+  replication_primary(plugin, const std::filesystem::path &socket,
+                      replication_options = {});
+
+  replication_primary(const replication_primary &) = delete;
+  replication_primary &operator=(const replication_primary &) = delete;
+
+  ~replication_primary();
+
+  // meant for the plugin's event callback
+  void publish(action_event, const action &);
+  bool publish(action_event, const action &, std::error_code &) noexcept;
+
+  primary_stats stats() const noexcept;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+// Follows a replication_primary, keeping the latest snapshot of its plugin so
+// that promote() can take over with the actions bound as they were. A standby
+// does not reconnect: once the connection is lost, it is time to promote.
+class WRAPPER_DLL_PUBLIC replication_standby {
+public:
+  explicit replication_standby(const std::filesystem::path &socket);
+
+  replication_standby(const replication_standby &) = delete;
+  replication_standby &operator=(const replication_standby &) = delete;
+
+  ~replication_standby();
+
+  standby_stats stats() const noexcept;
+
+  // empty until the first snapshot arrives
+  std::optional<std::string> snapshot() const;
+
+  // creates the plugin and restores the latest snapshot into it
+  plugin promote(const modl::loaded_module &, plugin_attributes,
+                 error_descriptor &) const;
+  std::optional<plugin> promote(const modl::loaded_module &, plugin_attributes,
+                                std::error_code &,
+                                error_descriptor &) const noexcept;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace wrap
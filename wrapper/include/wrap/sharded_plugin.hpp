@@ -0,0 +1,68 @@
+#pragma once
+
+#include <wrap/action.hpp>
+#include <wrap/plugin.hpp>
+#include <wrap/visibility.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace wrap {
+
+struct error_descriptor;
+
+// Spreads the actions of a plugin over copies of its module, each loaded from
+// its own file and so holding its own registry. An action belongs to the shard
+// that follows its key on a consistent hash ring, where every shard has a
+// number of points; the key is the action's name, which unlike its handle
+// means the same to every copy. route() finds its counterpart in the owner.
+// Construction leaves every shard with only the keys it owns, and adding or
+// removing a shard then only moves the actions whose keys change owner,
+// extracting them from the shard they leave; a shard added gives away the
+// actions it brings but does not own. Routing runs concurrently with
+// rebalancing: callers see either layout, and the shards of the layout they
+// saw stay loaded while in use, but an action being moved is not found.
+class WRAPPER_DLL_PUBLIC sharded_plugin {
+public:
+  static constexpr size_t default_points = 64;
+
+  // the plugins must come from distinct modules; an action whose key a
+  // shard owns is kept over the copies the others hold
+  sharded_plugin(std::vector<plugin>, error_descriptor &,
+                 size_t points_per_shard = default_points);
+
+  sharded_plugin(const sharded_plugin &) = delete;
+  sharded_plugin &operator=(const sharded_plugin &) = delete;
+
+  ~sharded_plugin();
+
+  size_t size() const noexcept;
+  std::vector<plugin> shards() const;
+
+  // the shard owning the actions of a name
+  plugin owner(std::string_view key) const;
+
+  // looks up an action, of any shard, in the one that owns it
+  action route(const action &, error_descriptor &) const;
+  std::optional<action> route(const action &, std::error_code &,
+                              error_descriptor &) const noexcept;
+
+  void add_shard(plugin, error_descriptor &);
+  bool add_shard(plugin, std::error_code &, error_descriptor &) noexcept;
+
+  // the last shard cannot be removed
+  void remove_shard(const plugin &, error_descriptor &);
+  bool remove_shard(const plugin &, std::error_code &,
+                    error_descriptor &) noexcept;
+
+private:
+  struct layout;
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace wrap
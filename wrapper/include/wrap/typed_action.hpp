@@ -0,0 +1,110 @@
+#pragma once
+
+#include <wrap/action.hpp>
+#include <wrap/error.hpp>
+#include <wrap/payload.hpp>
+#include <wrap/visibility.hpp>
+
+#include <plugin/plugin_interface.h>
+
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace wrap {
+
+struct error_descriptor;
+
+// the payload tag an action has to declare to be bound to an argument type;
+// types without a specialization cannot be bound at all
+template <typename T> struct payload_type;
+
+template <> struct payload_type<int32_t> {
+  static constexpr PASMP_payload_tag_t tag = PASMP_PAYLOAD_INT32;
+};
+template <> struct payload_type<int64_t> {
+  static constexpr PASMP_payload_tag_t tag = PASMP_PAYLOAD_INT64;
+};
+template <> struct payload_type<uint32_t> {
+  static constexpr PASMP_payload_tag_t tag = PASMP_PAYLOAD_UINT32;
+};
+template <> struct payload_type<uint64_t> {
+  static constexpr PASMP_payload_tag_t tag = PASMP_PAYLOAD_UINT64;
+};
+template <> struct payload_type<float> {
+  static constexpr PASMP_payload_tag_t tag = PASMP_PAYLOAD_FLOAT;
+};
+template <> struct payload_type<double> {
+  static constexpr PASMP_payload_tag_t tag = PASMP_PAYLOAD_DOUBLE;
+};
+template <> struct payload_type<std::string_view> {
+  static constexpr PASMP_payload_tag_t tag = PASMP_PAYLOAD_STRING;
+};
+
+namespace detail {
+
+WRAPPER_DLL_PUBLIC bool check_payload_type(const action &, PASMP_payload_tag_t,
+                                           std::error_code &,
+                                           error_descriptor &) noexcept;
+
+WRAPPER_DLL_PUBLIC bool execute_typed(const action &, int32_t,
+                                      std::error_code &,
+                                      error_descriptor &) noexcept;
+WRAPPER_DLL_PUBLIC bool execute_typed(const action &, payload_view,
+                                      std::error_code &,
+                                      error_descriptor &) noexcept;
+
+} // namespace detail
+
+template <typename Signature> class typed_action;
+
+// An action bound to the argument type in its signature, e.g.
+// typed_action<void(int32_t)>. The payload type the plugin declares for the
+// action is checked once, when binding; executions then pass the value
+// without runtime tag dispatch (int32_t goes through a dedicated entry point)
+// and arguments of any other type do not compile.
+template <typename T> class typed_action<void(T)> {
+public:
+  using argument_type = T;
+
+  static constexpr PASMP_payload_tag_t tag = payload_type<T>::tag;
+
+  typed_action(const action &a, error_descriptor &ed) : action_(a) {
+    if (std::error_code ec; !detail::check_payload_type(action_, tag, ec, ed))
+      error_code_as_exception(ec, ed);
+  }
+
+  static std::optional<typed_action>
+  bind(const action &a, std::error_code &ec, error_descriptor &ed) {
+    if (!detail::check_payload_type(a, tag, ec, ed))
+      return std::nullopt;
+    return typed_action{a};
+  }
+
+  template <std::same_as<T> U>
+  void operator()(U x, error_descriptor &ed) const {
+    if (std::error_code ec; !(*this)(x, ec, ed))
+      error_code_as_exception(ec, ed);
+  }
+
+  template <std::same_as<T> U>
+  bool operator()(U x, std::error_code &ec,
+                  error_descriptor &ed) const noexcept {
+    if constexpr (std::is_same_v<T, int32_t>)
+      return detail::execute_typed(action_, x, ec, ed);
+    else
+      return detail::execute_typed(action_, payload_view{x}, ec, ed);
+  }
+
+  const action &get() const noexcept { return action_; }
+
+private:
+  explicit typed_action(const action &a) : action_(a) {}
+
+  action action_;
+};
+
+} // namespace wrap
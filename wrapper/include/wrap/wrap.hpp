@@ -4,17 +4,30 @@
 #include <wrap/action_descriptor.hpp>
 #include <wrap/action_event.hpp>
 #include <wrap/action_executor.hpp>
+#include <wrap/action_range.hpp>
+#include <wrap/action_scheduler.hpp>
+#include <wrap/action_timer.hpp>
+#include <wrap/admission_control.hpp>
 #include <wrap/basic_descriptor.hpp>
+#include <wrap/coroutine.hpp>
 #include <wrap/error.hpp>
 #include <wrap/error_descriptor.hpp>
 #include <wrap/nothrow.hpp>
+#include <wrap/notification_queue.hpp>
 #include <wrap/passkey.hpp>
 #include <wrap/payload.hpp>
 #include <wrap/plugin.hpp>
 #include <wrap/plugin_attributes.hpp>
 #include <wrap/plugin_configurator.hpp>
 #include <wrap/plugin_descriptor.hpp>
+#include <wrap/plugin_discovery.hpp>
+#include <wrap/plugin_host.hpp>
 #include <wrap/plugin_object.hpp>
 #include <wrap/plugin_version.hpp>
+#include <wrap/prepared_action.hpp>
 #include <wrap/rcstring.hpp>
+#include <wrap/reloadable_plugin.hpp>
+#include <wrap/replication.hpp>
+#include <wrap/sharded_plugin.hpp>
+#include <wrap/typed_action.hpp>
 #include <wrap/visibility.hpp>
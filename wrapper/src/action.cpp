@@ -3,24 +3,11 @@
 #include <wrap/error.hpp>
 #include <wrap/error_descriptor.hpp>
 
+#include "handle_utils.hpp"
 #include "status_utils.hpp"
 
 #include <iostream>
 
-namespace {
-
-PASMP_action_t deserialize(const modl::loaded_module &mod, std::string_view str,
-                           wrap::error_descriptor &ed) {
-  PASMP_action_t retval = nullptr;
-  ed.clear();
-  if (auto status =
-          mod.funcs().action_deserialize(&retval, str.data(), str.size(), &ed))
-    wrap::status_to_exception(status, ed);
-  return retval;
-}
-
-} // namespace
-
 namespace wrap {
 
 size_t action::hash::operator()(const action &x) const noexcept {
@@ -34,7 +21,10 @@ action::action(const plugin &p, PASMP_action_t handle, key<plugin>) noexcept
     : action(p, handle) {}
 
 action::action(const plugin &p, std::string_view data, error_descriptor &ed)
-    : action(p, deserialize(p.get_module(), data, ed)) {}
+    : action(p, deserialize_action(p.get_module(), data, ed)) {}
+
+action::action(const action_ref &x)
+    : plugin_(x.get_plugin()), value_(copy(x.get())) {}
 
 action::action(const action &x) : plugin_(x.plugin_), value_(copy(x.value_)) {}
 
@@ -94,28 +84,7 @@ std::string action::serialize(std::error_code &ec, error_descriptor &ed) const {
 }
 
 PASMP_action_t action::copy(PASMP_action_t x) const {
-  // small optimization: only use dynamic memory if size query is larger than
-  // static buffer size
-  auto [staticbuff, dynbuff] = std::pair<char[32], std::unique_ptr<char[]>>();
-  size_t size = 0;
-  static_error_descriptor<128> ed;
-  auto &function = get_plugin().get_module().funcs().action_serialize;
-  // query the size;
-  ed.clear();
-  if (auto status = function(x, nullptr, &size, &ed))
-    wrap::status_to_exception(status, ed);
-  char *buffer;
-  if (size > sizeof(staticbuff)) {
-    dynbuff = std::make_unique<char[]>(size);
-    buffer = dynbuff.get();
-  } else {
-    buffer = staticbuff;
-  }
-  // write the contents
-  ed.clear();
-  if (auto status = function(x, buffer, &size, &ed))
-    wrap::status_to_exception(status, ed);
-  return deserialize(get_plugin().get_module(), {buffer, size}, ed);
+  return copy_action_handle(get_plugin().get_module(), x);
 }
 
 bool operator==(const action &lhs, const action &rhs) noexcept {
@@ -124,6 +93,12 @@ bool operator==(const action &lhs, const action &rhs) noexcept {
                                                             rhs.get());
 }
 
+bool operator==(const action_ref &lhs, const action_ref &rhs) noexcept {
+  return lhs.get_plugin() == rhs.get_plugin() &&
+         lhs.get_plugin().get_module().funcs().action_equal(lhs.get(),
+                                                            rhs.get());
+}
+
 std::ostream &operator<<(std::ostream &os, const action &x) {
   static_error_descriptor<128> ed;
   return os << x.serialize(ed);
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <wrap/action.hpp>
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/passkey.hpp>
+#include <wrap/plugin.hpp>
+
+#include <module_load/module.hpp>
+#include <plugin/plugin_interface.h>
+
+#include "status_utils.hpp"
+
+#include <optional>
+#include <span>
+
+namespace wrap {
+
+class action_collection {
+public:
+  explicit action_collection(const plugin &p, error_descriptor &ed,
+                             key<plugin> key)
+      : plugin_(p), col_(create_collection(ed)), key_(key) {}
+
+  ~action_collection() {
+    if (auto status =
+            plugin_.get_module().funcs().action_collection_destroy(col_))
+      default_error_handler("Error destroying action collection",
+                            make_error_code(status));
+  }
+
+  action_collection(const action_collection &) = delete;
+  action_collection &operator=(const action_collection &) = delete;
+
+  action operator[](size_t idx) const {
+    null_error_descriptor ed;
+    return at(idx, ed);
+  }
+
+  action at(size_t idx, error_descriptor &ed) const {
+    PASMP_action_t act = nullptr;
+    ed.clear();
+    if (auto status = plugin_.get_module().funcs().action_collection_at(
+            get(), idx, &act, &ed))
+      status_to_exception(status, ed);
+    return action{plugin_, act, key_};
+  }
+
+  std::optional<action> at(size_t idx, std::error_code &ec,
+                           error_descriptor &ed) const {
+    PASMP_action_t act = nullptr;
+    ed.clear();
+    if (auto status = plugin_.get_module().funcs().action_collection_at(
+            get(), idx, &act, &ed)) {
+      ec = make_error_code(status);
+      return std::nullopt;
+    }
+    ed.clear();
+    return action{plugin_, act, key_};
+  }
+
+  size_t size() const noexcept {
+    return plugin_.get_module().funcs().action_collection_size(get());
+  }
+
+  // reads the handles starting at offset into out, returning how many were
+  // read; the handles are owned by the collection
+  size_t read(size_t offset, std::span<PASMP_action_t> out,
+              error_descriptor &ed) const {
+    uint64_t count = out.size();
+    ed.clear();
+    if (auto status = plugin_.get_module().funcs().action_collection_read(
+            get(), offset, out.data(), &count, &ed))
+      status_to_exception(status, ed);
+    return count;
+  }
+
+  PASMP_action_collection_t get() const noexcept { return col_; }
+  const plugin &get_plugin() const noexcept { return plugin_; }
+
+private:
+  PASMP_action_collection_t create_collection(error_descriptor &ed) const {
+    PASMP_action_collection_t col = nullptr;
+    ed.clear();
+    if (auto status =
+            plugin_.get_module().funcs().action_collection_create(&col, &ed))
+      status_to_exception(status, ed);
+    return col;
+  }
+
+  // declared first, creating the collection goes through the plugin's module
+  plugin plugin_;
+  PASMP_action_collection_t col_;
+  key<plugin> key_;
+};
+
+} // namespace wrap
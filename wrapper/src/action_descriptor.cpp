@@ -13,17 +13,18 @@
 namespace {
 
 template <bool ShortVariant>
-std::string load_name(const modl::loaded_module &mod,
-                      PASMP_action_descriptor_t handle) {
+wrap::rc_immutable_string load_name(const modl::loaded_module &mod,
+                                    PASMP_action_descriptor_t handle) {
   auto [str, sz] = mod.funcs().action_name(handle, ShortVariant);
-  return std::string(str, sz);
+  return wrap::intern({str, sz});
 }
 
 template <bool ShortVariant>
-std::string load_description(const modl::loaded_module &mod,
-                             PASMP_action_descriptor_t handle) {
+wrap::rc_immutable_string
+load_description(const modl::loaded_module &mod,
+                 PASMP_action_descriptor_t handle) {
   auto [str, sz] = mod.funcs().action_description(handle, ShortVariant);
-  return std::string(str, sz);
+  return wrap::intern({str, sz});
 }
 
 PASMP_action_descriptor_t create_descriptor(const wrap::action &act,
@@ -1,65 +1,339 @@
-#include "..\include\wrap\action_executor.hpp"
 #include <wrap/action_executor.hpp>
 #include <wrap/error.hpp>
 #include <wrap/error_descriptor.hpp>
+#include <wrap/notification_queue.hpp>
 #include <wrap/payload.hpp>
 
 #include <module_load/module.hpp>
 
 #include "status_utils.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// slots allocated at a time by an executor without an in-flight limit
+constexpr uint32_t default_chunk = 64;
+
+} // namespace
+
 namespace wrap {
 
+namespace detail {
+
+struct future_slot {
+  enum : uint32_t { pending, chained, ready };
+
+  action_executor *owner;
+  future_slot *next_free;
+  std::atomic<uint32_t> state;
+  // one reference for the future, one for the completion
+  std::atomic<uint32_t> refs;
+  std::error_code ec;
+  action_future::continuation_t cont;
+  void *ctx;
+  size_t msg_size;
+  char msg[256];
+
+  std::string_view message() const noexcept { return {msg, msg_size}; }
+};
+
+} // namespace detail
+
+// Also counts the submissions in flight. A completion's last access is to
+// the pool, which it keeps alive through refs, so await() returning on the
+// executor's thread cannot free memory the completion still touches.
+struct action_executor::slot_pool {
+  std::mutex mtx;
+  std::vector<std::unique_ptr<detail::future_slot[]>> chunks;
+  detail::future_slot *free = nullptr;
+  uint32_t chunk_size;
+  std::atomic<uint32_t> in_flight = 0;
+  // one for the executor, one per submission in flight
+  std::atomic<uint32_t> refs = 1;
+
+  explicit slot_pool(uint32_t cs) : chunk_size(cs) {}
+
+  static void unref(slot_pool *p) noexcept {
+    if (p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete p;
+  }
+
+  void grow() {
+    auto &chunk = chunks.emplace_back(
+        std::make_unique<detail::future_slot[]>(chunk_size));
+    for (uint32_t i = 0; i < chunk_size; i++) {
+      chunk[i].next_free = free;
+      free = &chunk[i];
+    }
+  }
+
+  detail::future_slot *acquire(action_executor &owner) {
+    detail::future_slot *s;
+    {
+      std::scoped_lock lk(mtx);
+      if (!free)
+        grow();
+      s = std::exchange(free, free->next_free);
+    }
+    s->owner = &owner;
+    s->state.store(detail::future_slot::pending, std::memory_order_relaxed);
+    s->refs.store(2, std::memory_order_relaxed);
+    s->cont = nullptr;
+    s->msg_size = 0;
+    return s;
+  }
+
+  void release(detail::future_slot *s) noexcept {
+    std::scoped_lock lk(mtx);
+    s->next_free = std::exchange(free, s);
+  }
+};
+
 struct action_executor::helper {
-  static void wrap_callback(PASMP_status_t s, PASMP_string_view_t err_msg,
-                            void *data) {
-    action_executor &exec = *static_cast<action_executor *>(data);
+  static void drop(detail::future_slot &s) noexcept {
+    if (s.refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      s.owner->pool_->release(&s);
+  }
+
+  static void report(const on_error_t &on_error) noexcept {
     try {
-      exec.on_finish_(make_error_code(s), {err_msg.data, err_msg.size});
+      if (on_error)
+        on_error(std::current_exception());
+      else
+        handle_callback_exception();
     } catch (...) {
+      handle_callback_exception();
+    }
+  }
+
+  static void report(action_executor &exec) noexcept {
+    report(exec.on_error_);
+  }
+
+  static void run_continuation(detail::future_slot &s) noexcept {
+    try {
+      s.cont(s.ctx, s.ec, s.message());
+    } catch (...) {
+      report(*s.owner);
+    }
+  }
+
+  static void wrap_callback(PASMP_status_t s, PASMP_string_view_t err_msg,
+                            void *data) {
+    auto &slot = *static_cast<detail::future_slot *>(data);
+    action_executor &exec = *slot.owner;
+    // the executor may be gone as soon as the window is left
+    auto &pool = *exec.pool_;
+    slot.ec = make_error_code(s);
+    slot.msg_size = std::min(err_msg.size, sizeof(slot.msg));
+    if (slot.msg_size)
+      std::memcpy(slot.msg, err_msg.data, slot.msg_size);
+    if (exec.on_finish_ && exec.queue_) {
       try {
-        if (exec.on_error_)
-          exec.on_error_(std::current_exception());
-        else
-          handle_callback_exception();
+        exec.queue_->post([on_finish = exec.on_finish_,
+                           on_error = exec.on_error_, ec = slot.ec,
+                           msg = std::string(err_msg.data, err_msg.size)]() {
+          try {
+            on_finish(ec, msg);
+          } catch (...) {
+            report(on_error);
+          }
+        });
       } catch (...) {
-        handle_callback_exception();
+        report(exec);
+      }
+    } else if (exec.on_finish_) {
+      try {
+        exec.on_finish_(slot.ec, {err_msg.data, err_msg.size});
+      } catch (...) {
+        report(exec);
       }
     }
-    exec.submitctr_.fetch_sub(1);
-    exec.submitcv_.notify_one();
+    auto prev =
+        slot.state.exchange(detail::future_slot::ready, std::memory_order_acq_rel);
+    slot.state.notify_all();
+    if (prev == detail::future_slot::chained)
+      run_continuation(slot);
+    // the slot must be back in the pool before await() can return
+    drop(slot);
+    leave_window(pool);
   }
 };
 
-action_executor::action_executor(const action &a, on_finish_t of, on_error_t oe)
+action_future::action_future(detail::future_slot *s) noexcept : slot_(s) {}
+
+action_future::action_future(action_future &&x) noexcept
+    : slot_(std::exchange(x.slot_, nullptr)) {}
+
+action_future &action_future::operator=(action_future &&x) noexcept {
+  if (this != &x) {
+    if (slot_)
+      action_executor::helper::drop(*slot_);
+    slot_ = std::exchange(x.slot_, nullptr);
+  }
+  return *this;
+}
+
+action_future::~action_future() {
+  if (slot_)
+    action_executor::helper::drop(*slot_);
+}
+
+bool action_future::ready() const noexcept {
+  return slot_->state.load(std::memory_order_acquire) ==
+         detail::future_slot::ready;
+}
+
+std::error_code action_future::wait() const noexcept {
+  for (auto s = slot_->state.load(std::memory_order_acquire);
+       s != detail::future_slot::ready;
+       s = slot_->state.load(std::memory_order_acquire))
+    slot_->state.wait(s, std::memory_order_acquire);
+  return slot_->ec;
+}
+
+std::optional<std::error_code> action_future::try_get() const noexcept {
+  if (!ready())
+    return std::nullopt;
+  return slot_->ec;
+}
+
+std::string_view action_future::message() const noexcept {
+  return slot_->message();
+}
+
+void action_future::then(continuation_t cont, void *ctx) noexcept {
+  slot_->cont = cont;
+  slot_->ctx = ctx;
+  uint32_t expected = detail::future_slot::pending;
+  if (!slot_->state.compare_exchange_strong(expected,
+                                            detail::future_slot::chained,
+                                            std::memory_order_acq_rel))
+    action_executor::helper::run_continuation(*slot_);
+}
+
+action_executor::action_executor(const action &a, in_flight_window w)
+    : action_executor(a, on_finish_t{}, on_error_t{}, w) {}
+
+action_executor::action_executor(const action &a, on_finish_t of, on_error_t oe,
+                                 in_flight_window w)
     : action_(a), on_finish_(std::move(of)), on_error_(std::move(oe)),
-      submitctr_(0) {}
+      window_(w), pool_(std::make_unique<slot_pool>(
+                      w.limit ? w.limit : default_chunk)) {
+  // a bounded window is served entirely from slots allocated up front
+  if (w.limit)
+    pool_->grow();
+}
 
-action_executor::~action_executor() { await(); }
+action_executor::action_executor(const action &a, on_finish_t of,
+                                 notification_queue &q, on_error_t oe,
+                                 in_flight_window w)
+    : action_executor(a, std::move(of), std::move(oe), w) {
+  queue_ = &q;
+}
 
-void action_executor::submit(const payload &p, error_descriptor &ed) {
-  if (std::error_code ec; !submit(p, ec, ed))
+action_executor::~action_executor() {
+  await();
+  slot_pool::unref(pool_.release());
+}
+
+bool action_executor::enter_window() noexcept {
+  auto &ctr = pool_->in_flight;
+  auto n = ctr.load();
+  while (true) {
+    if (window_.limit && n >= window_.limit) {
+      if (window_.on_full == overflow_policy::fail)
+        return false;
+      ctr.wait(n);
+      n = ctr.load();
+    } else if (ctr.compare_exchange_weak(n, n + 1)) {
+      pool_->refs.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+}
+
+void action_executor::leave_window(slot_pool &pool) noexcept {
+  pool.in_flight.fetch_sub(1);
+  // wakes both await() and submissions blocked on a full window
+  pool.in_flight.notify_all();
+  slot_pool::unref(&pool);
+}
+
+action_future action_executor::submit(payload_view p, error_descriptor &ed) {
+  std::error_code ec;
+  auto retval = submit(p, ec, ed);
+  if (ec)
     error_code_as_exception(ec, ed);
+  return retval;
 }
 
-bool action_executor::submit(const payload &p, std::error_code &ec,
-                             error_descriptor &ed) noexcept {
+action_future action_executor::submit(payload_view p, std::error_code &ec,
+                                      error_descriptor &ed) noexcept {
   const auto &mod = get_action().get_plugin().get_module();
   auto handle_plugin = get_action().get_plugin().get();
   auto handle_action = get_action().get();
   ed.clear();
+  // the window is entered before submitting because the callback may run, and
+  // leave it, before action_execute_async returns
+  if (!enter_window()) {
+    ec = make_error_code(plugin_errc::unavailable);
+    return {};
+  }
+  detail::future_slot *slot;
+  try {
+    slot = pool_->acquire(*this);
+  } catch (const std::bad_alloc &) {
+    leave_window(*pool_);
+    ec = make_error_code(generic_errc::alloc);
+    return {};
+  }
   auto status = mod.funcs().action_execute_async(
-      handle_plugin, handle_action, p, &helper::wrap_callback, this, &ed);
-  ec = make_error_code(status);
-  if (!ec)
-    submitctr_.fetch_add(1);
-  return !ec;
+      handle_plugin, handle_action, p, &helper::wrap_callback, slot, &ed);
+  if ((ec = make_error_code(status))) {
+    // the callback was not invoked, so drop its reference as well
+    slot->refs.store(1, std::memory_order_relaxed);
+    helper::drop(*slot);
+    leave_window(*pool_);
+    return {};
+  }
+  return action_future{slot};
 }
 
 void action_executor::await() {
-  std::mutex mux;
-  std::unique_lock lk{mux};
-  submitcv_.wait(lk, [this]() { return submitctr_.load() <= 0; });
+  auto &ctr = pool_->in_flight;
+  for (auto n = ctr.load(); n; n = ctr.load())
+    ctr.wait(n);
+}
+
+void post(const action &a, payload p, error_descriptor &ed) {
+  if (std::error_code ec; !post(a, std::move(p), ec, ed))
+    error_code_as_exception(ec, ed);
+}
+
+bool post(const action &a, payload p, std::error_code &ec,
+          error_descriptor &ed) noexcept {
+  // the string buffer is moved, not copied, into the released object
+  auto owned = new (std::nothrow) payload(std::move(p));
+  if (!owned) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  }
+  const auto &plug = a.get_plugin();
+  ed.clear();
+  auto status = plug.get_module().funcs().action_execute_async_owned(
+      plug.get(), a.get(), *owned,
+      [](void *data) { delete static_cast<payload *>(data); }, owned, nullptr,
+      nullptr, &ed);
+  ec = make_error_code(status);
+  return !ec;
 }
 
 } // namespace wrap
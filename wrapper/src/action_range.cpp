@@ -0,0 +1,68 @@
+#include <wrap/action_range.hpp>
+#include <wrap/error_descriptor.hpp>
+
+#include "action_collection.hpp"
+
+#include <array>
+#include <stdexcept>
+
+namespace wrap {
+
+struct action_range::impl {
+  action_collection col;
+  size_t total;
+  // index of the first handle in chunk
+  size_t offset = 0;
+  size_t filled = 0;
+  std::array<PASMP_action_t, chunk_size> chunk{};
+  static_error_descriptor<256> ed;
+
+  impl(const plugin &p, error_descriptor &ed, key<plugin> k)
+      : col(p, ed, k), total(fill(p, ed)) {}
+
+  size_t fill(const plugin &p, error_descriptor &ed) {
+    ed.clear();
+    if (auto status =
+            p.get_module().funcs().plugin_actions(p.get(), col.get(), &ed))
+      status_to_exception(status, ed);
+    return col.size();
+  }
+
+  PASMP_action_t at(size_t idx) {
+    if (idx < offset || idx >= offset + filled) {
+      offset = idx - idx % chunk_size;
+      // left empty should the read throw
+      filled = 0;
+      filled = col.read(offset, chunk, ed);
+      // the collection is a snapshot, so only a misbehaving plugin gets here
+      if (idx >= offset + filled)
+        throw std::out_of_range("action collection read came up short");
+    }
+    return chunk[idx - offset];
+  }
+};
+
+action_ref action_range::iterator::operator*() const {
+  return action_ref{impl_->col.get_plugin(), impl_->at(index_)};
+}
+
+bool action_range::iterator::done() const noexcept {
+  return !impl_ || index_ >= impl_->total;
+}
+
+action_range::action_range() noexcept = default;
+
+action_range::action_range(const plugin &p, error_descriptor &ed,
+                           key<plugin> k)
+    : impl_(std::make_unique<impl>(p, ed, k)) {}
+
+action_range::action_range(action_range &&) noexcept = default;
+action_range &action_range::operator=(action_range &&) noexcept = default;
+
+action_range::~action_range() = default;
+
+size_t action_range::size() const noexcept {
+  return impl_ ? impl_->total : 0;
+}
+
+} // namespace wrap
@@ -0,0 +1,375 @@
+#include <wrap/action.hpp>
+#include <wrap/action_scheduler.hpp>
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/payload.hpp>
+
+#include <module_load/module.hpp>
+
+#include "status_utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// stride scheduling: every quantum of execution time granted to a plugin
+// advances its pass by stride_base / weight, and the plugin with the lowest
+// pass is served next
+constexpr uint64_t stride_base = uint64_t{1} << 20;
+constexpr std::chrono::nanoseconds quantum = std::chrono::microseconds{100};
+
+struct task {
+  // either an action to execute or a posted function
+  std::optional<wrap::action> act;
+  wrap::payload data;
+  wrap::action_scheduler::on_finish_t on_finish;
+  std::function<void()> fn;
+  PASMP_plugin_t owner;
+  wrap::action_scheduler::clock::time_point deadline;
+  uint64_t seq;
+};
+
+// the heap algorithms build a max-heap, so the "greater" task runs later
+struct edf_order {
+  bool operator()(const task &lhs, const task &rhs) const noexcept {
+    if (lhs.deadline != rhs.deadline)
+      return lhs.deadline > rhs.deadline;
+    return lhs.seq > rhs.seq;
+  }
+};
+
+// kept once drained until the level's virtual time catches up with it, so
+// that a plugin rejoining a level still owes whatever its last executions
+// overran
+struct lane {
+  std::vector<task> queue;
+  uint64_t pass = 0;
+  // execution time short of a whole unit of pass, scaled by stride_base
+  uint64_t carry = 0;
+  // dropped as soon as it drains
+  bool forgotten = false;
+};
+
+struct priority_level {
+  std::unordered_map<PASMP_plugin_t, lane> lanes;
+  uint64_t vtime = 0;
+  size_t queued = 0;
+
+  std::atomic<uint64_t> submitted = 0;
+  std::atomic<uint64_t> executed = 0;
+  std::atomic<uint64_t> deadline_misses = 0;
+};
+
+} // namespace
+
+namespace wrap {
+
+struct action_scheduler::impl {
+  on_error_t on_error;
+
+  mutable std::mutex mtx;
+  std::condition_variable_any queued_cv;
+  std::condition_variable idle_cv;
+  std::array<priority_level, priority_class_count> levels;
+  std::unordered_map<PASMP_plugin_t, uint32_t> weights;
+  uint64_t next_seq = 0;
+  size_t queued = 0;
+  size_t pending = 0;
+
+  // declared last so that workers are joined before anything else is destroyed
+  std::vector<std::jthread> workers;
+
+  impl(size_t count, on_error_t &&oe) : on_error(std::move(oe)) {
+    workers.reserve(count);
+    for (size_t i = 0; i < count; i++)
+      workers.emplace_back([this](std::stop_token st) { run(st); });
+  }
+
+  uint32_t weight_of(PASMP_plugin_t key) const {
+    auto it = weights.find(key);
+    return it == weights.end() ? default_weight : it->second;
+  }
+
+  void push(task &&t, priority_class pc) {
+    auto &level = levels[static_cast<size_t>(pc)];
+    {
+      std::scoped_lock lk(mtx);
+      auto &l = level.lanes[t.owner];
+      if (l.queue.empty())
+        l.pass = std::max(l.pass, level.vtime);
+      t.seq = next_seq++;
+      l.queue.push_back(std::move(t));
+      std::push_heap(l.queue.begin(), l.queue.end(), edf_order{});
+      level.queued++;
+      queued++;
+      pending++;
+    }
+    level.submitted.fetch_add(1, std::memory_order_relaxed);
+    queued_cv.notify_one();
+  }
+
+  struct popped {
+    task t;
+    priority_level *level;
+    // charged up front, so that other workers do not all pick the same lane
+    uint64_t stride;
+  };
+
+  // must be called with mtx held and at least one task queued
+  popped pop() {
+    for (auto &level : levels) {
+      if (!level.queued)
+        continue;
+      auto next = level.lanes.end();
+      for (auto it = level.lanes.begin(); it != level.lanes.end();) {
+        auto &l = it->second;
+        if (l.queue.empty() && (l.forgotten || l.pass <= level.vtime)) {
+          it = level.lanes.erase(it);
+          continue;
+        }
+        if (!l.queue.empty() &&
+            (next == level.lanes.end() || l.pass < next->second.pass))
+          next = it;
+        ++it;
+      }
+      assert(next != level.lanes.end());
+      auto &[key, l] = *next;
+      std::pop_heap(l.queue.begin(), l.queue.end(), edf_order{});
+      task t = std::move(l.queue.back());
+      l.queue.pop_back();
+      level.vtime = l.pass;
+      auto stride = stride_base / weight_of(key);
+      l.pass += stride;
+      level.queued--;
+      queued--;
+      return {std::move(t), &level, stride};
+    }
+    assert(false);
+    throw std::logic_error("pop from an empty scheduler");
+  }
+
+  // replaces the stride pop() charged with one for the time the execution
+  // took, carrying over what falls short of a whole unit; must be called with
+  // mtx held
+  void charge(priority_level &level, PASMP_plugin_t key, uint64_t charged,
+              clock::duration elapsed) {
+    auto it = level.lanes.find(key);
+    if (it == level.lanes.end())
+      return;
+    auto &l = it->second;
+    auto per_stride = static_cast<uint64_t>(quantum.count()) * weight_of(key);
+    auto ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    auto owed = ns * stride_base + l.carry;
+    l.carry = owed % per_stride;
+    l.pass = std::max(l.pass, charged) - charged + owed / per_stride;
+  }
+
+  void run(std::stop_token stoken) {
+    static_error_descriptor<256> ed;
+    while (true) {
+      std::unique_lock lk(mtx);
+      if (!queued_cv.wait(lk, stoken, [this]() { return queued > 0; }))
+        break;
+      priority_level *level;
+      PASMP_plugin_t key;
+      uint64_t charged;
+      clock::duration elapsed;
+      {
+        auto [t, l, stride] = pop();
+        lk.unlock();
+        auto start = clock::now();
+        execute(t, *l, ed);
+        elapsed = clock::now() - start;
+        level = l;
+        key = t.owner;
+        charged = stride;
+      }
+      lk.lock();
+      charge(*level, key, charged, elapsed);
+      if (!--pending) {
+        lk.unlock();
+        idle_cv.notify_all();
+      }
+    }
+  }
+
+  void execute(task &t, priority_level &level, error_descriptor &ed) noexcept {
+    if (t.fn) {
+      try {
+        t.fn();
+      } catch (...) {
+        report();
+      }
+      finished(t, level);
+      return;
+    }
+    const auto &p = t.act->get_plugin();
+    ed.clear();
+    auto status =
+        p.get_module().funcs().action_execute(p.get(), t.act->get(), t.data, &ed);
+    finished(t, level);
+    if (!t.on_finish)
+      return;
+    try {
+      t.on_finish(make_error_code(status), ed.view());
+    } catch (...) {
+      report();
+    }
+  }
+
+  void finished(const task &t, priority_level &level) noexcept {
+    // time_point::max() stands for "no deadline"
+    if (clock::now() > t.deadline)
+      level.deadline_misses.fetch_add(1, std::memory_order_relaxed);
+    level.executed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void report() noexcept {
+    try {
+      if (on_error)
+        on_error(std::current_exception());
+      else
+        handle_callback_exception();
+    } catch (...) {
+      handle_callback_exception();
+    }
+  }
+};
+
+action_scheduler::action_scheduler(size_t workers, on_error_t oe) {
+  if (!workers)
+    throw logic_error(logic_errc::invalid_argument, null_error_descriptor{});
+  impl_ = std::make_unique<impl>(workers, std::move(oe));
+}
+
+action_scheduler::~action_scheduler() { await(); }
+
+void action_scheduler::weight(const plugin &p, uint32_t w) {
+  if (std::error_code ec; !weight(p, w, ec))
+    error_code_as_exception(ec, null_error_descriptor{});
+}
+
+bool action_scheduler::weight(const plugin &p, uint32_t w,
+                              std::error_code &ec) noexcept {
+  if (!w) {
+    ec = make_error_code(logic_errc::invalid_argument);
+    return false;
+  }
+  try {
+    std::scoped_lock lk(impl_->mtx);
+    impl_->weights[p.get()] = w;
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+uint32_t action_scheduler::weight(const plugin &p) const noexcept {
+  std::scoped_lock lk(impl_->mtx);
+  return impl_->weight_of(p.get());
+}
+
+void action_scheduler::forget(const plugin &p) noexcept {
+  std::scoped_lock lk(impl_->mtx);
+  impl_->weights.erase(p.get());
+  for (auto &level : impl_->levels) {
+    auto it = level.lanes.find(p.get());
+    if (it == level.lanes.end())
+      continue;
+    if (it->second.queue.empty())
+      level.lanes.erase(it);
+    else
+      it->second.forgotten = true;
+  }
+}
+
+void action_scheduler::submit(const action &a, payload p, submit_options opts,
+                              on_finish_t of) {
+  if (std::error_code ec; !submit(a, std::move(p), opts, std::move(of), ec))
+    error_code_as_exception(ec, null_error_descriptor{});
+}
+
+bool action_scheduler::submit(const action &a, payload p, submit_options opts,
+                              on_finish_t of, std::error_code &ec) noexcept {
+  if (static_cast<size_t>(opts.priority) >= priority_class_count) {
+    ec = make_error_code(logic_errc::invalid_argument);
+    return false;
+  }
+  try {
+    impl_->push(task{.act = a,
+                     .data = std::move(p),
+                     .on_finish = std::move(of),
+                     .fn = {},
+                     .owner = a.get_plugin().get(),
+                     .deadline = opts.deadline.value_or(clock::time_point::max()),
+                     .seq = 0},
+                opts.priority);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (const any_error &e) {
+    ec = e.code();
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+void action_scheduler::post(const plugin &p, std::function<void()> fn,
+                            submit_options opts) {
+  if (std::error_code ec; !post(p, std::move(fn), opts, ec))
+    error_code_as_exception(ec, null_error_descriptor{});
+}
+
+bool action_scheduler::post(const plugin &p, std::function<void()> fn,
+                            submit_options opts, std::error_code &ec) noexcept {
+  if (!fn || static_cast<size_t>(opts.priority) >= priority_class_count) {
+    ec = make_error_code(logic_errc::invalid_argument);
+    return false;
+  }
+  try {
+    impl_->push(task{.act = std::nullopt,
+                     .data = payload{},
+                     .on_finish = {},
+                     .fn = std::move(fn),
+                     .owner = p.get(),
+                     .deadline = opts.deadline.value_or(clock::time_point::max()),
+                     .seq = 0},
+                opts.priority);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+scheduler_stats action_scheduler::stats(priority_class pc) const noexcept {
+  const auto &level = impl_->levels[static_cast<size_t>(pc)];
+  return {.submitted = level.submitted.load(std::memory_order_relaxed),
+          .executed = level.executed.load(std::memory_order_relaxed),
+          .deadline_misses =
+              level.deadline_misses.load(std::memory_order_relaxed)};
+}
+
+void action_scheduler::await() {
+  std::unique_lock lk(impl_->mtx);
+  impl_->idle_cv.wait(lk, [this]() { return !impl_->pending; });
+}
+
+} // namespace wrap
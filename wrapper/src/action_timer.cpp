@@ -0,0 +1,462 @@
+#include <wrap/action.hpp>
+#include <wrap/action_timer.hpp>
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/payload.hpp>
+
+#include <module_load/module.hpp>
+
+#include "status_utils.hpp"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr unsigned level_bits = 8;
+constexpr size_t level_count = 4;
+constexpr size_t slots_per_level = size_t{1} << level_bits;
+constexpr uint64_t slot_mask = slots_per_level - 1;
+constexpr uint64_t max_delta = (uint64_t{1} << (level_bits * level_count)) - 1;
+constexpr uint32_t nil = std::numeric_limits<uint32_t>::max();
+
+struct job {
+  wrap::action act;
+  wrap::payload data;
+  wrap::action_timer::on_finish_t on_finish;
+};
+
+struct node {
+  std::shared_ptr<const job> work;
+  uint64_t expiry = 0;
+  uint64_t period = 0;
+  uint32_t prev = nil;
+  uint32_t next = nil;
+  uint32_t generation = 1;
+  uint16_t slot = 0;
+  bool linked = false;
+};
+
+// Four levels of 256 slots each. A timer due in less than 256^(L+1) ticks
+// lives in level L and is moved one level down whenever the level below wraps
+// around, so every timer is touched at most once per level.
+class timer_wheel {
+public:
+  timer_wheel() {
+    for (auto &level : heads_)
+      level.fill(nil);
+    for (auto &level : occupied_)
+      level.fill(0);
+  }
+
+  node &operator[](uint32_t idx) noexcept { return nodes_[idx]; }
+  const node &operator[](uint32_t idx) const noexcept { return nodes_[idx]; }
+
+  uint64_t now() const noexcept { return now_; }
+  size_t size() const noexcept { return size_; }
+  bool contains(uint32_t idx) const noexcept { return idx < nodes_.size(); }
+
+  uint32_t allocate() {
+    if (free_ == nil) {
+      if (nodes_.size() >= nil)
+        throw std::bad_alloc{};
+      nodes_.emplace_back();
+      return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+    auto idx = free_;
+    free_ = nodes_[idx].next;
+    nodes_[idx].next = nil;
+    return idx;
+  }
+
+  void release(uint32_t idx) noexcept {
+    auto &n = nodes_[idx];
+    assert(!n.linked);
+    n.work.reset();
+    if (!++n.generation)
+      n.generation = 1;
+    n.next = free_;
+    free_ = idx;
+  }
+
+  // expiry must not lie in the past; a timer due at the current tick is only
+  // fired when it is moved down from a higher level during that same tick
+  void insert(uint32_t idx) noexcept {
+    auto &n = nodes_[idx];
+    assert(n.expiry >= now_);
+    uint64_t delta = n.expiry - now_;
+    uint64_t expiry = n.expiry;
+    // beyond the range of the wheel: park in the farthest slot, the timer is
+    // re-inserted with the remaining delta once that slot is reached
+    if (delta > max_delta) {
+      delta = max_delta;
+      expiry = now_ + max_delta;
+    }
+    size_t level = 0;
+    while (level + 1 < level_count &&
+           delta >= (uint64_t{1} << (level_bits * (level + 1))))
+      level++;
+    size_t slot = (expiry >> (level_bits * level)) & slot_mask;
+    link(idx, level, slot);
+  }
+
+  void unlink(uint32_t idx) noexcept {
+    auto &n = nodes_[idx];
+    assert(n.linked);
+    size_t level = n.slot / slots_per_level;
+    size_t slot = n.slot % slots_per_level;
+    if (n.prev != nil)
+      nodes_[n.prev].next = n.next;
+    else
+      heads_[level][slot] = n.next;
+    if (n.next != nil)
+      nodes_[n.next].prev = n.prev;
+    if (heads_[level][slot] == nil)
+      occupied_[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    n.prev = n.next = nil;
+    n.linked = false;
+    size_--;
+  }
+
+  // the next tick at which timers may expire or have to be moved down
+  std::optional<uint64_t> next_event() const noexcept {
+    if (!size_)
+      return std::nullopt;
+    uint64_t boundary = (now_ | slot_mask) + 1;
+    size_t current = now_ & slot_mask;
+    for (size_t word = (current + 1) / 64; word < slots_per_level / 64;
+         word++) {
+      uint64_t bits = occupied_[0][word];
+      if (word == (current + 1) / 64)
+        bits &= ~uint64_t{0} << ((current + 1) % 64);
+      if (bits)
+        return now_ - current + word * 64 + std::countr_zero(bits);
+    }
+    return boundary;
+  }
+
+  // moves the wheel forward to target, handing every expired timer (already
+  // unlinked) to the callback in expiry order
+  template <typename Callable> void advance(uint64_t target, Callable &&f) {
+    while (now_ < target) {
+      auto next = next_event();
+      if (!next || *next > target) {
+        now_ = target;
+        return;
+      }
+      now_ = *next;
+      for (size_t level = level_count - 1; level > 0; level--)
+        if (!(now_ & ((uint64_t{1} << (level_bits * level)) - 1)))
+          cascade(level, (now_ >> (level_bits * level)) & slot_mask);
+      expire(now_ & slot_mask, f);
+    }
+  }
+
+private:
+  void link(uint32_t idx, size_t level, size_t slot) noexcept {
+    auto &n = nodes_[idx];
+    auto &head = heads_[level][slot];
+    n.prev = nil;
+    n.next = head;
+    if (head != nil)
+      nodes_[head].prev = idx;
+    head = idx;
+    n.slot = static_cast<uint16_t>(level * slots_per_level + slot);
+    n.linked = true;
+    occupied_[level][slot / 64] |= uint64_t{1} << (slot % 64);
+    size_++;
+  }
+
+  uint32_t detach(size_t level, size_t slot) noexcept {
+    auto idx = heads_[level][slot];
+    for (auto it = idx; it != nil; it = nodes_[it].next) {
+      nodes_[it].linked = false;
+      size_--;
+    }
+    heads_[level][slot] = nil;
+    occupied_[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    return idx;
+  }
+
+  void cascade(size_t level, size_t slot) noexcept {
+    for (auto idx = detach(level, slot); idx != nil;) {
+      auto next = nodes_[idx].next;
+      nodes_[idx].prev = nodes_[idx].next = nil;
+      insert(idx);
+      idx = next;
+    }
+  }
+
+  template <typename Callable> void expire(size_t slot, Callable &f) {
+    for (auto idx = detach(0, slot); idx != nil;) {
+      auto next = nodes_[idx].next;
+      nodes_[idx].prev = nodes_[idx].next = nil;
+      assert(nodes_[idx].expiry == now_);
+      f(idx);
+      idx = next;
+    }
+  }
+
+  std::vector<node> nodes_;
+  uint32_t free_ = nil;
+  std::array<std::array<uint32_t, slots_per_level>, level_count> heads_;
+  std::array<std::array<uint64_t, slots_per_level / 64>, level_count>
+      occupied_;
+  uint64_t now_ = 0;
+  size_t size_ = 0;
+};
+
+struct firing {
+  std::shared_ptr<const job> work;
+  wrap::action_timer::clock::time_point due;
+};
+
+wrap::timer_id make_id(uint32_t idx, uint32_t generation) noexcept {
+  return (uint64_t{idx} << 32) | generation;
+}
+
+} // namespace
+
+namespace wrap {
+
+struct action_timer::impl {
+  action_scheduler *scheduler;
+  priority_class priority;
+  on_error_t on_error;
+  const clock::time_point epoch;
+
+  mutable std::mutex mtx;
+  std::condition_variable_any cv;
+  timer_wheel wheel;
+  uint64_t wake_tick = std::numeric_limits<uint64_t>::max();
+  bool rearm = false;
+
+  // only touched by the timer thread
+  std::vector<firing> batch;
+  static_error_descriptor<256> ed;
+
+  // declared last so that the thread is joined before anything else is
+  // destroyed
+  std::jthread thread;
+
+  impl(action_scheduler *s, priority_class pc, on_error_t &&oe)
+      : scheduler(s), priority(pc), on_error(std::move(oe)),
+        epoch(clock::now()),
+        thread([this](std::stop_token st) { run(st); }) {}
+
+  uint64_t to_tick_floor(clock::time_point tp) const noexcept {
+    if (tp <= epoch)
+      return 0;
+    return std::chrono::floor<resolution>(tp - epoch).count();
+  }
+
+  uint64_t to_tick_ceil(clock::time_point tp) const noexcept {
+    if (tp <= epoch)
+      return 0;
+    return std::chrono::ceil<resolution>(tp - epoch).count();
+  }
+
+  static uint64_t to_ticks(clock::duration d) noexcept {
+    auto ticks = std::chrono::ceil<resolution>(d).count();
+    return ticks > 0 ? ticks : 1;
+  }
+
+  clock::time_point to_time(uint64_t tick) const noexcept {
+    return epoch + resolution{tick};
+  }
+
+  timer_id schedule(std::shared_ptr<const job> &&work, clock::time_point first,
+                    uint64_t period) {
+    timer_id id;
+    {
+      std::scoped_lock lk(mtx);
+      auto idx = wheel.allocate();
+      auto &n = wheel[idx];
+      n.work = std::move(work);
+      n.expiry = std::max(to_tick_ceil(first), wheel.now() + 1);
+      n.period = period;
+      wheel.insert(idx);
+      id = make_id(idx, n.generation);
+      if (n.expiry >= wake_tick)
+        return id;
+      rearm = true;
+    }
+    cv.notify_one();
+    return id;
+  }
+
+  bool cancel(timer_id id) noexcept {
+    auto idx = static_cast<uint32_t>(id >> 32);
+    auto generation = static_cast<uint32_t>(id);
+    std::scoped_lock lk(mtx);
+    if (!wheel.contains(idx))
+      return false;
+    if (auto &n = wheel[idx]; n.generation != generation || !n.linked)
+      return false;
+    wheel.unlink(idx);
+    wheel.release(idx);
+    return true;
+  }
+
+  void run(std::stop_token stoken) {
+    while (!stoken.stop_requested()) {
+      std::unique_lock lk(mtx);
+      wheel.advance(to_tick_floor(clock::now()), [this](uint32_t idx) {
+        auto &n = wheel[idx];
+        batch.push_back({n.work, to_time(n.expiry)});
+        if (n.period) {
+          n.expiry += n.period;
+          wheel.insert(idx);
+        } else {
+          wheel.release(idx);
+        }
+      });
+      if (batch.empty()) {
+        auto next = wheel.next_event();
+        wake_tick = next.value_or(std::numeric_limits<uint64_t>::max());
+        rearm = false;
+        auto rearmed = [this]() { return rearm; };
+        if (next)
+          cv.wait_until(lk, stoken, to_time(*next), rearmed);
+        else
+          cv.wait(lk, stoken, rearmed);
+        continue;
+      }
+      lk.unlock();
+      for (auto &f : batch)
+        fire(f);
+      batch.clear();
+    }
+  }
+
+  void fire(const firing &f) noexcept {
+    const auto &work = *f.work;
+    if (scheduler) {
+      std::error_code ec;
+      on_finish_t of;
+      if (work.on_finish)
+        of = [w = f.work](std::error_code ec, std::string_view msg) {
+          w->on_finish(ec, msg);
+        };
+      if (scheduler->submit(work.act, work.data, {priority, f.due},
+                            std::move(of), ec))
+        return;
+      finish(work, ec, {});
+      return;
+    }
+    const auto &p = work.act.get_plugin();
+    ed.clear();
+    auto status = p.get_module().funcs().action_execute(p.get(), work.act.get(),
+                                                        work.data, &ed);
+    finish(work, make_error_code(status), ed.view());
+  }
+
+  void finish(const job &work, std::error_code ec,
+              std::string_view msg) noexcept {
+    if (!work.on_finish)
+      return;
+    try {
+      work.on_finish(ec, msg);
+    } catch (...) {
+      try {
+        if (on_error)
+          on_error(std::current_exception());
+        else
+          handle_callback_exception();
+      } catch (...) {
+        handle_callback_exception();
+      }
+    }
+  }
+};
+
+action_timer::action_timer(on_error_t oe)
+    : impl_(std::make_unique<impl>(nullptr, priority_class::normal,
+                                   std::move(oe))) {}
+
+action_timer::action_timer(action_scheduler &s, priority_class pc,
+                           on_error_t oe)
+    : impl_(std::make_unique<impl>(&s, pc, std::move(oe))) {}
+
+action_timer::~action_timer() = default;
+
+timer_id action_timer::schedule_at(const action &a, payload p,
+                                   clock::time_point tp, on_finish_t of) {
+  std::error_code ec;
+  auto id = schedule_at(a, std::move(p), tp, std::move(of), ec);
+  if (ec)
+    error_code_as_exception(ec, null_error_descriptor{});
+  return id;
+}
+
+timer_id action_timer::schedule_at(const action &a, payload p,
+                                   clock::time_point tp, on_finish_t of,
+                                   std::error_code &ec) noexcept {
+  return schedule_every(a, std::move(p), tp, clock::duration::zero(),
+                        std::move(of), ec);
+}
+
+timer_id action_timer::schedule_every(const action &a, payload p,
+                                      clock::duration period, on_finish_t of) {
+  return schedule_every(a, std::move(p), clock::now() + period, period,
+                        std::move(of));
+}
+
+timer_id action_timer::schedule_every(const action &a, payload p,
+                                      clock::duration period, on_finish_t of,
+                                      std::error_code &ec) noexcept {
+  return schedule_every(a, std::move(p), clock::now() + period, period,
+                        std::move(of), ec);
+}
+
+timer_id action_timer::schedule_every(const action &a, payload p,
+                                      clock::time_point first,
+                                      clock::duration period, on_finish_t of) {
+  std::error_code ec;
+  auto id = schedule_every(a, std::move(p), first, period, std::move(of), ec);
+  if (ec)
+    error_code_as_exception(ec, null_error_descriptor{});
+  return id;
+}
+
+// a zero period schedules a one-shot timer
+timer_id action_timer::schedule_every(const action &a, payload p,
+                                      clock::time_point first,
+                                      clock::duration period, on_finish_t of,
+                                      std::error_code &ec) noexcept {
+  if (period < clock::duration::zero()) {
+    ec = make_error_code(logic_errc::invalid_argument);
+    return 0;
+  }
+  try {
+    auto work = std::make_shared<const job>(
+        job{.act = a, .data = std::move(p), .on_finish = std::move(of)});
+    auto ticks = period == clock::duration::zero() ? 0 : impl::to_ticks(period);
+    auto id = impl_->schedule(std::move(work), first, ticks);
+    ec.clear();
+    return id;
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+  } catch (const any_error &e) {
+    ec = e.code();
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+  }
+  return 0;
+}
+
+bool action_timer::cancel(timer_id id) noexcept { return impl_->cancel(id); }
+
+size_t action_timer::pending() const noexcept {
+  std::scoped_lock lk(impl_->mtx);
+  return impl_->wheel.size();
+}
+
+} // namespace wrap
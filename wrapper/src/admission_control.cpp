@@ -0,0 +1,75 @@
+#include <wrap/action.hpp>
+#include <wrap/admission_control.hpp>
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+
+#include <module_load/module.hpp>
+
+#include "status_utils.hpp"
+
+namespace {
+
+PASMP_rate_limit_t to_native(wrap::rate_limit x) noexcept {
+  return {.rate = x.rate, .burst = x.burst, .max_in_flight = x.max_in_flight};
+}
+
+} // namespace
+
+namespace wrap {
+
+admission_control::admission_control(const plugin &p) : plugin_(p) {}
+
+const plugin &admission_control::get_plugin() const noexcept {
+  return plugin_;
+}
+
+void admission_control::limit(rate_limit x, error_descriptor &ed) {
+  if (std::error_code ec; !limit(x, ec, ed))
+    error_code_as_exception(ec, ed);
+}
+
+bool admission_control::limit(rate_limit x, std::error_code &ec,
+                              error_descriptor &ed) noexcept {
+  ed.clear();
+  ec = make_error_code(plugin_.get_module().funcs().plugin_limit(
+      plugin_.get(), to_native(x), &ed));
+  return !ec;
+}
+
+void admission_control::limit(const action &a, rate_limit x,
+                              error_descriptor &ed) {
+  if (std::error_code ec; !limit(a, x, ec, ed))
+    error_code_as_exception(ec, ed);
+}
+
+bool admission_control::limit(const action &a, rate_limit x,
+                              std::error_code &ec,
+                              error_descriptor &ed) noexcept {
+  ed.clear();
+  ec = make_error_code(plugin_.get_module().funcs().action_limit(
+      plugin_.get(), a.get(), to_native(x), &ed));
+  return !ec;
+}
+
+admission_stats admission_control::stats(const action &a,
+                                         error_descriptor &ed) const {
+  std::error_code ec;
+  auto retval = stats(a, ec, ed);
+  if (ec)
+    error_code_as_exception(ec, ed);
+  return retval;
+}
+
+admission_stats admission_control::stats(const action &a, std::error_code &ec,
+                                         error_descriptor &ed) const noexcept {
+  PASMP_admission_stats_t out;
+  ed.clear();
+  if ((ec = make_error_code(plugin_.get_module().funcs().action_admission_stats(
+           plugin_.get(), a.get(), &out, &ed))))
+    return {};
+  return {.admitted = out.admitted,
+          .rejected = out.rejected,
+          .in_flight = out.in_flight};
+}
+
+} // namespace wrap
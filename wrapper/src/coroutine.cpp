@@ -0,0 +1,144 @@
+#include <wrap/action.hpp>
+#include <wrap/coroutine.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/payload.hpp>
+
+#include <module_load/module.hpp>
+
+#include "status_utils.hpp"
+
+#include <array>
+#include <new>
+
+namespace {
+
+// frames are rounded up to a multiple of the granularity; larger frames
+// bypass the cache
+constexpr size_t granularity = 64;
+constexpr size_t size_classes = 16;
+constexpr size_t max_cached = 256;
+
+struct free_block {
+  free_block *next;
+};
+
+struct frame_cache {
+  std::array<free_block *, size_classes> heads{};
+  std::array<size_t, size_classes> counts{};
+
+  ~frame_cache() {
+    for (size_t c = 0; c < size_classes; c++)
+      while (auto b = heads[c]) {
+        heads[c] = b->next;
+        ::operator delete(b, (c + 1) * granularity);
+      }
+  }
+};
+
+thread_local frame_cache cache;
+
+size_t size_class(size_t n) noexcept {
+  return (n + granularity - 1) / granularity - 1;
+}
+
+} // namespace
+
+namespace wrap {
+
+namespace detail {
+
+void *allocate_frame(size_t n) {
+  auto c = size_class(n);
+  if (c >= size_classes)
+    return ::operator new(n);
+  if (auto b = cache.heads[c]) {
+    cache.heads[c] = b->next;
+    cache.counts[c]--;
+    return b;
+  }
+  return ::operator new((c + 1) * granularity);
+}
+
+void deallocate_frame(void *p, size_t n) noexcept {
+  auto c = size_class(n);
+  if (c >= size_classes) {
+    ::operator delete(p, n);
+  } else if (cache.counts[c] >= max_cached) {
+    ::operator delete(p, (c + 1) * granularity);
+  } else {
+    cache.heads[c] = ::new (p) free_block{cache.heads[c]};
+    cache.counts[c]++;
+  }
+}
+
+void unhandled_task_exception() noexcept { handle_callback_exception(); }
+
+} // namespace detail
+
+execute_awaitable::execute_awaitable(const action &a, payload_view p,
+                                     error_descriptor &ed,
+                                     scheduler &s) noexcept
+    : action_(a), payload_(p), ed_(ed), done_(s) {}
+
+bool execute_awaitable::await_suspend(std::coroutine_handle<> h) noexcept {
+  const auto &p = action_.get_plugin();
+  ed_.clear();
+  auto status = p.get_module().funcs().action_execute_async(
+      p.get(), action_.get(), payload_, &on_finish, this, &ed_);
+  // the callback is not invoked when submission fails
+  if ((ec_ = make_error_code(status)))
+    return false;
+  return done_.suspend(h);
+}
+
+void execute_awaitable::on_finish(PASMP_status_t s, PASMP_string_view_t,
+                                  void *data) {
+  auto &self = *static_cast<execute_awaitable *>(data);
+  self.ec_ = make_error_code(s);
+  self.done_.complete();
+}
+
+configure_awaitable::configure_awaitable(const plugin &p, configure_mode m,
+                                         error_descriptor &ed,
+                                         scheduler &s) noexcept
+    : plugin_(p), mode_(m), ed_(ed), done_(s) {}
+
+bool configure_awaitable::await_suspend(std::coroutine_handle<> h) noexcept {
+  const auto &funcs = plugin_.get_module().funcs();
+  auto status = PASMP_SUCCESS;
+  ed_.clear();
+  switch (mode_) {
+  case configure_mode::cli:
+    status = funcs.plugin_configure_cli(plugin_.get(), &on_finish, this, &ed_);
+    break;
+  case configure_mode::gui:
+    status = funcs.plugin_configure_gui(plugin_.get(), &on_finish, this, &ed_);
+    break;
+  default:
+    status = PASMP_INVALID_ARGUMENT;
+  }
+  if (status) {
+    result_ = {make_error_code(status), {}};
+    return false;
+  }
+  return done_.suspend(h);
+}
+
+void configure_awaitable::on_finish(PASMP_status_t s, PASMP_config_status_t cs,
+                                    void *data) {
+  auto &self = *static_cast<configure_awaitable *>(data);
+  self.result_ = to_configure_result(s, cs);
+  self.done_.complete();
+}
+
+execute_awaitable execute(const action &a, payload_view p,
+                          error_descriptor &ed, scheduler &s) noexcept {
+  return {a, p, ed, s};
+}
+
+configure_awaitable configure(const plugin &p, configure_mode m,
+                              error_descriptor &ed, scheduler &s) noexcept {
+  return {p, m, ed, s};
+}
+
+} // namespace wrap
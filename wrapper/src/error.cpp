@@ -106,6 +106,8 @@ std::string action_category_t::message(int cv) const {
     return "invalid payload tag";
   case wrap::action_errc::other:
     return "other error; check descriptor for more information";
+  case wrap::action_errc::stale:
+    return "action changed since it was prepared";
   }
   return "(unrecognized error code)";
 }
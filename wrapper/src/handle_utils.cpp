@@ -0,0 +1,49 @@
+#include "handle_utils.hpp"
+#include "status_utils.hpp"
+
+#include <wrap/error_descriptor.hpp>
+
+#include <module_load/module.hpp>
+
+#include <memory>
+#include <utility>
+
+namespace wrap {
+
+PASMP_action_t deserialize_action(const modl::loaded_module &mod,
+                                  std::string_view str, error_descriptor &ed) {
+  PASMP_action_t retval = nullptr;
+  ed.clear();
+  if (auto status =
+          mod.funcs().action_deserialize(&retval, str.data(), str.size(), &ed))
+    status_to_exception(status, ed);
+  return retval;
+}
+
+PASMP_action_t copy_action_handle(const modl::loaded_module &mod,
+                                  PASMP_action_t x) {
+  // small optimization: only use dynamic memory if size query is larger than
+  // static buffer size
+  auto [staticbuff, dynbuff] = std::pair<char[32], std::unique_ptr<char[]>>();
+  size_t size = 0;
+  static_error_descriptor<128> ed;
+  auto &function = mod.funcs().action_serialize;
+  // query the size;
+  ed.clear();
+  if (auto status = function(x, nullptr, &size, &ed))
+    status_to_exception(status, ed);
+  char *buffer;
+  if (size > sizeof(staticbuff)) {
+    dynbuff = std::make_unique<char[]>(size);
+    buffer = dynbuff.get();
+  } else {
+    buffer = staticbuff;
+  }
+  // write the contents
+  ed.clear();
+  if (auto status = function(x, buffer, &size, &ed))
+    status_to_exception(status, ed);
+  return deserialize_action(mod, {buffer, size}, ed);
+}
+
+} // namespace wrap
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <module_load/modulefwd.hpp>
+#include <plugin/plugin_interface.h>
+
+#include <string_view>
+
+namespace wrap {
+
+struct error_descriptor;
+
+PASMP_action_t deserialize_action(const modl::loaded_module &, std::string_view,
+                                  error_descriptor &);
+
+// action handles are copied by a serialization round trip
+PASMP_action_t copy_action_handle(const modl::loaded_module &, PASMP_action_t);
+
+} // namespace wrap
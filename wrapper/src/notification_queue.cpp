@@ -0,0 +1,164 @@
+#include <wrap/notification_queue.hpp>
+
+#include "status_utils.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+std::system_error last_system_error(const char *what) {
+#if defined(_WIN32)
+  return {std::error_code(GetLastError(), std::system_category()), what};
+#else
+  return {std::error_code(errno, std::system_category()), what};
+#endif
+}
+
+} // namespace
+
+namespace wrap {
+
+// Posting pushes onto an intrusive stack, which drain() takes whole and
+// reverses. Only the post that finds the stack empty signals, and drain()
+// resets the signal before taking the stack, so a post racing with it is
+// either taken along or signals again.
+struct notification_queue::impl {
+  struct node {
+    std::function<void()> fn;
+    node *next;
+  };
+
+  std::atomic<node *> head = nullptr;
+#if defined(_WIN32)
+  HANDLE event;
+#elif defined(__linux__)
+  int fd;
+#else
+  int fds[2];
+#endif
+
+  impl() {
+#if defined(_WIN32)
+    event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    if (!event)
+      throw last_system_error("Error creating notification event");
+#elif defined(__linux__)
+    fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0)
+      throw last_system_error("Error creating notification eventfd");
+#else
+    if (pipe(fds))
+      throw last_system_error("Error creating notification pipe");
+    for (int x : fds) {
+      fcntl(x, F_SETFL, fcntl(x, F_GETFL) | O_NONBLOCK);
+      fcntl(x, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+  }
+
+  ~impl() {
+    delete_list(head.exchange(nullptr, std::memory_order_acquire));
+#if defined(_WIN32)
+    CloseHandle(event);
+#elif defined(__linux__)
+    close(fd);
+#else
+    close(fds[0]);
+    close(fds[1]);
+#endif
+  }
+
+  static void delete_list(node *n) noexcept {
+    while (n)
+      delete std::exchange(n, n->next);
+  }
+
+  void signal() noexcept {
+#if defined(_WIN32)
+    SetEvent(event);
+#elif defined(__linux__)
+    uint64_t one = 1;
+    [[maybe_unused]] auto n = write(fd, &one, sizeof(one));
+#else
+    char one = 1;
+    [[maybe_unused]] auto n = write(fds[1], &one, sizeof(one));
+#endif
+  }
+
+  void reset() noexcept {
+#if defined(__linux__)
+    uint64_t count;
+    [[maybe_unused]] auto n = read(fd, &count, sizeof(count));
+#elif !defined(_WIN32)
+    char buf[64];
+    while (read(fds[0], buf, sizeof(buf)) > 0)
+      ;
+#endif
+    // an auto-reset event is reset by the wait that returned it
+  }
+};
+
+notification_queue::notification_queue() : impl_(std::make_unique<impl>()) {}
+
+notification_queue::~notification_queue() = default;
+
+notification_queue::native_handle_type
+notification_queue::native_handle() const noexcept {
+#if defined(_WIN32)
+  return impl_->event;
+#elif defined(__linux__)
+  return impl_->fd;
+#else
+  return impl_->fds[0];
+#endif
+}
+
+void notification_queue::post(std::function<void()> fn) {
+  auto *n = new impl::node{std::move(fn), nullptr};
+  // n belongs to drain() as soon as it is pushed
+  auto *prev = impl_->head.load(std::memory_order_relaxed);
+  do {
+    n->next = prev;
+  } while (!impl_->head.compare_exchange_weak(prev, n,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+  if (!prev)
+    impl_->signal();
+}
+
+size_t notification_queue::drain() {
+  impl_->reset();
+  auto *n = impl_->head.exchange(nullptr, std::memory_order_acquire);
+  impl::node *fifo = nullptr;
+  while (n)
+    fifo = std::exchange(n, std::exchange(n->next, fifo));
+  size_t count = 0;
+  for (; fifo; count++) {
+    auto *next = fifo->next;
+    try {
+      fifo->fn();
+    } catch (...) {
+      handle_callback_exception();
+    }
+    delete fifo;
+    fifo = next;
+  }
+  return count;
+}
+
+} // namespace wrap
@@ -14,39 +14,98 @@ payload::operator PASMP_payload_t() const &noexcept {
 payload::payload() noexcept : tag_{PASMP_PAYLOAD_NONE}, data_{} {}
 
 payload::payload(int32_t x) noexcept
-    : holder_(x), tag_{PASMP_PAYLOAD_INT32}, data_{.int32_value =
-                                                       std::get<decltype(x)>(
-                                                           holder_)} {}
+    : tag_{PASMP_PAYLOAD_INT32}, data_{.int32_value = x} {}
 
 payload::payload(int64_t x) noexcept
-    : holder_(x), tag_{PASMP_PAYLOAD_INT64}, data_{.int64_value =
-                                                       std::get<decltype(x)>(
-                                                           holder_)} {}
+    : tag_{PASMP_PAYLOAD_INT64}, data_{.int64_value = x} {}
 
 payload::payload(uint32_t x) noexcept
-    : holder_(x), tag_{PASMP_PAYLOAD_UINT32}, data_{.uint32_value =
-                                                        std::get<decltype(x)>(
-                                                            holder_)} {}
+    : tag_{PASMP_PAYLOAD_UINT32}, data_{.uint32_value = x} {}
 
 payload::payload(uint64_t x) noexcept
-    : holder_(x), tag_{PASMP_PAYLOAD_UINT64}, data_{.uint64_value =
-                                                        std::get<decltype(x)>(
-                                                            holder_)} {}
+    : tag_{PASMP_PAYLOAD_UINT64}, data_{.uint64_value = x} {}
 
 payload::payload(float x) noexcept
-    : holder_(x), tag_{PASMP_PAYLOAD_FLOAT}, data_{.float_value =
-                                                       std::get<decltype(x)>(
-                                                           holder_)} {}
+    : tag_{PASMP_PAYLOAD_FLOAT}, data_{.float_value = x} {}
 
 payload::payload(double x) noexcept
-    : holder_(x), tag_{PASMP_PAYLOAD_DOUBLE}, data_{.double_value =
-                                                        std::get<decltype(x)>(
-                                                            holder_)} {}
+    : tag_{PASMP_PAYLOAD_DOUBLE}, data_{.double_value = x} {}
 
 payload::payload(std::string x) noexcept
-    : holder_(std::move(x)), tag_{PASMP_PAYLOAD_STRING}, data_{} {
-  const auto &str = std::get<decltype(x)>(holder_);
-  data_.string_value = {.data = str.c_str(), .size = str.size()};
+    : string_(std::move(x)), tag_{PASMP_PAYLOAD_STRING}, data_{} {
+  rebind();
 }
 
+payload::payload(const payload &x)
+    : string_(x.string_), tag_(x.tag_), data_(x.data_) {
+  rebind();
+}
+
+payload::payload(payload &&x) noexcept
+    : string_(std::move(x.string_)), tag_(x.tag_), data_(x.data_) {
+  rebind();
+}
+
+payload &payload::operator=(const payload &x) {
+  if (this != &x) {
+    string_ = x.string_;
+    tag_ = x.tag_;
+    data_ = x.data_;
+    rebind();
+  }
+  return *this;
+}
+
+payload &payload::operator=(payload &&x) noexcept {
+  if (this != &x) {
+    string_ = std::move(x.string_);
+    tag_ = x.tag_;
+    data_ = x.data_;
+    rebind();
+  }
+  return *this;
+}
+
+// the string view in the union must point into this object's own string
+void payload::rebind() noexcept {
+  if (tag_ == PASMP_PAYLOAD_STRING)
+    data_.string_value = {.data = string_.c_str(), .size = string_.size()};
+}
+
+payload_view::operator PASMP_payload_t() const &noexcept {
+  return {.tag = tag_, .data = &data_};
+}
+
+payload_view::payload_view() noexcept : tag_{PASMP_PAYLOAD_NONE}, data_{} {}
+
+payload_view::payload_view(const payload &x) noexcept
+    : tag_(x.tag_), data_(x.data_) {}
+
+payload_view::payload_view(int32_t x) noexcept
+    : tag_{PASMP_PAYLOAD_INT32}, data_{.int32_value = x} {}
+
+payload_view::payload_view(int64_t x) noexcept
+    : tag_{PASMP_PAYLOAD_INT64}, data_{.int64_value = x} {}
+
+payload_view::payload_view(uint32_t x) noexcept
+    : tag_{PASMP_PAYLOAD_UINT32}, data_{.uint32_value = x} {}
+
+payload_view::payload_view(uint64_t x) noexcept
+    : tag_{PASMP_PAYLOAD_UINT64}, data_{.uint64_value = x} {}
+
+payload_view::payload_view(float x) noexcept
+    : tag_{PASMP_PAYLOAD_FLOAT}, data_{.float_value = x} {}
+
+payload_view::payload_view(double x) noexcept
+    : tag_{PASMP_PAYLOAD_DOUBLE}, data_{.double_value = x} {}
+
+payload_view::payload_view(std::string_view x) noexcept
+    : tag_{PASMP_PAYLOAD_STRING},
+      data_{.string_value = {.data = x.data(), .size = x.size()}} {}
+
+payload_view::payload_view(std::span<const std::byte> x) noexcept
+    : tag_{PASMP_PAYLOAD_STRING},
+      data_{.string_value = {.data = reinterpret_cast<const char *>(x.data()),
+                             .size = x.size()}} {}
+
 } // namespace wrap
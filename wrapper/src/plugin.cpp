@@ -1,6 +1,8 @@
 #include <wrap/action.hpp>
+#include <wrap/action_range.hpp>
 #include <wrap/error.hpp>
 #include <wrap/error_descriptor.hpp>
+#include <wrap/notification_queue.hpp>
 #include <wrap/plugin.hpp>
 #include <wrap/plugin_attributes.hpp>
 #include <wrap/plugin_object.hpp>
@@ -8,77 +10,19 @@
 #include <module_load/module.hpp>
 #include <plugin/plugin_interface.h>
 
+#include "action_collection.hpp"
+#include "handle_utils.hpp"
 #include "status_utils.hpp"
 
+#include <atomic>
 #include <cassert>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
 
 namespace {
 
-class action_collection {
-public:
-  explicit action_collection(const wrap::plugin &p, wrap::error_descriptor &ed,
-                             wrap::key<wrap::plugin> key)
-      : col_(create_collection(ed)), plugin_(p), key_(key) {}
-
-  ~action_collection() {
-    if (auto status =
-            plugin_.get_module().funcs().action_collection_destroy(col_))
-      wrap::default_error_handler("Error destroying action collection",
-                                  wrap::make_error_code(status));
-  }
-
-  action_collection(const action_collection &) = delete;
-  action_collection &operator=(const action_collection &) = delete;
-
-  wrap::action operator[](size_t idx) const {
-    wrap::null_error_descriptor ed;
-    return at(idx, ed);
-  }
-
-  wrap::action at(size_t idx, wrap::error_descriptor &ed) const {
-    PASMP_action_t act = nullptr;
-    ed.clear();
-    if (auto status = plugin_.get_module().funcs().action_collection_at(
-            get(), idx, &act, &ed))
-      wrap::status_to_exception(status, ed);
-    return wrap::action{plugin_, act, key_};
-  }
-
-  std::optional<wrap::action> at(size_t idx, std::error_code &ec,
-                                 wrap::error_descriptor &ed) const {
-    PASMP_action_t act = nullptr;
-    ed.clear();
-    if (auto status = plugin_.get_module().funcs().action_collection_at(
-            get(), idx, &act, &ed)) {
-      ec = wrap::make_error_code(status);
-      return std::nullopt;
-    }
-    ed.clear();
-    return wrap::action{plugin_, act, key_};
-  }
-
-  size_t size() const noexcept {
-    return plugin_.get_module().funcs().action_collection_size(get());
-  }
-
-  PASMP_action_collection_t get() const noexcept { return col_; }
-
-private:
-  PASMP_action_collection_t
-  create_collection(wrap::error_descriptor &ed) const {
-    PASMP_action_collection_t col = nullptr;
-    ed.clear();
-    if (auto status =
-            plugin_.get_module().funcs().action_collection_create(&col, &ed))
-      wrap::status_to_exception(status, ed);
-    return col;
-  }
-
-  PASMP_action_collection_t col_;
-  wrap::plugin plugin_;
-  wrap::key<wrap::plugin> key_;
-};
-
 class plugin_attributes_helper final : public ::wrap::plugin_object {
 public:
   PASMP_plugin_attr_t get() const noexcept { return attr_; }
@@ -122,6 +66,141 @@ private:
   PASMP_plugin_attr_t attr_;
 };
 
+// owns a copy of an action handle without keeping the plugin alive, so that
+// the descriptor cache inside the plugin does not form a reference cycle
+class handle_key {
+public:
+  handle_key(const modl::loaded_module &mod, PASMP_action_t handle)
+      : mod_(&mod), value_(wrap::copy_action_handle(mod, handle)) {}
+
+  handle_key(handle_key &&x) noexcept
+      : mod_(x.mod_), value_(std::exchange(x.value_, nullptr)) {}
+
+  handle_key(const handle_key &) = delete;
+  handle_key &operator=(const handle_key &) = delete;
+
+  ~handle_key() {
+    if (value_)
+      if (auto status = mod_->funcs().action_destroy(value_))
+        wrap::default_error_handler("Error destroying action handle",
+                                    wrap::make_error_code(status));
+  }
+
+  PASMP_action_t get() const noexcept { return value_; }
+
+private:
+  const modl::loaded_module *mod_;
+  PASMP_action_t value_;
+};
+
+struct handle_hash {
+  using is_transparent = void;
+
+  const modl::loaded_module *mod;
+
+  size_t operator()(PASMP_action_t x) const noexcept {
+    return mod->funcs().action_hash(x);
+  }
+  size_t operator()(const handle_key &x) const noexcept {
+    return (*this)(x.get());
+  }
+};
+
+struct handle_equal {
+  using is_transparent = void;
+
+  const modl::loaded_module *mod;
+
+  bool operator()(PASMP_action_t lhs, PASMP_action_t rhs) const noexcept {
+    return mod->funcs().action_equal(lhs, rhs);
+  }
+  bool operator()(const handle_key &lhs, const handle_key &rhs) const noexcept {
+    return (*this)(lhs.get(), rhs.get());
+  }
+  bool operator()(const handle_key &lhs, PASMP_action_t rhs) const noexcept {
+    return (*this)(lhs.get(), rhs);
+  }
+  bool operator()(PASMP_action_t lhs, const handle_key &rhs) const noexcept {
+    return (*this)(lhs, rhs.get());
+  }
+};
+
+// Descriptors cannot be fetched from within the event callbacks, since the
+// plugin may hold its own lock while invoking them, so events only invalidate
+// entries and lookups fill the cache lazily. A fill is discarded if any event
+// arrived while it was being fetched.
+class descriptor_cache {
+public:
+  explicit descriptor_cache(const modl::loaded_module &mod)
+      : entries_(0, handle_hash{&mod}, handle_equal{&mod}) {}
+
+  std::optional<wrap::action_descriptor> find(PASMP_action_t x) const {
+    std::shared_lock lk(mtx_);
+    auto it = entries_.find(x);
+    if (it == entries_.end())
+      return std::nullopt;
+    return it->second;
+  }
+
+  uint64_t epoch() const noexcept {
+    return epoch_.load(std::memory_order_acquire);
+  }
+
+  void fill(handle_key &&key, const wrap::action_descriptor &d,
+            uint64_t epoch) {
+    std::scoped_lock lk(mtx_);
+    if (epoch == epoch_.load(std::memory_order_acquire))
+      entries_.try_emplace(std::move(key), d);
+  }
+
+  void invalidate(PASMP_action_t x) noexcept {
+    epoch_.fetch_add(1, std::memory_order_acq_rel);
+    std::scoped_lock lk(mtx_);
+    if (auto it = entries_.find(x); it != entries_.end())
+      entries_.erase(it);
+  }
+
+private:
+  mutable std::shared_mutex mtx_;
+  std::unordered_map<handle_key, wrap::action_descriptor, handle_hash,
+                     handle_equal>
+      entries_;
+  std::atomic<uint64_t> epoch_ = 0;
+};
+
+// asks for the size, then for the state, again if it grew in between
+template <typename Read>
+std::string read_state(Read read, std::error_code &ec,
+                       wrap::error_descriptor &ed) noexcept {
+  std::string state;
+  while (true) {
+    uint64_t size = 0;
+    ed.clear();
+    if (auto status = read(nullptr, &size)) {
+      ec = wrap::make_error_code(status);
+      return {};
+    }
+    try {
+      state.resize(size);
+    } catch (const std::bad_alloc &) {
+      ec = wrap::make_error_code(wrap::generic_errc::alloc);
+      return {};
+    }
+    ed.clear();
+    auto status = read(state.data(), &size);
+    if (status == PASMP_ERROR_TRUNCATED)
+      continue;
+    if (status) {
+      ec = wrap::make_error_code(status);
+      return {};
+    }
+    // shrinking never allocates
+    state.resize(size);
+    ec.clear();
+    return state;
+  }
+}
+
 } // namespace
 
 namespace wrap {
@@ -130,6 +209,7 @@ struct plugin::impl final : plugin_object,
                             std::enable_shared_from_this<plugin::impl> {
   plugin_attributes attr;
   PASMP_plugin_t handle;
+  std::unique_ptr<descriptor_cache> cache;
 
   static std::shared_ptr<impl> create(const modl::loaded_module &mod,
                                       plugin_attributes &&attr,
@@ -151,7 +231,11 @@ private:
        error_descriptor &ed)
       : plugin_object(mod), attr(std::move(attr)), handle(nullptr) {}
 
-  void init(error_descriptor &ed) { handle = create_plugin(init_attr(ed), ed); }
+  void init(error_descriptor &ed) {
+    if (attr.cache_descriptors())
+      cache = std::make_unique<descriptor_cache>(get_module());
+    handle = create_plugin(init_attr(ed), ed);
+  }
 
   plugin_attributes_helper init_attr(error_descriptor &ed) {
     plugin_attributes_helper attr_h(get_module(), ed);
@@ -206,19 +290,48 @@ private:
                   "Incorrect event in wrap_callback");
     const auto &imp = *static_cast<const impl *>(data);
     key<plugin> k;
+    if (imp.cache)
+      imp.cache->invalidate(handle);
     try {
-      imp.attr.callback(k)(Event, action{plugin(imp), handle, k});
-    } catch (...) {
-      const auto &on_error = imp.attr.on_error(k);
-      if (on_error) {
-        try {
-          on_error(std::current_exception());
-        } catch (...) {
-          handle_callback_exception();
-        }
+      if (auto *q = imp.attr.queue()) {
+        // nothing is borrowed once the callback runs on another thread
+        q->post([&imp, a = action{plugin(imp), handle, k}]() {
+          notify<Event>(imp, a);
+        });
+      } else if (const auto &cb = imp.attr.ref_callback(k)) {
+        plugin borrowed(imp, borrow_tag{});
+        cb(Event, action_ref{borrowed, handle});
       } else {
+        imp.attr.callback(k)(Event, action{plugin(imp), handle, k});
+      }
+    } catch (...) {
+      report(imp);
+    }
+  }
+
+  template <action_event Event>
+  static void notify(const impl &imp, const action &a) noexcept {
+    key<plugin> k;
+    try {
+      if (const auto &cb = imp.attr.ref_callback(k))
+        cb(Event, action_ref{a});
+      else
+        imp.attr.callback(k)(Event, a);
+    } catch (...) {
+      report(imp);
+    }
+  }
+
+  static void report(const impl &imp) noexcept {
+    const auto &on_error = imp.attr.on_error(key<plugin>{});
+    if (on_error) {
+      try {
+        on_error(std::current_exception());
+      } catch (...) {
         handle_callback_exception();
       }
+    } else {
+      handle_callback_exception();
     }
   }
 };
@@ -229,6 +342,24 @@ plugin::plugin(const modl::loaded_module &mod, plugin_attributes attr,
 
 plugin::plugin(const impl &x) : impl_(x.shared_from_this()) {}
 
+// aliases the impl without sharing ownership, so no reference count is touched
+plugin::plugin(const impl &x, borrow_tag) noexcept
+    : impl_(std::shared_ptr<const impl>{}, &x) {}
+
+plugin::plugin(const plugin &x) : impl_(owning(x.impl_)) {}
+
+plugin &plugin::operator=(const plugin &x) {
+  impl_ = owning(x.impl_);
+  return *this;
+}
+
+std::shared_ptr<const plugin::impl>
+plugin::owning(const std::shared_ptr<const impl> &x) {
+  if (x && !x.use_count())
+    return x->shared_from_this();
+  return x;
+}
+
 std::vector<action> plugin::actions(error_descriptor &ed) const {
   action_collection col(*this, ed, key<plugin>{});
   ed.clear();
@@ -265,6 +396,115 @@ std::vector<action> plugin::actions(std::error_code &ec,
   return actions;
 }
 
+action_range plugin::actions_view(error_descriptor &ed) const {
+  return action_range{*this, ed, key<plugin>{}};
+}
+
+action_range plugin::actions_view(std::error_code &ec,
+                                  error_descriptor &ed) const {
+  try {
+    action_range range{*this, ed, key<plugin>{}};
+    ec.clear();
+    return range;
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+  } catch (const any_error &e) {
+    ec = e.code();
+  }
+  return {};
+}
+
+action_descriptor plugin::descriptor(const action &a,
+                                     error_descriptor &ed) const {
+  std::error_code ec;
+  auto retval = descriptor(a, ec, ed);
+  if (ec)
+    error_code_as_exception(ec, ed);
+  return retval;
+}
+
+action_descriptor plugin::descriptor(const action &a, std::error_code &ec,
+                                     error_descriptor &ed) const noexcept {
+  try {
+    auto &cache = impl_->cache;
+    if (cache)
+      if (auto d = cache->find(a.get())) {
+        ec.clear();
+        return *std::move(d);
+      }
+    auto epoch = cache ? cache->epoch() : 0;
+    action_descriptor d;
+    if (!d.load(a, ec, ed))
+      return {};
+    if (cache) {
+      // failing to cache must not fail the lookup itself
+      try {
+        cache->fill(handle_key{get_module(), a.get()}, d, epoch);
+      } catch (...) {
+      }
+    }
+    return d;
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+  } catch (const any_error &e) {
+    ec = e.code();
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+  }
+  return {};
+}
+
+std::string plugin::serialize(error_descriptor &ed) const {
+  std::error_code ec;
+  auto retval = serialize(ec, ed);
+  if (ec)
+    error_code_as_exception(ec, ed);
+  return retval;
+}
+
+std::string plugin::serialize(std::error_code &ec,
+                              error_descriptor &ed) const noexcept {
+  const auto &fn = get_module().funcs().plugin_serialize;
+  return read_state(
+      [&](char *into, uint64_t *size) { return fn(get(), into, size, &ed); },
+      ec, ed);
+}
+
+std::string plugin::extract(const action &a, error_descriptor &ed) const {
+  std::error_code ec;
+  auto retval = extract(a, ec, ed);
+  if (ec)
+    error_code_as_exception(ec, ed);
+  return retval;
+}
+
+std::string plugin::extract(const action &a, std::error_code &ec,
+                            error_descriptor &ed) const noexcept {
+  const auto &fn = get_module().funcs().plugin_extract;
+  return read_state(
+      [&](char *into, uint64_t *size) {
+        return fn(get(), a.get(), into, size, &ed);
+      },
+      ec, ed);
+}
+
+void plugin::deserialize(std::string_view state, error_descriptor &ed) const {
+  if (std::error_code ec; !deserialize(state, ec, ed))
+    error_code_as_exception(ec, ed);
+}
+
+bool plugin::deserialize(std::string_view state, std::error_code &ec,
+                         error_descriptor &ed) const noexcept {
+  ed.clear();
+  if (auto status = get_module().funcs().plugin_deserialize(
+          get(), state.data(), state.size(), &ed)) {
+    ec = make_error_code(status);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
 PASMP_plugin_t plugin::get() const noexcept { return impl_->handle; }
 
 const modl::loaded_module &plugin::get_module() const noexcept {
@@ -275,7 +515,7 @@ const plugin_attributes &plugin::attributes() const noexcept {
   return impl_->attr;
 }
 
-bool operator==(const plugin &lhs, const plugin &rhs) {
+bool operator==(const plugin &lhs, const plugin &rhs) noexcept {
   return lhs.get_module() == rhs.get_module() && lhs.get() == rhs.get();
 }
 
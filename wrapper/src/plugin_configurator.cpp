@@ -15,20 +15,6 @@
 
 namespace {
 
-std::pair<std::error_code, wrap::configure_status>
-to_status_pair(PASMP_status_t s, PASMP_config_status_t x) noexcept {
-  auto ec = wrap::make_error_code(s);
-  if (ec)
-    return {std::move(ec), {}};
-  switch (x) {
-  case PASMP_CONFIG_SUCCESS:
-    return {std::move(ec), wrap::configure_status::success};
-  case PASMP_CONFIG_CANCEL:
-    return {std::move(ec), wrap::configure_status::cancel};
-  }
-  return {wrap::make_error_code(wrap::logic_errc::invalid_status), {}};
-}
-
 template <typename T> struct configurator_impl_base {
   wrap::plugin plugin_;
   wrap::configure_result result_;
@@ -125,7 +111,7 @@ void plugin_configurator::impl::wrap_callback(PASMP_status_t s,
                                               void *data) {
   try {
     auto &imp = *static_cast<impl *>(data);
-    imp.result_ = to_status_pair(s, cs);
+    imp.result_ = to_configure_result(s, cs);
     imp.resultsem_.release();
   } catch (...) {
     handle_callback_exception();
@@ -151,7 +137,7 @@ void plugin_configurator_async::impl::wrap_callback(PASMP_status_t s,
                                                     void *data) {
   auto &imp = *static_cast<impl *>(data);
   try {
-    auto [ec, stat] = to_status_pair(s, cs);
+    auto [ec, stat] = to_configure_result(s, cs);
     assert(imp.callback_);
     imp.callback_(ec, stat);
     imp.result_ = {ec, stat};
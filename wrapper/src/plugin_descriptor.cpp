@@ -12,18 +12,19 @@
 namespace {
 
 template <bool ShortVariant>
-std::string load_name(const modl::loaded_module &mod,
-                      PASMP_plugin_descriptor_t handle) {
+wrap::rc_immutable_string load_name(const modl::loaded_module &mod,
+                                    PASMP_plugin_descriptor_t handle) {
   auto [str, sz] = mod.funcs().plugin_name(handle, ShortVariant);
-  return std::string(str, sz);
+  return wrap::intern({str, sz});
 }
 
 template <bool ShortVariant>
-std::string load_description(const modl::loaded_module &mod,
-                             PASMP_plugin_descriptor_t handle) {
+wrap::rc_immutable_string
+load_description(const modl::loaded_module &mod,
+                 PASMP_plugin_descriptor_t handle) {
 
   auto [str, sz] = mod.funcs().plugin_description(handle, ShortVariant);
-  return std::string(str, sz);
+  return wrap::intern({str, sz});
 }
 
 PASMP_plugin_descriptor_t create_descriptor(const modl::loaded_module &mod,
@@ -0,0 +1,266 @@
+#include <wrap/error_descriptor.hpp>
+#include <wrap/plugin_descriptor.hpp>
+#include <wrap/plugin_discovery.hpp>
+#include <wrap/plugin_version.hpp>
+
+#include <module_load/module.hpp>
+
+#include <plugin/plugin_interface.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <exception>
+#include <fstream>
+#include <ostream>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+constexpr std::string_view manifest_header = "pasmp-manifest 1";
+
+struct file_identity {
+  uint64_t inode;
+  int64_t mtime;
+  uint64_t size;
+
+  friend bool operator==(const file_identity &,
+                         const file_identity &) noexcept = default;
+};
+
+std::optional<file_identity> identify(const std::filesystem::path &p) {
+#if defined(_WIN32)
+  // no inode to speak of, the modification time and size have to do
+  struct _stat64 st;
+  if (_wstat64(p.c_str(), &st))
+    return std::nullopt;
+  return file_identity{.inode = 0,
+                       .mtime = static_cast<int64_t>(st.st_mtime),
+                       .size = static_cast<uint64_t>(st.st_size)};
+#else
+  struct stat st;
+  if (::stat(p.c_str(), &st))
+    return std::nullopt;
+  return file_identity{
+      .inode = static_cast<uint64_t>(st.st_ino),
+      .mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 +
+               st.st_mtim.tv_nsec,
+      .size = static_cast<uint64_t>(st.st_size)};
+#endif
+}
+
+struct manifest_entry {
+  file_identity id;
+  wrap::discovered_plugin plugin;
+};
+
+using manifest = std::unordered_map<std::string, manifest_entry>;
+
+// fields are tab separated, so tabs, newlines and backslashes are escaped
+void write_field(std::ostream &os, std::string_view x) {
+  for (char c : x) {
+    switch (c) {
+    case '\t':
+      os << "\\t";
+      break;
+    case '\n':
+      os << "\\n";
+      break;
+    case '\\':
+      os << "\\\\";
+      break;
+    default:
+      os << c;
+    }
+  }
+}
+
+std::vector<std::string> split_fields(std::string_view line) {
+  std::vector<std::string> fields(1);
+  for (size_t i = 0; i < line.size(); i++) {
+    char c = line[i];
+    if (c == '\t') {
+      fields.emplace_back();
+    } else if (c == '\\' && i + 1 < line.size()) {
+      char n = line[++i];
+      fields.back().push_back(n == 't' ? '\t' : n == 'n' ? '\n' : n);
+    } else {
+      fields.back().push_back(c);
+    }
+  }
+  return fields;
+}
+
+template <typename T> bool parse(const std::string &s, T &out) {
+  auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+  return ec == std::errc{} && ptr == s.data() + s.size();
+}
+
+// a manifest written by a host of another interface version is discarded,
+// since compatibility has to be checked again
+manifest read_manifest(const std::filesystem::path &p) {
+  manifest retval;
+  std::ifstream is(p);
+  std::string line;
+  if (!std::getline(is, line) || line != manifest_header)
+    return retval;
+  if (uint32_t ver; !std::getline(is, line) || !parse(line, ver) ||
+                    ver != PASMP_VERSION)
+    return retval;
+  while (std::getline(is, line)) {
+    auto f = split_fields(line);
+    if (f.size() != 13)
+      continue;
+    manifest_entry e;
+    auto &pl = e.plugin;
+    if (!parse(f[1], e.id.inode) || !parse(f[2], e.id.mtime) ||
+        !parse(f[3], e.id.size) || !parse(f[4], pl.library_version.major) ||
+        !parse(f[5], pl.library_version.minor) || !parse(f[6], pl.major) ||
+        !parse(f[7], pl.minor) || !parse(f[8], pl.patch))
+      continue;
+    pl.path = f[0];
+    pl.pre_release = std::move(f[9]);
+    pl.build = std::move(f[10]);
+    pl.name = std::move(f[11]);
+    pl.description = std::move(f[12]);
+    pl.cached = true;
+    retval.insert_or_assign(std::move(f[0]), std::move(e));
+  }
+  return retval;
+}
+
+void write_manifest(const std::filesystem::path &p,
+                    const std::vector<manifest_entry> &entries) {
+  auto tmp = p;
+  tmp += ".tmp";
+  {
+    std::ofstream os(tmp, std::ios::trunc);
+    os << manifest_header << '\n' << PASMP_VERSION << '\n';
+    for (const auto &[id, pl] : entries) {
+      write_field(os, pl.path.string());
+      os << '\t' << id.inode << '\t' << id.mtime << '\t' << id.size << '\t'
+         << pl.library_version.major << '\t' << pl.library_version.minor
+         << '\t' << pl.major << '\t' << pl.minor << '\t' << pl.patch << '\t';
+      write_field(os, pl.pre_release);
+      os << '\t';
+      write_field(os, pl.build);
+      os << '\t';
+      write_field(os, pl.name);
+      os << '\t';
+      write_field(os, pl.description);
+      os << '\n';
+    }
+    if (!os)
+      return;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, p, ec);
+}
+
+wrap::discovered_plugin probe(const std::filesystem::path &p) {
+  wrap::static_error_descriptor<256> ed;
+  // bound eagerly, so that a candidate missing an entry point fails here
+  // rather than from the noexcept wrappers below
+  modl::loaded_module mod(p, modl::load_options{});
+  wrap::plugin_version version(mod, ed);
+  wrap::plugin_descriptor descr(mod, ed);
+  return {.path = p,
+          .library_version = mod.version(),
+          .major = version.major(),
+          .minor = version.minor(),
+          .patch = version.patch(),
+          .pre_release = version.pre_release(),
+          .build = version.build(),
+          .name = std::string(descr.name()),
+          .description = std::string(descr.descr()),
+          .cached = false};
+}
+
+struct candidate {
+  std::filesystem::path path;
+  std::optional<file_identity> id;
+  std::optional<wrap::discovered_plugin> plugin;
+  std::string error;
+};
+
+} // namespace
+
+namespace wrap {
+
+discovery_result discover_plugins(const std::filesystem::path &dir,
+                                  const discovery_options &opts) {
+  manifest cache;
+  if (!opts.manifest.empty())
+    cache = read_manifest(opts.manifest);
+
+  std::vector<candidate> candidates;
+  std::vector<size_t> pending;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    if (!entry.is_regular_file() || entry.path().extension() != opts.extension)
+      continue;
+    auto &c = candidates.emplace_back();
+    c.path = entry.path();
+    c.id = identify(c.path);
+    auto it = cache.find(c.path.string());
+    if (c.id && it != cache.end() && it->second.id == *c.id)
+      c.plugin = std::move(it->second.plugin);
+    else
+      pending.push_back(candidates.size() - 1);
+  }
+
+  size_t workers = opts.workers;
+  if (!workers)
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  workers = std::min(workers, pending.size());
+  std::atomic<size_t> next = 0;
+  auto work = [&]() {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) <
+                   pending.size();) {
+      auto &c = candidates[pending[i]];
+      try {
+        c.plugin = probe(c.path);
+      } catch (const std::exception &e) {
+        c.error = e.what();
+      } catch (...) {
+        c.error = "unknown error";
+      }
+    }
+  };
+  {
+    std::vector<std::jthread> pool;
+    pool.reserve(workers);
+    for (size_t i = 1; i < workers; i++)
+      pool.emplace_back(work);
+    // the calling thread takes part as well
+    if (workers)
+      work();
+  }
+
+  discovery_result retval;
+  std::vector<manifest_entry> entries;
+  for (auto &c : candidates) {
+    if (!c.plugin) {
+      retval.failures.push_back({std::move(c.path), std::move(c.error)});
+      continue;
+    }
+    if (c.id)
+      entries.push_back({*c.id, *c.plugin});
+    retval.plugins.push_back(std::move(*c.plugin));
+  }
+  if (!opts.manifest.empty())
+    write_manifest(opts.manifest, entries);
+
+  auto by_path = [](const auto &lhs, const auto &rhs) {
+    return lhs.path < rhs.path;
+  };
+  std::sort(retval.plugins.begin(), retval.plugins.end(), by_path);
+  std::sort(retval.failures.begin(), retval.failures.end(), by_path);
+  return retval;
+}
+
+} // namespace wrap
@@ -0,0 +1,281 @@
+#include <wrap/action.hpp>
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/payload.hpp>
+#include <wrap/plugin_host.hpp>
+
+#include <module_load/module.hpp>
+
+#include "status_utils.hpp"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using clock = wrap::action_scheduler::clock;
+
+struct plugin_state {
+  // events raised while the plugin is being created wait here, since its
+  // handle is only known once the constructor returns
+  std::mutex mtx;
+  bool ready = false;
+  std::vector<std::function<void()>> early;
+
+  std::atomic<size_t> queued = 0;
+  std::atomic<uint64_t> executed = 0;
+  std::atomic<uint64_t> events = 0;
+  std::atomic<uint64_t> latency_total = 0;
+  std::atomic<uint64_t> latency_max = 0;
+
+  void finished(std::atomic<uint64_t> &kind, clock::time_point since) noexcept {
+    auto ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                             since)
+            .count());
+    latency_total.fetch_add(ns, std::memory_order_relaxed);
+    for (auto prev = latency_max.load(std::memory_order_relaxed);
+         prev < ns && !latency_max.compare_exchange_weak(
+                          prev, ns, std::memory_order_relaxed);)
+      ;
+    kind.fetch_add(1, std::memory_order_relaxed);
+    queued.fetch_sub(1, std::memory_order_relaxed);
+  }
+};
+
+struct hosted {
+  wrap::plugin instance;
+  std::shared_ptr<plugin_state> stats;
+};
+
+} // namespace
+
+namespace wrap {
+
+struct plugin_host::impl {
+  on_error_t on_error;
+  // declared before the plugins, whose late events it still runs
+  action_scheduler scheduler;
+  mutable std::mutex mtx;
+  std::unordered_map<PASMP_plugin_t, hosted> plugins;
+  // by module id, claimed before the plugin is created
+  std::unordered_set<uint32_t> modules;
+
+  impl(size_t workers, on_error_t oe)
+      : on_error(oe), scheduler(workers, std::move(oe)) {}
+
+  std::shared_ptr<plugin_state> find(PASMP_plugin_t key) const {
+    std::scoped_lock lk(mtx);
+    auto it = plugins.find(key);
+    return it == plugins.end() ? nullptr : it->second.stats;
+  }
+
+  // runs on the plugin's threads, so the handler is only queued from here
+  plugin_attributes::callback_t deliver(std::shared_ptr<event_handler_t> h,
+                                        std::shared_ptr<plugin_state> c) {
+    return [this, h = std::move(h), c = std::move(c)](action_event ev,
+                                                      action a) {
+      auto since = clock::now();
+      c->queued.fetch_add(1, std::memory_order_relaxed);
+      std::function<void()> run = [h, c, ev, a, since]() {
+        try {
+          (*h)(ev, a);
+        } catch (...) {
+          c->finished(c->events, since);
+          throw;
+        }
+        c->finished(c->events, since);
+      };
+      {
+        std::scoped_lock lk(c->mtx);
+        if (!c->ready) {
+          c->early.push_back(std::move(run));
+          return;
+        }
+      }
+      std::error_code ec;
+      if (!scheduler.post(a.get_plugin(), std::move(run), {}, ec)) {
+        c->queued.fetch_sub(1, std::memory_order_relaxed);
+        throw std::system_error(ec);
+      }
+    };
+  }
+
+  plugin create(const modl::loaded_module &m,
+                std::filesystem::path persistence, event_handler_t h,
+                error_descriptor &ed, uint32_t weight) {
+    // the plugin may raise events before its constructor returns
+    auto state = std::make_shared<plugin_state>();
+    auto handler = std::make_shared<event_handler_t>(std::move(h));
+    plugin p(m,
+             plugin_attributes(std::move(persistence),
+                               deliver(std::move(handler), state), on_error),
+             ed);
+    {
+      std::scoped_lock lk(mtx);
+      plugins.try_emplace(p.get(), hosted{p, state});
+    }
+    if (std::error_code ec; !scheduler.weight(p, weight, ec)) {
+      {
+        std::scoped_lock lk(mtx);
+        plugins.erase(p.get());
+      }
+      scheduler.forget(p);
+      // the early events hold on to the plugin
+      std::scoped_lock lk(state->mtx);
+      state->early.clear();
+      error_code_as_exception(ec, null_error_descriptor{});
+    }
+    // held while posting, so that later events queue behind the early ones
+    std::scoped_lock lk(state->mtx);
+    state->ready = true;
+    for (auto &run : state->early)
+      if (std::error_code ec; !scheduler.post(p, std::move(run), {}, ec))
+        state->queued.fetch_sub(1, std::memory_order_relaxed);
+    state->early.clear();
+    return p;
+  }
+};
+
+plugin_host::plugin_host(size_t workers, on_error_t oe)
+    : impl_(std::make_unique<impl>(workers, std::move(oe))) {}
+
+plugin_host::~plugin_host() {
+  impl_->scheduler.await();
+  std::scoped_lock lk(impl_->mtx);
+  impl_->plugins.clear();
+}
+
+plugin plugin_host::add(const modl::loaded_module &m,
+                        std::filesystem::path persistence, event_handler_t h,
+                        error_descriptor &ed, uint32_t weight) {
+  if (!h || !weight)
+    throw logic_error(logic_errc::invalid_argument, null_error_descriptor{});
+  {
+    std::scoped_lock lk(impl_->mtx);
+    // a module holds a single plugin, which creating again would only share
+    if (!impl_->modules.insert(m.id()).second)
+      throw logic_error(logic_errc::invalid_argument, null_error_descriptor{});
+  }
+  try {
+    return impl_->create(m, std::move(persistence), std::move(h), ed, weight);
+  } catch (...) {
+    std::scoped_lock lk(impl_->mtx);
+    impl_->modules.erase(m.id());
+    throw;
+  }
+}
+
+std::optional<plugin> plugin_host::add(const modl::loaded_module &m,
+                                       std::filesystem::path persistence,
+                                       event_handler_t h, std::error_code &ec,
+                                       error_descriptor &ed,
+                                       uint32_t weight) noexcept {
+  try {
+    auto retval = add(m, std::move(persistence), std::move(h), ed, weight);
+    ec.clear();
+    return retval;
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+  } catch (const any_error &e) {
+    ec = e.code();
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+  }
+  return std::nullopt;
+}
+
+void plugin_host::remove(const plugin &p) {
+  std::unique_lock lk(impl_->mtx);
+  auto node = impl_->plugins.extract(p.get());
+  if (!node.empty())
+    impl_->modules.erase(p.get_module().id());
+  lk.unlock();
+  if (node.empty())
+    throw logic_error(logic_errc::invalid_argument, null_error_descriptor{});
+  impl_->scheduler.forget(p);
+}
+
+std::vector<plugin> plugin_host::plugins() const {
+  std::scoped_lock lk(impl_->mtx);
+  std::vector<plugin> retval;
+  retval.reserve(impl_->plugins.size());
+  for (const auto &[key, h] : impl_->plugins)
+    retval.push_back(h.instance);
+  return retval;
+}
+
+void plugin_host::weight(const plugin &p, uint32_t w) {
+  impl_->scheduler.weight(p, w);
+}
+
+bool plugin_host::weight(const plugin &p, uint32_t w,
+                         std::error_code &ec) noexcept {
+  return impl_->scheduler.weight(p, w, ec);
+}
+
+void plugin_host::submit(const action &a, payload p, submit_options opts,
+                         on_finish_t of) {
+  if (std::error_code ec; !submit(a, std::move(p), opts, std::move(of), ec))
+    error_code_as_exception(ec, null_error_descriptor{});
+}
+
+bool plugin_host::submit(const action &a, payload p, submit_options opts,
+                         on_finish_t of, std::error_code &ec) noexcept {
+  try {
+    auto c = impl_->find(a.get_plugin().get());
+    if (!c) {
+      ec = make_error_code(logic_errc::invalid_argument);
+      return false;
+    }
+    auto since = clock::now();
+    on_finish_t done = [c, since, of = std::move(of)](std::error_code e,
+                                                       std::string_view msg) {
+      c->finished(c->executed, since);
+      if (of)
+        of(e, msg);
+    };
+    c->queued.fetch_add(1, std::memory_order_relaxed);
+    if (!impl_->scheduler.submit(a, std::move(p), opts, std::move(done), ec)) {
+      c->queued.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    }
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+plugin_host_stats plugin_host::stats(const plugin &p) const noexcept {
+  std::shared_ptr<plugin_state> c;
+  try {
+    c = impl_->find(p.get());
+  } catch (...) {
+  }
+  if (!c)
+    return {};
+  auto finished = c->executed.load(std::memory_order_relaxed) +
+                  c->events.load(std::memory_order_relaxed);
+  auto total = c->latency_total.load(std::memory_order_relaxed);
+  return {.queued = c->queued.load(std::memory_order_relaxed),
+          .executed = c->executed.load(std::memory_order_relaxed),
+          .events = c->events.load(std::memory_order_relaxed),
+          .mean_latency =
+              std::chrono::nanoseconds(finished ? total / finished : 0),
+          .max_latency = std::chrono::nanoseconds(
+              c->latency_max.load(std::memory_order_relaxed))};
+}
+
+void plugin_host::await() { impl_->scheduler.await(); }
+
+} // namespace wrap
@@ -0,0 +1,92 @@
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/prepared_action.hpp>
+
+#include <module_load/module.hpp>
+
+#include "status_utils.hpp"
+
+#include <utility>
+
+namespace wrap {
+
+prepared_action::prepared_action(const action &a, PASMP_payload_tag_t tag,
+                                 error_descriptor &ed)
+    : action_(a), tag_(tag) {
+  refresh(ed);
+}
+
+prepared_action::prepared_action(prepared_action &&x) noexcept
+    : action_(std::move(x.action_)), tag_(x.tag_),
+      ctx_(std::exchange(x.ctx_, nullptr)),
+      fn_(std::exchange(x.fn_, nullptr)) {}
+
+prepared_action &prepared_action::operator=(prepared_action &&x) noexcept {
+  if (this != &x) {
+    destroy();
+    action_ = std::move(x.action_);
+    tag_ = x.tag_;
+    ctx_ = std::exchange(x.ctx_, nullptr);
+    fn_ = std::exchange(x.fn_, nullptr);
+  }
+  return *this;
+}
+
+prepared_action::~prepared_action() { destroy(); }
+
+void prepared_action::execute(payload_view p, error_descriptor &ed) const {
+  if (std::error_code ec; !execute(p, ec, ed))
+    error_code_as_exception(ec, ed);
+}
+
+bool prepared_action::execute(payload_view p, std::error_code &ec,
+                              error_descriptor &ed) const noexcept {
+  PASMP_payload_t raw = p;
+  if (raw.tag != tag_) {
+    ec = make_error_code(action_errc::invalid_payload);
+    return false;
+  }
+  if (!fn_) {
+    ec = make_error_code(action_errc::stale);
+    return false;
+  }
+  ed.clear();
+  ec = make_error_code(fn_(ctx_, raw.data, &ed));
+  return !ec;
+}
+
+void prepared_action::refresh(error_descriptor &ed) {
+  if (std::error_code ec; !refresh(ec, ed))
+    error_code_as_exception(ec, ed);
+}
+
+bool prepared_action::refresh(std::error_code &ec,
+                              error_descriptor &ed) noexcept {
+  const auto &p = action_.get_plugin();
+  PASMP_prepared_action_t ctx = nullptr;
+  PASMP_prepared_execute_t *fn = nullptr;
+  ed.clear();
+  if (auto status = p.get_module().funcs().action_prepare(
+          p.get(), action_.get(), tag_, &ctx, &fn, &ed)) {
+    ec = make_error_code(status);
+    return false;
+  }
+  destroy();
+  ctx_ = ctx;
+  fn_ = fn;
+  ec.clear();
+  return true;
+}
+
+void prepared_action::destroy() noexcept {
+  if (!ctx_)
+    return;
+  const auto &p = action_.get_plugin();
+  if (auto status = p.get_module().funcs().prepared_action_destroy(ctx_))
+    default_error_handler("Error destroying prepared action",
+                          make_error_code(status));
+  ctx_ = nullptr;
+  fn_ = nullptr;
+}
+
+} // namespace wrap
@@ -1,61 +1,271 @@
 #include <wrap/rcstring.hpp>
 
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <unordered_set>
+#include <utility>
+
 namespace wrap {
 
+namespace detail {
+
+// the characters follow in the same allocation, terminated by a null
+struct string_rep {
+  std::atomic<uint32_t> refs;
+  // only the empty string, which is shared and never freed
+  const bool pinned;
+  const bool interned;
+  const size_t size;
+  const size_t hash;
+
+  static string_rep *create(bool p, bool i, std::string_view x) {
+    return ::new (::operator new(sizeof(string_rep) + x.size() + 1))
+        string_rep(p, i, x);
+  }
+
+  void destroy() noexcept {
+    this->~string_rep();
+    ::operator delete(this);
+  }
+
+  const char *chars() const noexcept {
+    return reinterpret_cast<const char *>(this + 1);
+  }
+  std::string_view str() const noexcept { return {chars(), size}; }
+
+  void addref() noexcept {
+    if (!pinned)
+      refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // fails once the last reference is gone, while the string is on its way
+  // out of the intern pool
+  bool try_addref() noexcept {
+    auto n = refs.load(std::memory_order_relaxed);
+    while (n && !refs.compare_exchange_weak(n, n + 1,
+                                            std::memory_order_relaxed))
+      ;
+    return n != 0;
+  }
+
+  void release() noexcept;
+
+private:
+  string_rep(bool p, bool i, std::string_view x) noexcept
+      : refs(1), pinned(p), interned(i), size(x.size()),
+        hash(std::hash<std::string_view>{}(x)) {
+    auto *out = reinterpret_cast<char *>(this + 1);
+    if (!x.empty())
+      std::memcpy(out, x.data(), x.size());
+    out[x.size()] = 0;
+  }
+};
+
+} // namespace detail
+
+namespace {
+
+using rep = detail::string_rep;
+
+rep *empty_rep() noexcept {
+  // deliberately leaked, like the pool
+  static rep *ptr = rep::create(true, false, {});
+  return ptr;
+}
+
+// Holds the interned strings without owning them: a string leaves the pool
+// when its last reference is released, so the pool only grows with the
+// number of distinct strings alive at once.
+class intern_pool {
+public:
+  rep *get(std::string_view x) {
+    probe p{x, std::hash<std::string_view>{}(x)};
+    {
+      std::shared_lock lk(mtx_);
+      if (auto it = strings_.find(p);
+          it != strings_.end() && (*it)->try_addref())
+        return *it;
+    }
+    std::scoped_lock lk(mtx_);
+    if (auto it = strings_.find(p); it != strings_.end()) {
+      if ((*it)->try_addref())
+        return *it;
+      // dying, and freed by whoever released it last
+      strings_.erase(it);
+    }
+    auto *r = rep::create(false, true, x);
+    try {
+      strings_.insert(r);
+    } catch (...) {
+      r->destroy();
+      throw;
+    }
+    return r;
+  }
+
+  void erase(rep *r) noexcept {
+    std::scoped_lock lk(mtx_);
+    strings_.erase(r);
+  }
+
+private:
+  struct probe {
+    std::string_view str;
+    size_t hash;
+  };
+
+  struct rep_hash {
+    using is_transparent = void;
+    size_t operator()(const rep *x) const noexcept { return x->hash; }
+    size_t operator()(const probe &x) const noexcept { return x.hash; }
+  };
+
+  struct rep_equal {
+    using is_transparent = void;
+    bool operator()(const rep *lhs, const rep *rhs) const noexcept {
+      return lhs == rhs;
+    }
+    bool operator()(const rep *lhs, const probe &rhs) const noexcept {
+      return lhs->hash == rhs.hash && lhs->str() == rhs.str;
+    }
+    bool operator()(const probe &lhs, const rep *rhs) const noexcept {
+      return (*this)(rhs, lhs);
+    }
+  };
+
+  std::shared_mutex mtx_;
+  std::unordered_set<rep *, rep_hash, rep_equal> strings_;
+};
+
+intern_pool &pool() {
+  // deliberately leaked: interned strings may be released during static
+  // destruction
+  static intern_pool *p = new intern_pool;
+  return *p;
+}
+
+} // namespace
+
+void detail::string_rep::release() noexcept {
+  if (pinned || refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+  if (interned)
+    pool().erase(this);
+  destroy();
+}
+
+rc_immutable_string::rc_immutable_string() noexcept : rep_(empty_rep()) {}
+
 rc_immutable_string::rc_immutable_string(std::string_view x)
-    : data_(std::make_shared<str_type>(x)) {}
+    : rep_(rep::create(false, false, x)) {}
+
+rc_immutable_string::rc_immutable_string(rep *r) noexcept : rep_(r) {}
+
+rc_immutable_string::rc_immutable_string(const rc_immutable_string &x) noexcept
+    : rep_(x.rep_) {
+  rep_->addref();
+}
+
+rc_immutable_string::rc_immutable_string(rc_immutable_string &&x) noexcept
+    : rep_(std::exchange(x.rep_, empty_rep())) {}
+
+rc_immutable_string &
+rc_immutable_string::operator=(const rc_immutable_string &x) noexcept {
+  x.rep_->addref();
+  rep_->release();
+  rep_ = x.rep_;
+  return *this;
+}
 
-rc_immutable_string::operator const str_type &() const noexcept {
-  return *data_;
+rc_immutable_string &
+rc_immutable_string::operator=(rc_immutable_string &&x) noexcept {
+  if (this != &x) {
+    rep_->release();
+    rep_ = std::exchange(x.rep_, empty_rep());
+  }
+  return *this;
 }
 
-bool rc_immutable_string::empty() const noexcept { return data_->empty(); }
+rc_immutable_string::~rc_immutable_string() { rep_->release(); }
+
+rc_immutable_string::operator std::string_view() const noexcept {
+  return rep_->str();
+}
+
+bool rc_immutable_string::empty() const noexcept { return !rep_->size; }
 
 const rc_immutable_string::value_type *
 rc_immutable_string::c_str() const noexcept {
-  return data_->c_str();
+  return rep_->chars();
 }
 
 rc_immutable_string::size_type rc_immutable_string::size() const noexcept {
-  return data_->size();
+  return rep_->size;
 }
 
+size_t rc_immutable_string::hash() const noexcept { return rep_->hash; }
+
 rc_immutable_string::const_iterator
 rc_immutable_string::begin() const noexcept {
-  return data_->begin();
+  return rep_->str().begin();
 }
 
 rc_immutable_string::const_iterator
 rc_immutable_string::cbegin() const noexcept {
-  return data_->cbegin();
+  return begin();
 }
 
 rc_immutable_string::const_iterator rc_immutable_string::end() const noexcept {
-  return data_->end();
+  return rep_->str().end();
 }
 
 rc_immutable_string::const_iterator rc_immutable_string::cend() const noexcept {
-  return data_->cend();
+  return end();
 }
 
 rc_immutable_string::const_reverse_iterator
 rc_immutable_string::rbegin() const noexcept {
-  return data_->rbegin();
+  return rep_->str().rbegin();
 }
 
 rc_immutable_string::const_reverse_iterator
 rc_immutable_string::rend() const noexcept {
-  return data_->rend();
+  return rep_->str().rend();
 }
 
 rc_immutable_string::const_reverse_iterator
 rc_immutable_string::crbegin() const noexcept {
-  return data_->crbegin();
+  return rbegin();
 }
 
 rc_immutable_string::const_reverse_iterator
 rc_immutable_string::crend() const noexcept {
-  return data_->crend();
+  return rend();
+}
+
+bool operator==(const rc_immutable_string &lhs,
+                const rc_immutable_string &rhs) noexcept {
+  if (lhs.rep_ == rhs.rep_)
+    return true;
+  // two distinct live interned strings can never be equal
+  if (lhs.rep_->interned && rhs.rep_->interned)
+    return false;
+  return lhs.rep_->hash == rhs.rep_->hash &&
+         lhs.rep_->str() == rhs.rep_->str();
+}
+
+rc_immutable_string intern(std::string_view x) {
+  if (x.empty())
+    return rc_immutable_string{};
+  return rc_immutable_string{pool().get(x)};
+}
+
+std::ostream &operator<<(std::ostream &os, const rc_immutable_string &x) {
+  return os << std::string_view(x);
 }
 
 } // namespace wrap
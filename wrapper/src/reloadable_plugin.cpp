@@ -0,0 +1,268 @@
+#include <wrap/action_scheduler.hpp>
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/plugin_attributes.hpp>
+#include <wrap/reloadable_plugin.hpp>
+
+#include <module_load/exception.hpp>
+#include <module_load/module_registry.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace wrap {
+
+struct reloadable_plugin::generation {
+  plugin instance;
+  uint64_t epoch;
+  std::atomic<size_t> &draining;
+  // set once a later epoch is published; the last pin to go then signals
+  bool retired = false;
+
+  generation(plugin p, uint64_t e, std::atomic<size_t> &d)
+      : instance(std::move(p)), epoch(e), draining(d) {}
+
+  ~generation() {
+    if (retired && draining.fetch_sub(1) == 1)
+      draining.notify_all();
+  }
+};
+
+struct reloadable_plugin::impl {
+  std::atomic<size_t> draining = 0;
+  std::atomic<std::shared_ptr<generation>> current;
+  // also guards the settings carried over to every new epoch
+  std::mutex reload_mtx;
+  std::optional<rate_limit> plugin_limit;
+  // by serialized action, which stays the same across epochs
+  std::unordered_map<std::string, rate_limit> action_limits;
+  std::vector<std::pair<action_scheduler *, uint32_t>> weights;
+
+  explicit impl(plugin p)
+      : current(std::make_shared<generation>(std::move(p), 0, draining)) {}
+
+  void carry_over(const plugin &p, error_descriptor &ed) {
+    admission_control ac(p);
+    if (plugin_limit)
+      ac.limit(*plugin_limit, ed);
+    for (auto it = action_limits.begin(); it != action_limits.end();) {
+      std::optional<action> a;
+      try {
+        a.emplace(p, it->first, ed);
+      } catch (const any_error &e) {
+        if (e.code() != make_error_code(plugin_errc::action_not_found))
+          throw;
+      }
+      // removed since its limit was set
+      if (!a) {
+        it = action_limits.erase(it);
+        continue;
+      }
+      ac.limit(*a, it->second, ed);
+      ++it;
+    }
+    for (auto [s, w] : weights)
+      s->weight(p, w);
+  }
+
+  // prev is kept alive by the caller, so whichever pin turns out to be the
+  // last one observes the flag
+  void retire(generation &prev, std::shared_ptr<generation> next) {
+    draining.fetch_add(1);
+    prev.retired = true;
+    current.store(std::move(next));
+  }
+};
+
+reloadable_plugin::pin::pin(std::shared_ptr<const generation> g) noexcept
+    : gen_(std::move(g)) {}
+
+const plugin &reloadable_plugin::pin::get() const noexcept {
+  return gen_->instance;
+}
+
+uint64_t reloadable_plugin::pin::epoch() const noexcept { return gen_->epoch; }
+
+reloadable_plugin::reloadable_plugin(plugin p)
+    : impl_(std::make_unique<impl>(std::move(p))) {}
+
+reloadable_plugin::~reloadable_plugin() {
+  impl_->retire(*impl_->current.load(), nullptr);
+  await_drained();
+}
+
+reloadable_plugin::pin reloadable_plugin::acquire() const noexcept {
+  return pin{impl_->current.load()};
+}
+
+uint64_t reloadable_plugin::epoch() const noexcept {
+  return impl_->current.load()->epoch;
+}
+
+void reloadable_plugin::reload(const std::filesystem::path &path,
+                               error_descriptor &ed) {
+  std::scoped_lock lk(impl_->reload_mtx);
+  auto prev = impl_->current.load();
+  const auto &old = prev->instance;
+  plugin next(modl::module_registry::load_copy(path), old.attributes(), ed);
+  next.deserialize(old.serialize(ed), ed);
+  impl_->carry_over(next, ed);
+  impl_->retire(*prev, std::make_shared<generation>(
+                           std::move(next), prev->epoch + 1, impl_->draining));
+}
+
+bool reloadable_plugin::reload(const std::filesystem::path &path,
+                               std::error_code &ec,
+                               error_descriptor &ed) noexcept {
+  try {
+    reload(path, ed);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (const any_error &e) {
+    ec = e.code();
+    return false;
+  } catch (const std::system_error &e) {
+    ec = e.code();
+    return false;
+  } catch (const modl::function_load_error &e) {
+    ec = e.code();
+    return false;
+  } catch (const modl::module_incompatible &) {
+    ec = make_error_code(plugin_errc::unavailable);
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+action reloadable_plugin::rebind(const action &a, error_descriptor &ed) const {
+  auto p = acquire();
+  if (a.get_plugin() == *p)
+    return a;
+  return action{*p, a.serialize(ed), ed};
+}
+
+std::optional<action> reloadable_plugin::rebind(const action &a,
+                                                std::error_code &ec,
+                                                error_descriptor &ed) const
+    noexcept {
+  try {
+    auto retval = rebind(a, ed);
+    ec.clear();
+    return retval;
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+  } catch (const any_error &e) {
+    ec = e.code();
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+  }
+  return std::nullopt;
+}
+
+void reloadable_plugin::limit(rate_limit x, error_descriptor &ed) {
+  std::scoped_lock lk(impl_->reload_mtx);
+  admission_control(impl_->current.load()->instance).limit(x, ed);
+  impl_->plugin_limit = x;
+}
+
+bool reloadable_plugin::limit(rate_limit x, std::error_code &ec,
+                              error_descriptor &ed) noexcept {
+  try {
+    limit(x, ed);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (const any_error &e) {
+    ec = e.code();
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+void reloadable_plugin::limit(const action &a, rate_limit x,
+                              error_descriptor &ed) {
+  std::scoped_lock lk(impl_->reload_mtx);
+  auto gen = impl_->current.load();
+  auto key = a.serialize(ed);
+  if (a.get_plugin() == gen->instance)
+    admission_control(gen->instance).limit(a, x, ed);
+  else
+    admission_control(gen->instance)
+        .limit(action{gen->instance, key, ed}, x, ed);
+  impl_->action_limits.insert_or_assign(std::move(key), x);
+}
+
+bool reloadable_plugin::limit(const action &a, rate_limit x,
+                              std::error_code &ec,
+                              error_descriptor &ed) noexcept {
+  try {
+    limit(a, x, ed);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (const any_error &e) {
+    ec = e.code();
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+void reloadable_plugin::weight(action_scheduler &s, uint32_t w) {
+  std::scoped_lock lk(impl_->reload_mtx);
+  s.weight(impl_->current.load()->instance, w);
+  auto &weights = impl_->weights;
+  auto it = std::find_if(weights.begin(), weights.end(),
+                         [&s](const auto &x) { return x.first == &s; });
+  if (it != weights.end())
+    it->second = w;
+  else
+    weights.emplace_back(&s, w);
+}
+
+bool reloadable_plugin::weight(action_scheduler &s, uint32_t w,
+                               std::error_code &ec) noexcept {
+  try {
+    weight(s, w);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (const any_error &e) {
+    ec = e.code();
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+size_t reloadable_plugin::draining() const noexcept {
+  return impl_->draining.load();
+}
+
+void reloadable_plugin::await_drained() const noexcept {
+  for (auto n = impl_->draining.load(); n; n = impl_->draining.load())
+    impl_->draining.wait(n);
+}
+
+} // namespace wrap
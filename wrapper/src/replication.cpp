@@ -0,0 +1,536 @@
+#include <wrap/action.hpp>
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/plugin_attributes.hpp>
+#include <wrap/replication.hpp>
+
+#include "status_utils.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+#if defined(__linux__)
+
+// A frame is a frame_header followed by size bytes: the plugin state for a
+// snapshot, the action_event and the serialized action for an event. sent is
+// read from steady_clock, which is CLOCK_MONOTONIC and so shared by every
+// process on the machine.
+enum class frame_kind : uint32_t {
+  snapshot,
+  event,
+};
+
+struct frame_header {
+  uint32_t size;
+  frame_kind kind;
+  uint64_t seq;
+  int64_t sent;
+};
+
+// standbys with more than this much left to send, besides the latest
+// snapshot, are dropped
+constexpr size_t max_backlog = 64 * 1024 * 1024;
+// larger states are not replicated, and larger frames end the connection
+constexpr size_t max_frame = 1024 * 1024 * 1024;
+
+std::system_error last_system_error(const char *what) {
+  return {std::error_code(errno, std::system_category()), what};
+}
+
+int64_t now_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             clock::now().time_since_epoch())
+      .count();
+}
+
+void append(std::vector<char> &out, const void *first, size_t size) {
+  auto *bytes = static_cast<const char *>(first);
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+void append_frame(std::vector<char> &out, frame_kind kind, uint64_t seq,
+                  std::string_view body, int64_t sent) {
+  if (body.size() > max_frame)
+    wrap::error_code_as_exception(
+        make_error_code(wrap::generic_errc::truncated),
+        wrap::null_error_descriptor{});
+  frame_header h{static_cast<uint32_t>(body.size()), kind, seq, sent};
+  append(out, &h, sizeof(h));
+  append(out, body.data(), body.size());
+}
+
+sockaddr_un socket_address(const std::filesystem::path &socket) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  auto endpoint = socket.string();
+  if (endpoint.empty() || endpoint.size() >= sizeof(addr.sun_path))
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                            "Invalid replication endpoint");
+  std::memcpy(addr.sun_path, endpoint.data(), endpoint.size());
+  return addr;
+}
+
+bool read_all(int fd, char *first, size_t size) noexcept {
+  while (size) {
+    auto n = recv(fd, first, size, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    first += n;
+    size -= n;
+  }
+  return true;
+}
+
+struct standby_conn {
+  int fd;
+  std::vector<char> out;
+
+  // sends what the socket takes without blocking
+  bool flush(size_t limit) noexcept {
+    size_t sent = 0;
+    while (sent < out.size()) {
+      auto n = send(fd, out.data() + sent, out.size() - sent,
+                    MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        break;
+      if (n <= 0)
+        return false;
+      sent += n;
+    }
+    out.erase(out.begin(), out.begin() + sent);
+    return out.size() <= limit;
+  }
+};
+
+#endif
+
+} // namespace
+
+namespace wrap {
+
+#if defined(__linux__)
+
+// A single thread accepts standbys, makes the snapshots and writes to the
+// standbys, so publish() only queues its frame and wakes that thread.
+struct replication_primary::impl {
+  plugin source;
+  replication_options opts;
+  std::filesystem::path path;
+  int listen_fd = -1;
+  int wake[2] = {-1, -1};
+
+  std::mutex mtx;
+  std::vector<char> pending;
+  uint64_t next_seq = 1;
+  std::optional<clock::time_point> dirty_since;
+  bool stopping = false;
+
+  std::atomic<uint64_t> seq = 0;
+  std::atomic<uint64_t> events = 0;
+  std::atomic<uint64_t> snapshots = 0;
+  std::atomic<size_t> standbys = 0;
+  std::atomic<uint64_t> dropped = 0;
+
+  std::jthread thread;
+
+  impl(plugin p, const std::filesystem::path &socket, replication_options o)
+      : source(std::move(p)), opts(o), path(socket) {
+    auto addr = socket_address(socket);
+    listen_fd =
+        ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd < 0)
+      throw last_system_error("Error creating replication socket");
+    unlink(addr.sun_path);
+    if (bind(listen_fd, reinterpret_cast<const sockaddr *>(&addr),
+             sizeof(addr)) ||
+        listen(listen_fd, 16)) {
+      auto e = last_system_error("Error listening for standbys");
+      close(listen_fd);
+      throw e;
+    }
+    if (pipe2(wake, O_CLOEXEC | O_NONBLOCK)) {
+      auto e = last_system_error("Error creating replication wakeup");
+      close(listen_fd);
+      unlink(addr.sun_path);
+      throw e;
+    }
+    thread = std::jthread([this]() { run(); });
+  }
+
+  ~impl() {
+    {
+      std::scoped_lock lk(mtx);
+      stopping = true;
+    }
+    signal();
+    thread.join();
+    close(listen_fd);
+    close(wake[0]);
+    close(wake[1]);
+    unlink(path.c_str());
+  }
+
+  void signal() noexcept {
+    char c = 0;
+    [[maybe_unused]] auto n = write(wake[1], &c, 1);
+  }
+
+  void publish(action_event ev, std::string_view key) {
+    auto sent = now_ns();
+    bool was_empty;
+    {
+      std::scoped_lock lk(mtx);
+      was_empty = pending.empty();
+      std::string body(sizeof(ev), '\0');
+      std::memcpy(body.data(), &ev, sizeof(ev));
+      body.append(key);
+      append_frame(pending, frame_kind::event, next_seq++, body, sent);
+      if (!dirty_since)
+        dirty_since = clock::now();
+    }
+    events.fetch_add(1, std::memory_order_relaxed);
+    if (was_empty)
+      signal();
+  }
+
+  void run() noexcept {
+    static_error_descriptor<256> ed;
+    std::vector<standby_conn> conns;
+    std::vector<int> fresh;
+    std::vector<char> batch;
+    std::vector<pollfd> fds;
+    auto last_snapshot = clock::now();
+    size_t snapshot_size = 0;
+    while (true) {
+      auto due = last_snapshot + opts.snapshot_interval;
+      {
+        std::scoped_lock lk(mtx);
+        if (dirty_since)
+          due = std::min(due, *dirty_since + opts.snapshot_delay);
+      }
+      auto timeout = std::chrono::ceil<std::chrono::milliseconds>(
+          due - clock::now());
+      fds.clear();
+      fds.push_back({wake[0], POLLIN, 0});
+      fds.push_back({listen_fd, POLLIN, 0});
+      for (const auto &c : conns) {
+        short mask = c.out.empty() ? POLLIN : POLLIN | POLLOUT;
+        fds.push_back({c.fd, mask, 0});
+      }
+      if (poll(fds.data(), fds.size(),
+               static_cast<int>(std::max<int64_t>(timeout.count(), 0))) < 0 &&
+          errno != EINTR)
+        break;
+      if (fds[0].revents & POLLIN)
+        for (char buf[64]; read(wake[0], buf, sizeof(buf)) > 0;)
+          ;
+
+      bool snapshot_due;
+      {
+        std::scoped_lock lk(mtx);
+        if (stopping)
+          break;
+        std::swap(batch, pending);
+        auto now = clock::now();
+        snapshot_due =
+            now >= last_snapshot + opts.snapshot_interval ||
+            (dirty_since && now >= *dirty_since + opts.snapshot_delay);
+        if (snapshot_due)
+          dirty_since.reset();
+      }
+      try {
+        for (auto &c : conns)
+          c.out.insert(c.out.end(), batch.begin(), batch.end());
+      } catch (const std::bad_alloc &) {
+        break;
+      }
+      batch.clear();
+
+      if (fds[1].revents & POLLIN)
+        for (int fd; (fd = accept4(listen_fd, nullptr, nullptr,
+                                   SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0;)
+          fresh.push_back(fd);
+      // nobody to send a due snapshot to
+      if ((snapshot_due && !conns.empty()) || !fresh.empty())
+        snapshot(conns, fresh, snapshot_due, snapshot_size, ed);
+      if (snapshot_due)
+        last_snapshot = clock::now();
+
+      // standbys never write, so anything readable means they are gone
+      for (size_t i = 0; i < conns.size(); i++) {
+        auto &c = conns[i];
+        bool gone = i + 2 < fds.size() &&
+                    (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR));
+        bool behind = !gone && !c.flush(max_backlog + snapshot_size);
+        if (gone || behind) {
+          if (behind)
+            dropped.fetch_add(1, std::memory_order_relaxed);
+          close(c.fd);
+          c.fd = -1;
+        }
+      }
+      std::erase_if(conns, [](const standby_conn &c) { return c.fd < 0; });
+      standbys.store(conns.size(), std::memory_order_relaxed);
+    }
+    for (auto &c : conns)
+      close(c.fd);
+    for (auto fd : fresh)
+      close(fd);
+  }
+
+  // the new standbys start from this snapshot, the others only get it when due
+  void snapshot(std::vector<standby_conn> &conns, std::vector<int> &fresh,
+                bool due, size_t &size, error_descriptor &ed) noexcept {
+    try {
+      // taken first, so that the events published while serializing, which
+      // the state may lack, come after it
+      uint64_t s;
+      {
+        std::scoped_lock lk(mtx);
+        s = next_seq++;
+      }
+      ed.clear();
+      auto sent = now_ns();
+      auto state = source.serialize(ed);
+      std::vector<char> frame;
+      append_frame(frame, frame_kind::snapshot, s, state, sent);
+      size = frame.size();
+      if (due)
+        for (auto &c : conns)
+          c.out.insert(c.out.end(), frame.begin(), frame.end());
+      conns.reserve(conns.size() + fresh.size());
+      for (auto fd : fresh)
+        conns.push_back({fd, frame});
+      fresh.clear();
+      seq.store(s, std::memory_order_relaxed);
+      snapshots.fetch_add(1, std::memory_order_relaxed);
+    } catch (...) {
+      handle_callback_exception();
+      // tried again after the delay
+      std::scoped_lock lk(mtx);
+      if (!dirty_since)
+        dirty_since = clock::now();
+    }
+  }
+};
+
+struct replication_standby::impl {
+  int fd = -1;
+
+  mutable std::mutex mtx;
+  std::optional<std::string> snapshot;
+  uint64_t seq = 0;
+  uint64_t snapshot_seq = 0;
+  uint64_t pending_events = 0;
+  clock::duration lag{};
+  clock::duration max_lag{};
+  clock::time_point last_received = clock::now();
+  bool connected = true;
+
+  std::jthread reader;
+
+  explicit impl(const std::filesystem::path &socket) {
+    auto addr = socket_address(socket);
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      throw last_system_error("Error creating replication socket");
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr))) {
+      auto e = last_system_error("Error connecting to replication primary");
+      close(fd);
+      throw e;
+    }
+    reader = std::jthread([this]() { run(); });
+  }
+
+  ~impl() {
+    shutdown(fd, SHUT_RDWR);
+    reader.join();
+    close(fd);
+  }
+
+  void run() noexcept {
+    std::string body;
+    frame_header h;
+    while (read_all(fd, reinterpret_cast<char *>(&h), sizeof(h))) {
+      if (h.size > max_frame ||
+          (h.kind != frame_kind::snapshot && h.kind != frame_kind::event))
+        break;
+      try {
+        body.resize(h.size);
+      } catch (const std::bad_alloc &) {
+        break;
+      }
+      if (!read_all(fd, body.data(), body.size()))
+        break;
+      auto now = clock::now();
+      auto l = now.time_since_epoch() - std::chrono::nanoseconds(h.sent);
+      std::scoped_lock lk(mtx);
+      seq = h.seq;
+      lag = l;
+      max_lag = std::max(max_lag, l);
+      last_received = now;
+      if (h.kind == frame_kind::snapshot) {
+        snapshot = std::move(body);
+        snapshot_seq = h.seq;
+        pending_events = 0;
+      } else if (h.seq > snapshot_seq) {
+        pending_events++;
+      }
+    }
+    std::scoped_lock lk(mtx);
+    connected = false;
+  }
+};
+
+#else
+
+struct replication_primary::impl {
+  std::atomic<uint64_t> seq = 0;
+  std::atomic<uint64_t> events = 0;
+  std::atomic<uint64_t> snapshots = 0;
+  std::atomic<size_t> standbys = 0;
+  std::atomic<uint64_t> dropped = 0;
+
+  impl(plugin, const std::filesystem::path &, replication_options) {
+    throw std::system_error(std::make_error_code(std::errc::not_supported),
+                            "Replication is not supported on this platform");
+  }
+
+  void publish(action_event, std::string_view) {}
+};
+
+struct replication_standby::impl {
+  mutable std::mutex mtx;
+  std::optional<std::string> snapshot;
+  uint64_t seq = 0;
+  uint64_t snapshot_seq = 0;
+  uint64_t pending_events = 0;
+  clock::duration lag{};
+  clock::duration max_lag{};
+  clock::time_point last_received;
+  bool connected = false;
+
+  explicit impl(const std::filesystem::path &) {
+    throw std::system_error(std::make_error_code(std::errc::not_supported),
+                            "Replication is not supported on this platform");
+  }
+};
+
+#endif
+
+replication_primary::replication_primary(plugin p,
+                                         const std::filesystem::path &socket,
+                                         replication_options opts)
+    : impl_(std::make_unique<impl>(std::move(p), socket, opts)) {}
+
+replication_primary::~replication_primary() = default;
+
+void replication_primary::publish(action_event ev, const action &a) {
+  static_error_descriptor<256> ed;
+  impl_->publish(ev, a.serialize(ed));
+}
+
+bool replication_primary::publish(action_event ev, const action &a,
+                                  std::error_code &ec) noexcept {
+  try {
+    publish(ev, a);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (const any_error &e) {
+    ec = e.code();
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+primary_stats replication_primary::stats() const noexcept {
+  return {.seq = impl_->seq.load(std::memory_order_relaxed),
+          .events = impl_->events.load(std::memory_order_relaxed),
+          .snapshots = impl_->snapshots.load(std::memory_order_relaxed),
+          .standbys = impl_->standbys.load(std::memory_order_relaxed),
+          .dropped = impl_->dropped.load(std::memory_order_relaxed)};
+}
+
+replication_standby::replication_standby(const std::filesystem::path &socket)
+    : impl_(std::make_unique<impl>(socket)) {}
+
+replication_standby::~replication_standby() = default;
+
+standby_stats replication_standby::stats() const noexcept {
+  std::scoped_lock lk(impl_->mtx);
+  return {.seq = impl_->seq,
+          .snapshot_seq = impl_->snapshot_seq,
+          .pending_events = impl_->pending_events,
+          .lag = impl_->lag,
+          .max_lag = impl_->max_lag,
+          .idle = clock::now() - impl_->last_received,
+          .connected = impl_->connected};
+}
+
+std::optional<std::string> replication_standby::snapshot() const {
+  std::scoped_lock lk(impl_->mtx);
+  return impl_->snapshot;
+}
+
+plugin replication_standby::promote(const modl::loaded_module &m,
+                                    plugin_attributes attr,
+                                    error_descriptor &ed) const {
+  auto state = snapshot();
+  if (!state)
+    error_code_as_exception(make_error_code(plugin_errc::unavailable),
+                            null_error_descriptor{});
+  plugin p(m, std::move(attr), ed);
+  p.deserialize(*state, ed);
+  return p;
+}
+
+std::optional<plugin> replication_standby::promote(const modl::loaded_module &m,
+                                                   plugin_attributes attr,
+                                                   std::error_code &ec,
+                                                   error_descriptor &ed) const
+    noexcept {
+  try {
+    auto retval = promote(m, std::move(attr), ed);
+    ec.clear();
+    return retval;
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+  } catch (const any_error &e) {
+    ec = e.code();
+  } catch (const std::system_error &e) {
+    ec = e.code();
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+  }
+  return std::nullopt;
+}
+
+} // namespace wrap
@@ -0,0 +1,388 @@
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/sharded_plugin.hpp>
+
+#include <module_load/module.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace wrap {
+
+namespace {
+
+// splitmix64 finalizer, which spreads the points of a shard over the ring
+uint64_t mix(uint64_t x) noexcept {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+// FNV-1a, stable across processes unlike std::hash
+uint64_t key_hash(std::string_view key) noexcept {
+  uint64_t h = 0xcbf29ce484222325;
+  for (unsigned char c : key) {
+    h ^= c;
+    h *= 0x100000001b3;
+  }
+  return mix(h);
+}
+
+[[noreturn]] void not_found() {
+  error_code_as_exception(make_error_code(plugin_errc::action_not_found),
+                          null_error_descriptor{});
+}
+
+// The actions of a shard by key, read from the plugin again whenever a lookup
+// misses, since the plugin adds and removes actions on its own.
+class shard_index {
+public:
+  void refresh(const plugin &p, error_descriptor &ed) {
+    std::map<std::string, action, std::less<>> actions;
+    std::unordered_map<action, std::string, action::hash> keys;
+    for (auto &a : p.actions(ed)) {
+      std::string key(p.descriptor(a, ed).name());
+      keys.try_emplace(a, key);
+      actions.insert_or_assign(std::move(key), std::move(a));
+    }
+    std::scoped_lock lk(mtx_);
+    actions_ = std::move(actions);
+    keys_ = std::move(keys);
+  }
+
+  std::optional<std::string> key(const action &a) const {
+    std::shared_lock lk(mtx_);
+    auto it = keys_.find(a);
+    if (it == keys_.end())
+      return std::nullopt;
+    return it->second;
+  }
+
+  std::optional<action> find(std::string_view key) const {
+    std::shared_lock lk(mtx_);
+    auto it = actions_.find(key);
+    if (it == actions_.end())
+      return std::nullopt;
+    return it->second;
+  }
+
+  std::vector<std::pair<std::string, action>> entries() const {
+    std::shared_lock lk(mtx_);
+    return {actions_.begin(), actions_.end()};
+  }
+
+  void erase(std::string_view key) {
+    std::scoped_lock lk(mtx_);
+    auto it = actions_.find(key);
+    if (it == actions_.end())
+      return;
+    keys_.erase(it->second);
+    actions_.erase(it);
+  }
+
+private:
+  mutable std::shared_mutex mtx_;
+  std::map<std::string, action, std::less<>> actions_;
+  std::unordered_map<action, std::string, action::hash> keys_;
+};
+
+struct shard {
+  plugin instance;
+  // identifies the points of the shard, which stay put as others come and go
+  uint64_t seq;
+  // shared by the layouts holding the shard
+  std::shared_ptr<shard_index> index;
+
+  std::string key(const action &a, error_descriptor &ed) const {
+    if (auto k = index->key(a))
+      return *std::move(k);
+    index->refresh(instance, ed);
+    if (auto k = index->key(a))
+      return *std::move(k);
+    not_found();
+  }
+
+  action find(std::string_view key, error_descriptor &ed) const {
+    if (auto a = index->find(key))
+      return *std::move(a);
+    index->refresh(instance, ed);
+    if (auto a = index->find(key))
+      return *std::move(a);
+    not_found();
+  }
+};
+
+struct point {
+  uint64_t pos;
+  size_t shard;
+};
+
+} // namespace
+
+struct sharded_plugin::layout {
+  std::vector<shard> shards;
+  std::vector<point> ring;
+
+  layout(std::vector<shard> s, size_t points_per_shard)
+      : shards(std::move(s)) {
+    ring.reserve(shards.size() * points_per_shard);
+    for (size_t i = 0; i < shards.size(); i++)
+      for (uint64_t j = 0; j < points_per_shard; j++)
+        ring.push_back({mix(shards[i].seq << 32 | j), i});
+    std::ranges::sort(ring, {}, &point::pos);
+  }
+
+  // the first point at or after the position, wrapping around
+  size_t owner_at(uint64_t pos) const noexcept {
+    auto it = std::ranges::lower_bound(ring, pos, {}, &point::pos);
+    return (it == ring.end() ? ring.front() : *it).shard;
+  }
+
+  const shard &owner(std::string_view key) const noexcept {
+    return shards[owner_at(key_hash(key))];
+  }
+
+  // the other shards owning the positions of the points of shard seq
+  std::vector<size_t> owners_of(uint64_t seq, size_t points_per_shard) const {
+    std::vector<size_t> retval;
+    for (uint64_t j = 0; j < points_per_shard; j++) {
+      auto i = owner_at(mix(seq << 32 | j));
+      if (shards[i].seq != seq && std::ranges::find(retval, i) == retval.end())
+        retval.push_back(i);
+    }
+    return retval;
+  }
+
+  auto find(const modl::loaded_module &m) const noexcept {
+    return std::ranges::find_if(
+        shards, [&](const shard &s) { return s.instance.get_module() == m; });
+  }
+};
+
+struct sharded_plugin::impl {
+  size_t points_per_shard;
+  std::atomic<std::shared_ptr<const layout>> current;
+  std::mutex rebalance_mtx;
+  uint64_t next_seq = 0;
+
+  impl(std::vector<plugin> plugins, size_t points, error_descriptor &ed)
+      : points_per_shard(points) {
+    if (plugins.empty() || !points)
+      throw logic_error(logic_errc::invalid_argument, null_error_descriptor{});
+    std::vector<shard> shards;
+    shards.reserve(plugins.size());
+    for (auto &p : plugins) {
+      for (const auto &s : shards)
+        if (s.instance.get_module() == p.get_module())
+          throw logic_error(logic_errc::invalid_argument,
+                            null_error_descriptor{});
+      shards.push_back(
+          {std::move(p), next_seq++, std::make_shared<shard_index>()});
+    }
+    auto l = std::make_shared<const layout>(std::move(shards), points);
+    for (const auto &s : l->shards)
+      sweep(s, *l, ed);
+    current = std::move(l);
+  }
+
+  // Removes the actions whose keys a shard does not own, moving each to its
+  // owner unless the owner holds an action of that key already, which is
+  // kept instead.
+  static void sweep(const shard &from, const layout &l, error_descriptor &ed) {
+    from.index->refresh(from.instance, ed);
+    std::vector<const shard *> receivers;
+    for (const auto &[key, a] : from.index->entries()) {
+      const auto &to = l.owner(key);
+      if (to.seq == from.seq)
+        continue;
+      if (std::ranges::find(receivers, &to) == receivers.end()) {
+        to.index->refresh(to.instance, ed);
+        receivers.push_back(&to);
+      }
+      auto state = from.instance.extract(a, ed);
+      from.index->erase(key);
+      if (!to.index->find(key))
+        hand_over(from, to, state, ed);
+    }
+    for (const auto *to : receivers)
+      to->index->refresh(to->instance, ed);
+  }
+
+  // restores an extracted action into the receiver, or back into the donor,
+  // under a new handle, should the receiver fail
+  static void hand_over(const shard &from, const shard &to,
+                        const std::string &state, error_descriptor &ed) {
+    if (std::error_code ec; !to.instance.deserialize(state, ec, ed)) {
+      std::error_code ignored;
+      from.instance.deserialize(state, ignored, ed);
+      from.index->refresh(from.instance, ed);
+      error_code_as_exception(ec, ed);
+    }
+  }
+
+  // Moves the actions of a shard whose keys it owned in the previous layout,
+  // if any, and no longer does in the next, removing them from it; a
+  // receiver's own action of the same key gives way to the one moved over.
+  // The receivers are read again once done, to learn the handles of what they
+  // took.
+  static void move_out(const shard &from, const layout *prev,
+                       const layout &next, error_descriptor &ed) {
+    from.index->refresh(from.instance, ed);
+    std::vector<const shard *> receivers;
+    for (const auto &[key, a] : from.index->entries()) {
+      const auto &to = next.owner(key);
+      if (to.seq == from.seq || (prev && prev->owner(key).seq != from.seq))
+        continue;
+      if (std::ranges::find(receivers, &to) == receivers.end()) {
+        to.index->refresh(to.instance, ed);
+        receivers.push_back(&to);
+      }
+      auto state = from.instance.extract(a, ed);
+      from.index->erase(key);
+      if (auto stale = to.index->find(key)) {
+        std::error_code ec;
+        to.instance.extract(*stale, ec, ed);
+        to.index->erase(key);
+      }
+      hand_over(from, to, state, ed);
+    }
+    for (const auto *to : receivers)
+      to->index->refresh(to->instance, ed);
+  }
+};
+
+sharded_plugin::sharded_plugin(std::vector<plugin> plugins,
+                               error_descriptor &ed, size_t points_per_shard)
+    : impl_(std::make_unique<impl>(std::move(plugins), points_per_shard, ed)) {
+}
+
+sharded_plugin::~sharded_plugin() = default;
+
+size_t sharded_plugin::size() const noexcept {
+  return impl_->current.load()->shards.size();
+}
+
+std::vector<plugin> sharded_plugin::shards() const {
+  auto l = impl_->current.load();
+  std::vector<plugin> retval;
+  retval.reserve(l->shards.size());
+  for (const auto &s : l->shards)
+    retval.push_back(s.instance);
+  return retval;
+}
+
+plugin sharded_plugin::owner(std::string_view key) const {
+  return impl_->current.load()->owner(key).instance;
+}
+
+action sharded_plugin::route(const action &a, error_descriptor &ed) const {
+  auto l = impl_->current.load();
+  auto from = l->find(a.get_plugin().get_module());
+  if (from == l->shards.end())
+    throw logic_error(logic_errc::invalid_argument, null_error_descriptor{});
+  auto key = from->key(a, ed);
+  const auto &to = l->owner(key);
+  if (to.seq == from->seq)
+    return a;
+  return to.find(key, ed);
+}
+
+std::optional<action> sharded_plugin::route(const action &a,
+                                            std::error_code &ec,
+                                            error_descriptor &ed) const
+    noexcept {
+  try {
+    auto retval = route(a, ed);
+    ec.clear();
+    return retval;
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+  } catch (const any_error &e) {
+    ec = e.code();
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+  }
+  return std::nullopt;
+}
+
+void sharded_plugin::add_shard(plugin p, error_descriptor &ed) {
+  std::scoped_lock lk(impl_->rebalance_mtx);
+  auto prev = impl_->current.load();
+  if (prev->find(p.get_module()) != prev->shards.end())
+    throw logic_error(logic_errc::invalid_argument, null_error_descriptor{});
+  auto seq = impl_->next_seq;
+  auto shards = prev->shards;
+  shards.push_back({std::move(p), seq, std::make_shared<shard_index>()});
+  auto next = std::make_shared<const layout>(std::move(shards),
+                                             impl_->points_per_shard);
+  // the new shard takes over the keys that fall on its points, from whoever
+  // owned them so far, and gives away those of its own that do not
+  for (auto i : prev->owners_of(seq, impl_->points_per_shard))
+    impl::move_out(prev->shards[i], prev.get(), *next, ed);
+  impl::sweep(next->shards.back(), *next, ed);
+  impl_->current = std::move(next);
+  impl_->next_seq++;
+}
+
+bool sharded_plugin::add_shard(plugin p, std::error_code &ec,
+                               error_descriptor &ed) noexcept {
+  try {
+    add_shard(std::move(p), ed);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (const any_error &e) {
+    ec = e.code();
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+void sharded_plugin::remove_shard(const plugin &p, error_descriptor &ed) {
+  std::scoped_lock lk(impl_->rebalance_mtx);
+  auto prev = impl_->current.load();
+  auto it = prev->find(p.get_module());
+  if (it == prev->shards.end() || prev->shards.size() == 1)
+    throw logic_error(logic_errc::invalid_argument, null_error_descriptor{});
+  auto shards = prev->shards;
+  shards.erase(shards.begin() + (it - prev->shards.begin()));
+  auto next = std::make_shared<const layout>(std::move(shards),
+                                             impl_->points_per_shard);
+  // whoever now owns its points takes over its actions
+  impl::move_out(*it, nullptr, *next, ed);
+  impl_->current = std::move(next);
+}
+
+bool sharded_plugin::remove_shard(const plugin &p, std::error_code &ec,
+                                  error_descriptor &ed) noexcept {
+  try {
+    remove_shard(p, ed);
+  } catch (const std::bad_alloc &) {
+    ec = make_error_code(generic_errc::alloc);
+    return false;
+  } catch (const any_error &e) {
+    ec = e.code();
+    return false;
+  } catch (...) {
+    ec = make_error_code(logic_errc::unknown);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+} // namespace wrap
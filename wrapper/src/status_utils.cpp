@@ -44,6 +44,8 @@ std::error_code make_error_code(PASMP_status_t x) noexcept {
     return action_errc::serialization;
   case PASMP_ERROR_PAYLOAD_INVALID:
     return action_errc::invalid_payload;
+  case PASMP_ERROR_ACTION_STALE:
+    return action_errc::stale;
   }
   return logic_errc::invalid_status;
 }
@@ -68,6 +70,20 @@ void handle_callback_exception() noexcept {
   }
 }
 
+configure_result to_configure_result(PASMP_status_t s,
+                                     PASMP_config_status_t x) noexcept {
+  auto ec = make_error_code(s);
+  if (ec)
+    return {std::move(ec), {}};
+  switch (x) {
+  case PASMP_CONFIG_SUCCESS:
+    return {std::move(ec), configure_status::success};
+  case PASMP_CONFIG_CANCEL:
+    return {std::move(ec), configure_status::cancel};
+  }
+  return {make_error_code(logic_errc::invalid_status), {}};
+}
+
 } // namespace wrap
 
 #pragma warning(disable : 4062)
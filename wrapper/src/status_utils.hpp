@@ -1,5 +1,7 @@
 #pragma once
 
+#include <wrap/plugin_configurator.hpp>
+
 #include <plugin/plugin_interface.h>
 
 #include <system_error>
@@ -15,4 +17,7 @@ std::error_code make_error_code(PASMP_status_t) noexcept;
 
 void handle_callback_exception() noexcept;
 
+configure_result to_configure_result(PASMP_status_t,
+                                     PASMP_config_status_t) noexcept;
+
 } // namespace wrap
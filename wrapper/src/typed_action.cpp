@@ -0,0 +1,47 @@
+#include <wrap/error.hpp>
+#include <wrap/error_descriptor.hpp>
+#include <wrap/typed_action.hpp>
+
+#include <module_load/module.hpp>
+
+#include "status_utils.hpp"
+
+namespace wrap::detail {
+
+bool check_payload_type(const action &a, PASMP_payload_tag_t expected,
+                        std::error_code &ec, error_descriptor &ed) noexcept {
+  const auto &p = a.get_plugin();
+  PASMP_payload_tag_t declared = PASMP_PAYLOAD_NONE;
+  ed.clear();
+  if (auto status = p.get_module().funcs().action_payload_type(
+          p.get(), a.get(), &declared, &ed)) {
+    ec = make_error_code(status);
+    return false;
+  }
+  if (declared != expected) {
+    ec = make_error_code(action_errc::invalid_payload);
+    return false;
+  }
+  ec.clear();
+  return true;
+}
+
+bool execute_typed(const action &a, int32_t x, std::error_code &ec,
+                   error_descriptor &ed) noexcept {
+  const auto &p = a.get_plugin();
+  ed.clear();
+  ec = make_error_code(
+      p.get_module().funcs().action_execute_int32(p.get(), a.get(), x, &ed));
+  return !ec;
+}
+
+bool execute_typed(const action &a, payload_view x, std::error_code &ec,
+                   error_descriptor &ed) noexcept {
+  const auto &p = a.get_plugin();
+  ed.clear();
+  ec = make_error_code(
+      p.get_module().funcs().action_execute(p.get(), a.get(), x, &ed));
+  return !ec;
+}
+
+} // namespace wrap::detail